@@ -0,0 +1,307 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "scene.h"
+#include "physics.h"
+#include "transform.h"
+#include "ecs.h"
+
+// headless stress test for updatePhysics, no window or GL context is created
+// usage: physics_bench [--frames N] [--scenario name] [--out file.json] [--profile] [--temp-mb N] [--auto-size-temp]
+
+struct BenchScenario {
+    std::string name;
+    void (*populate)(EntityGroup* entities);
+};
+
+struct BenchResult {
+    std::string scenario;
+    int threads;
+    uint32_t bodies;
+    uint32_t activeBodies;
+    uint32_t maxContacts;
+    double meanContacts;
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+    double populateMs;
+    double meanSyncMs;
+    double meanPhaseMs[PHASE_COUNT];
+    uint32_t maxContactPairs;
+    uint32_t tempFallbacks;
+    PhysicsProfile lastProfile;
+};
+
+static uint32_t addBenchBody(EntityGroup* entities, vec3 position, JPH::EShapeSubType shape, JPH::EMotionType motionType) {
+    uint32_t entityID = getNewEntity(entities, "BenchBody")->entityID;
+    setPosition(entities, entityID, position);
+    RigidBody* rb = addRigidbody(entities, entityID);
+    rb->shape = shape;
+    rb->motionType = motionType;
+    rb->layer = motionType == JPH::EMotionType::Static ? Layers::NON_MOVING : Layers::MOVING;
+    return entityID;
+}
+
+static void addFloor(EntityGroup* entities) {
+    uint32_t floorID = addBenchBody(entities, vec3(0.0f, -1.0f, 0.0f), JPH::EShapeSubType::Box, JPH::EMotionType::Static);
+    getRigidbody(entities, floorID)->halfExtents = vec3(200.0f, 1.0f, 200.0f);
+}
+
+static void populateTrashcanPile(EntityGroup* entities) {
+    addFloor(entities);
+    const int width = 20;
+    const int height = 10;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            for (int z = 0; z < width; z++) {
+                vec3 position = vec3(x * 0.85f - width * 0.425f, 1.0f + y * 1.3f, z * 0.85f - width * 0.425f);
+                uint32_t id = addBenchBody(entities, position, JPH::EShapeSubType::Cylinder, JPH::EMotionType::Dynamic);
+                RigidBody* rb = getRigidbody(entities, id);
+                rb->halfHeight = 0.61f;
+                rb->radius = 0.404732f;
+            }
+        }
+    }
+}
+
+static void populateBoxWall(EntityGroup* entities) {
+    addFloor(entities);
+    const int width = 60;
+    const int height = 40;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            float offset = (y % 2) * 0.5f;
+            vec3 position = vec3(x * 1.0f + offset - width * 0.5f, 0.5f + y * 1.0f, 0.0f);
+            addBenchBody(entities, position, JPH::EShapeSubType::Box, JPH::EMotionType::Dynamic);
+        }
+    }
+}
+
+static void populateCapsuleCrowd(EntityGroup* entities) {
+    addFloor(entities);
+    const int width = 50;
+    for (int x = 0; x < width; x++) {
+        for (int z = 0; z < width; z++) {
+            vec3 position = vec3(x * 1.1f - width * 0.55f, 1.0f, z * 1.1f - width * 0.55f);
+            uint32_t id = addBenchBody(entities, position, JPH::EShapeSubType::Capsule, JPH::EMotionType::Dynamic);
+            RigidBody* rb = getRigidbody(entities, id);
+            rb->halfHeight = 0.5f;
+            rb->radius = 0.3f;
+            rb->rotationLocked = true;
+        }
+    }
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static BenchResult runScenario(Scene* scene, BenchScenario* scenario, int threads, int frames) {
+    PhysicsScene* physicsScene = &scene->physicsScene;
+    EntityGroup* entities = &scene->entities;
+    BenchResult result = {};
+    result.scenario = scenario->name;
+    result.threads = threads;
+
+    physicsScene->jobSystem->setNumThreads(threads);
+
+    std::chrono::steady_clock::time_point populateStart = std::chrono::steady_clock::now();
+    scenario->populate(entities);
+    std::vector<uint32_t> rigidbodyIDs;
+    for (RigidBody& rb : entities->rigidbodies) {
+        rigidbodyIDs.push_back(rb.entityID);
+    }
+
+    addRigidbodies(physicsScene, entities, rigidbodyIDs, JPH::EActivation::Activate);
+    result.populateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - populateStart).count();
+
+    std::vector<double> stepTimes;
+    stepTimes.reserve(frames);
+    uint64_t totalContacts = 0;
+    double totalSyncMs = 0.0;
+    double totalPhaseMs[PHASE_COUNT] = {};
+    physicsScene->profile.tempPeakBytesEver = 0;
+    physicsScene->profile.totalTempFallbacks = 0;
+    scene->physicsAccum = 0.0;
+    scene->deltaTime = cDeltaTime;
+
+    for (int i = 0; i < frames; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        updatePhysics(scene);
+        stepTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+        uint32_t contacts = physicsScene->contactEvents.lastRawCount + physicsScene->contactEvents.lastDropped;
+        totalContacts += contacts;
+        result.maxContacts = std::max(result.maxContacts, contacts);
+
+        const PhysicsProfile* profile = getPhysicsProfile(physicsScene);
+        totalSyncMs += profile->syncMs;
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            totalPhaseMs[phase] += profile->phaseMs[phase];
+        }
+        result.maxContactPairs = std::max(result.maxContactPairs, profile->numContactPairs);
+    }
+
+    result.lastProfile = *getPhysicsProfile(physicsScene);
+    result.tempFallbacks = result.lastProfile.totalTempFallbacks;
+    result.meanSyncMs = frames > 0 ? totalSyncMs / frames : 0.0;
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        result.meanPhaseMs[phase] = frames > 0 ? totalPhaseMs[phase] / frames : 0.0;
+    }
+
+    result.bodies = physicsScene->physicsSystem->GetNumBodies();
+    result.activeBodies = physicsScene->physicsSystem->GetNumActiveBodies(JPH::EBodyType::RigidBody);
+    result.meanContacts = frames > 0 ? static_cast<double>(totalContacts) / frames : 0.0;
+
+    double total = 0.0;
+    for (double time : stepTimes) {
+        total += time;
+    }
+
+    std::sort(stepTimes.begin(), stepTimes.end());
+    result.mean = frames > 0 ? total / frames : 0.0;
+    result.p50 = percentile(stepTimes, 0.5);
+    result.p90 = percentile(stepTimes, 0.9);
+    result.p99 = percentile(stepTimes, 0.99);
+    result.max = stepTimes.empty() ? 0.0 : stepTimes.back();
+
+    clearScene(scene);
+    return result;
+}
+
+static void writeResults(std::ostream& stream, std::vector<BenchResult>& results, int frames) {
+    stream << "{" << std::endl;
+    stream << "  \"frames\": " << frames << "," << std::endl;
+    stream << "  \"deltaTime\": " << cDeltaTime << "," << std::endl;
+    stream << "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << "," << std::endl;
+    stream << "  \"results\": [" << std::endl;
+
+    for (size_t i = 0; i < results.size(); i++) {
+        BenchResult* result = &results[i];
+        stream << "    {";
+        stream << "\"scenario\": \"" << result->scenario << "\", ";
+        stream << "\"threads\": " << result->threads << ", ";
+        stream << "\"bodies\": " << result->bodies << ", ";
+        stream << "\"activeBodies\": " << result->activeBodies << ", ";
+        stream << "\"meanContacts\": " << result->meanContacts << ", ";
+        stream << "\"maxContacts\": " << result->maxContacts << ", ";
+        stream << "\"populateMs\": " << result->populateMs << ", ";
+        stream << "\"stepMs\": {";
+        stream << "\"mean\": " << result->mean << ", ";
+        stream << "\"p50\": " << result->p50 << ", ";
+        stream << "\"p90\": " << result->p90 << ", ";
+        stream << "\"p99\": " << result->p99 << ", ";
+        stream << "\"max\": " << result->max << "}, ";
+        stream << "\"meanSyncMs\": " << result->meanSyncMs << ", ";
+        stream << "\"meanPhaseMs\": {";
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            stream << "\"" << getPhysicsPhaseName(static_cast<PhysicsPhase>(phase)) << "\": " << result->meanPhaseMs[phase] << (phase + 1 < PHASE_COUNT ? ", " : "");
+        }
+        stream << "}, ";
+        stream << "\"maxContactPairs\": " << result->maxContactPairs << ", ";
+        stream << "\"tempPeakBytes\": " << result->lastProfile.tempPeakBytesEver << ", ";
+        stream << "\"tempFallbacks\": " << result->tempFallbacks << ", ";
+        stream << "\"lastFrame\": ";
+        writePhysicsProfile(&result->lastProfile, stream);
+        stream << "}";
+        stream << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+
+    stream << "  ]" << std::endl;
+    stream << "}" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int frames = 600;
+    std::string scenarioFilter = "";
+    std::string outPath = "";
+    bool profilePhases = false;
+    bool autoSizeTemp = false;
+    size_t tempAllocatorSize = cDefaultTempAllocatorSize;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            frames = std::stoi(argv[++i]);
+        } else if (arg == "--scenario" && i + 1 < argc) {
+            scenarioFilter = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (arg == "--profile") {
+            profilePhases = true;
+        } else if (arg == "--temp-mb" && i + 1 < argc) {
+            tempAllocatorSize = static_cast<size_t>(std::stoi(argv[++i])) * 1024 * 1024;
+        } else if (arg == "--auto-size-temp") {
+            autoSizeTemp = true;
+        } else {
+            std::cerr << "ERROR::PHYSICS_BENCH::Unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<BenchScenario> scenarios = {
+        {"trashcan_pile", populateTrashcanPile},
+        {"box_wall", populateBoxWall},
+        {"capsule_crowd", populateCapsuleCrowd},
+    };
+
+    int maxThreads = std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 0);
+    std::vector<int> threadCounts;
+    threadCounts.push_back(0);
+    for (int threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    if (maxThreads > 0) {
+        threadCounts.push_back(maxThreads);
+    }
+
+    Scene* scene = new Scene();
+    initPhysics(scene);
+
+    // counts contacts through the engine's event stream so its cost is part of the measured step
+    PhysicsLayers* layers = &scene->physicsScene.layers;
+    for (uint32_t i = 0; i < layers->numLayers; i++) {
+        layers->contactEvents[i] = true;
+    }
+    scene->physicsScene.contactEvents.eventTypes = CONTACT_ADDED | CONTACT_PERSISTED;
+
+    scene->physicsScene.profile.enabled = profilePhases;
+    scene->physicsScene.profile.autoSizeTempAllocator = autoSizeTemp;
+    if (tempAllocatorSize != cDefaultTempAllocatorSize) {
+        resizeTempAllocator(&scene->physicsScene, tempAllocatorSize);
+    }
+
+    std::vector<BenchResult> results;
+    for (BenchScenario& scenario : scenarios) {
+        if (!scenarioFilter.empty() && scenario.name != scenarioFilter) {
+            continue;
+        }
+
+        for (int threads : threadCounts) {
+            std::cerr << "running " << scenario.name << " with " << threads << " worker threads" << std::endl;
+            results.push_back(runScenario(scene, &scenario, threads, frames));
+        }
+    }
+
+    if (outPath.empty()) {
+        writeResults(std::cout, results, frames);
+    } else {
+        std::ofstream stream(outPath);
+        writeResults(stream, results, frames);
+    }
+
+    destroyPhysicsSystem();
+    return 0;
+}
@@ -0,0 +1,11 @@
+@echo off
+setlocal enabledelayedexpansion
+set sources=
+for %%f in (src\*.cpp) do (
+    if /I not "%%~nxf"=="main.cpp" set sources=!sources! ../src/%%~nxf
+)
+rem links the same debug Jolt.lib as build.bat, so the crt and JPH defines have to match it. only the bench sources get /O2
+pushd build
+cl /Fephysics_bench /EHsc /O2 /MTd /std:c++17 /Zc:inline /fp:fast /D PETES_EDITOR /D WITH_MINIAUDIO /D _MBCS /D WIN32 /D _WINDOWS /D _HAS_EXCEPTIONS=0 /D _DEBUG /D JPH_FLOATING_POINT_EXCEPTIONS_ENABLED /D JPH_DEBUG_RENDERER /D JPH_PROFILE_ENABLED /D JPH_OBJECT_STREAM /D JPH_USE_AVX2 /D JPH_USE_AVX /D JPH_USE_SSE4_1 /D JPH_USE_SSE4_2 /D JPH_USE_LZCNT /D JPH_USE_TZCNT /D JPH_USE_F16C /D JPH_USE_FMADD libcmtd.lib glfw3.lib user32.lib gdi32.lib shell32.lib ../bench/physics_bench.cpp %sources% ../src/utils/*.cpp ../src/utils/*.c ../src/utils/soloud/*.cpp ../src/utils/soloud/*.c -I../src -I../include -I../../JoltPhysics-5.3.0 -I../../soloud20200207/include -I../../imgui-docking /link /libpath:../lib assimp-vc143-mt.lib Jolt.lib /NODEFAULTLIB:libcmt
+popd
+endlocal
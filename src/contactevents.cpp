@@ -0,0 +1,237 @@
+#include <algorithm>
+
+#include <Jolt/Physics/Body/Body.h>
+#include <Jolt/Physics/Collision/ContactListener.h>
+
+#include "contactevents.h"
+#include "physics.h"
+#include "ecs.h"
+
+// which buffer the calling thread writes to, reclaimed whenever the epoch moves on so only threads that actually
+// produced events during a step hold a buffer
+struct ContactThreadSlot {
+    const ContactEvents* owner = nullptr;
+    uint32_t epoch = 0;
+    uint32_t buffer = 0;
+};
+
+static thread_local ContactThreadSlot threadSlot;
+
+static bool layerWantsEvents(const PhysicsLayers* layers, JPH::ObjectLayer layer) {
+    return layer < layers->numLayers && layers->contactEvents[layer];
+}
+
+ContactEventListener::ContactEventListener(const PhysicsLayers* layers, ContactEvents* events)
+    : mLayers(layers), mEvents(events) {}
+
+void ContactEventListener::OnContactAdded(const JPH::Body& inBody1, const JPH::Body& inBody2, const JPH::ContactManifold& inManifold, JPH::ContactSettings& ioSettings) {
+    countContact();
+    if (mEvents->eventTypes & CONTACT_ADDED) {
+        pushContact(CONTACT_ADDED, inBody1, inBody2, inManifold);
+    }
+}
+
+void ContactEventListener::OnContactPersisted(const JPH::Body& inBody1, const JPH::Body& inBody2, const JPH::ContactManifold& inManifold, JPH::ContactSettings& ioSettings) {
+    countContact();
+    if (mEvents->eventTypes & CONTACT_PERSISTED) {
+        pushContact(CONTACT_PERSISTED, inBody1, inBody2, inManifold);
+    }
+}
+
+// jolt doesn't hand out the bodies here, the layer filter for removed contacts runs when merging
+void ContactEventListener::OnContactRemoved(const JPH::SubShapeIDPair& inSubShapePair) {
+    if (!(mEvents->eventTypes & CONTACT_REMOVED)) {
+        return;
+    }
+
+    RawContactEvent event;
+    event.type = CONTACT_REMOVED;
+    event.body1 = inSubShapePair.GetBody1ID();
+    event.body2 = inSubShapePair.GetBody2ID();
+    event.entity1 = INVALID_ID;
+    event.entity2 = INVALID_ID;
+    event.point = vec3::sZero();
+    event.normal = vec3::sZero();
+    event.speed = 0.0f;
+    pushEvent(event);
+}
+
+void ContactEventListener::pushContact(ContactEventType type, const JPH::Body& inBody1, const JPH::Body& inBody2, const JPH::ContactManifold& inManifold) {
+    if (!layerWantsEvents(mLayers, inBody1.GetObjectLayer()) && !layerWantsEvents(mLayers, inBody2.GetObjectLayer())) {
+        return;
+    }
+
+    RawContactEvent event;
+    event.type = type;
+    event.body1 = inBody1.GetID();
+    event.body2 = inBody2.GetID();
+    event.entity1 = static_cast<uint32_t>(inBody1.GetUserData());
+    event.entity2 = static_cast<uint32_t>(inBody2.GetUserData());
+    event.normal = inManifold.mWorldSpaceNormal;
+    event.point = inManifold.mRelativeContactPointsOn1.empty() ? vec3(inManifold.mBaseOffset) : vec3(inManifold.GetWorldSpaceContactPointOn1(0));
+
+    const vec3 relativeVelocity = inBody2.GetLinearVelocity() - inBody1.GetLinearVelocity();
+    event.speed = JPH::max(-relativeVelocity.Dot(event.normal), 0.0f);
+    pushEvent(event);
+}
+
+// lock free, a mutex here would serialize the solver since jolt calls this from every worker
+ContactEventBuffer* ContactEventListener::claimThreadBuffer() {
+    ContactEvents* events = mEvents;
+    const uint32_t epoch = events->epoch.load(std::memory_order_acquire);
+    if (threadSlot.owner != events || threadSlot.epoch != epoch) {
+        threadSlot.owner = events;
+        threadSlot.epoch = epoch;
+        threadSlot.buffer = events->claimedBuffers.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (threadSlot.buffer >= events->numBuffers) {
+        return nullptr;
+    }
+
+    return &events->buffers[threadSlot.buffer];
+}
+
+void ContactEventListener::countContact() {
+    ContactEventBuffer* buffer = claimThreadBuffer();
+    if (buffer != nullptr) {
+        buffer->contactPairs++;
+    }
+}
+
+void ContactEventListener::pushEvent(const RawContactEvent& event) {
+    ContactEvents* events = mEvents;
+    ContactEventBuffer* buffer = claimThreadBuffer();
+    if (buffer == nullptr) {
+        events->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const uint32_t index = buffer->count.load(std::memory_order_relaxed);
+    if (index >= buffer->events.size()) {
+        buffer->overflowed.store(true, std::memory_order_relaxed);
+        events->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    buffer->events[index] = event;
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+void initContactEvents(ContactEvents* events, uint32_t numThreads) {
+    destroyContactEvents(events);
+    events->numBuffers = JPH::max(numThreads, 1u);
+    events->buffers = new ContactEventBuffer[events->numBuffers];
+    for (uint32_t i = 0; i < events->numBuffers; i++) {
+        events->buffers[i].events.resize(cDefaultContactEventsPerThread);
+    }
+}
+
+void destroyContactEvents(ContactEvents* events) {
+    delete[] events->buffers;
+    events->buffers = nullptr;
+    events->numBuffers = 0;
+    events->claimedBuffers.store(0, std::memory_order_relaxed);
+    events->frameEvents.clear();
+}
+
+void beginContactEventFrame(ContactEvents* events) {
+    events->frameEvents.clear();
+    events->lastRawCount = 0;
+}
+
+static bool resolveRemovedContact(PhysicsScene* physicsScene, RawContactEvent* event) {
+    JPH::BodyInterface* bodyInterface = physicsScene->bodyInterface;
+    bool wanted = false;
+
+    if (bodyInterface->IsAdded(event->body1)) {
+        event->entity1 = static_cast<uint32_t>(bodyInterface->GetUserData(event->body1));
+        wanted |= layerWantsEvents(&physicsScene->layers, bodyInterface->GetObjectLayer(event->body1));
+    }
+
+    if (bodyInterface->IsAdded(event->body2)) {
+        event->entity2 = static_cast<uint32_t>(bodyInterface->GetUserData(event->body2));
+        wanted |= layerWantsEvents(&physicsScene->layers, bodyInterface->GetObjectLayer(event->body2));
+    }
+
+    return wanted;
+}
+
+static void appendContactEvent(ContactEvents* events, const RawContactEvent* raw) {
+    ContactEvent event;
+    event.type = raw->type;
+    event.point = raw->point;
+    event.speed = raw->speed;
+
+    if (raw->entity1 != INVALID_ID) {
+        event.entityID = raw->entity1;
+        event.otherEntityID = raw->entity2;
+        event.normal = raw->normal;
+        events->frameEvents.push_back(event);
+    }
+
+    if (raw->entity2 != INVALID_ID) {
+        event.entityID = raw->entity2;
+        event.otherEntityID = raw->entity1;
+        event.normal = -raw->normal;
+        events->frameEvents.push_back(event);
+    }
+}
+
+// called after every PhysicsSystem::Update, the jobs are done so the buffers can be read without synchronization
+void collectContactEvents(PhysicsScene* physicsScene) {
+    ContactEvents* events = &physicsScene->contactEvents;
+    const uint32_t claimed = JPH::min(events->claimedBuffers.load(std::memory_order_acquire), events->numBuffers);
+    events->lastContactPairs = 0;
+
+    for (uint32_t i = 0; i < claimed; i++) {
+        ContactEventBuffer* buffer = &events->buffers[i];
+        const uint32_t count = buffer->count.load(std::memory_order_acquire);
+
+        for (uint32_t j = 0; j < count; j++) {
+            RawContactEvent* raw = &buffer->events[j];
+            if (raw->type == CONTACT_REMOVED && !resolveRemovedContact(physicsScene, raw)) {
+                continue;
+            }
+
+            appendContactEvent(events, raw);
+        }
+
+        events->lastRawCount += count;
+        events->lastContactPairs += buffer->contactPairs;
+        buffer->count.store(0, std::memory_order_relaxed);
+        buffer->contactPairs = 0;
+
+        // resizing is only safe here, the callbacks index into a fixed size buffer
+        if (buffer->overflowed.load(std::memory_order_relaxed)) {
+            const size_t newSize = JPH::min(buffer->events.size() * 2, static_cast<size_t>(cMaxContactEventsPerThread));
+            buffer->events.resize(newSize);
+            buffer->overflowed.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    events->claimedBuffers.store(0, std::memory_order_relaxed);
+    events->epoch.fetch_add(1, std::memory_order_release);
+}
+
+void endContactEventFrame(ContactEvents* events) {
+    std::stable_sort(events->frameEvents.begin(), events->frameEvents.end(), [](const ContactEvent& a, const ContactEvent& b) {
+        return a.entityID < b.entityID;
+    });
+
+    events->lastDropped = events->dropped.exchange(0, std::memory_order_relaxed);
+}
+
+const ContactEvent* getContactEvents(const ContactEvents* events, uint32_t entityID, uint32_t* count) {
+    auto first = std::lower_bound(events->frameEvents.begin(), events->frameEvents.end(), entityID, [](const ContactEvent& event, uint32_t id) {
+        return event.entityID < id;
+    });
+
+    auto last = first;
+    while (last != events->frameEvents.end() && last->entityID == entityID) {
+        ++last;
+    }
+
+    *count = static_cast<uint32_t>(last - first);
+    return *count > 0 ? &*first : nullptr;
+}
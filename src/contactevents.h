@@ -0,0 +1,93 @@
+#pragma once
+#include <vector>
+#include <atomic>
+
+#include <Jolt/Jolt.h>
+#include <Jolt/Physics/Collision/ContactListener.h>
+
+#include "utils/mathutils.h"
+
+JPH_SUPPRESS_WARNINGS
+struct PhysicsScene;
+struct PhysicsLayers;
+
+constexpr uint32_t cMaxContactEventsPerThread = 65536;
+constexpr uint32_t cDefaultContactEventsPerThread = 1024;
+
+enum ContactEventType : uint8_t {
+    CONTACT_ADDED = 1 << 0,
+    CONTACT_PERSISTED = 1 << 1,
+    CONTACT_REMOVED = 1 << 2
+};
+
+// written from jolt's callbacks, removed contacts only carry body ids so entities are resolved when merging
+struct RawContactEvent {
+    ContactEventType type;
+    JPH::BodyID body1;
+    JPH::BodyID body2;
+    uint32_t entity1;
+    uint32_t entity2;
+    vec3 point;
+    vec3 normal;
+    float speed;
+};
+
+// every contact is stored twice, once for each entity, normal points from entityID towards otherEntityID and
+// speed is the approach speed along it when the contact was added
+struct ContactEvent {
+    ContactEventType type;
+    uint32_t entityID;
+    uint32_t otherEntityID;
+    vec3 point;
+    vec3 normal;
+    float speed;
+};
+
+// only the thread that claimed the buffer writes to it, the main thread reads it after Update returned
+struct ContactEventBuffer {
+    std::vector<RawContactEvent> events;
+    std::atomic<uint32_t> count{0};
+    std::atomic<bool> overflowed{false};
+    // every added or persisted manifold, counted before any filtering
+    uint32_t contactPairs = 0;
+};
+
+struct ContactEvents {
+    ContactEventBuffer* buffers = nullptr;
+    uint32_t numBuffers = 0;
+    std::atomic<uint32_t> claimedBuffers{0};
+    // bumped on every merge so threads claim a fresh buffer for the next step
+    std::atomic<uint32_t> epoch{0};
+    std::atomic<uint32_t> dropped{0};
+    uint32_t eventTypes = CONTACT_ADDED | CONTACT_REMOVED;
+
+    // sorted by entityID after each frame's steps, see getContactEvents
+    std::vector<ContactEvent> frameEvents;
+    uint32_t lastRawCount = 0;
+    uint32_t lastDropped = 0;
+    // touching body pairs in the last step
+    uint32_t lastContactPairs = 0;
+};
+
+class ContactEventListener : public JPH::ContactListener {
+   public:
+    ContactEventListener(const PhysicsLayers* layers, ContactEvents* events);
+    void OnContactAdded(const JPH::Body& inBody1, const JPH::Body& inBody2, const JPH::ContactManifold& inManifold, JPH::ContactSettings& ioSettings) override;
+    void OnContactPersisted(const JPH::Body& inBody1, const JPH::Body& inBody2, const JPH::ContactManifold& inManifold, JPH::ContactSettings& ioSettings) override;
+    void OnContactRemoved(const JPH::SubShapeIDPair& inSubShapePair) override;
+
+   private:
+    void pushContact(ContactEventType type, const JPH::Body& inBody1, const JPH::Body& inBody2, const JPH::ContactManifold& inManifold);
+    ContactEventBuffer* claimThreadBuffer();
+    void countContact();
+    void pushEvent(const RawContactEvent& event);
+    const PhysicsLayers* mLayers;
+    ContactEvents* mEvents;
+};
+
+void initContactEvents(ContactEvents* events, uint32_t numThreads);
+void destroyContactEvents(ContactEvents* events);
+void beginContactEventFrame(ContactEvents* events);
+void collectContactEvents(PhysicsScene* physicsScene);
+void endContactEventFrame(ContactEvents* events);
+const ContactEvent* getContactEvents(const ContactEvents* events, uint32_t entityID, uint32_t* count);
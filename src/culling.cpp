@@ -0,0 +1,134 @@
+#include <chrono>
+
+#include <Jolt/Math/Float4.h>
+
+#include "culling.h"
+#include "renderworld.h"
+
+// gribb/hartmann, near uses w + z so it holds for both the [-1, 1] and [0, 1] depth ranges our projections produce
+Frustum frustumFromMatrix(const mat4& viewProjection) {
+    mat4 rows = viewProjection.Transposed();
+    vec4 row0 = rows.GetColumn4(0);
+    vec4 row1 = rows.GetColumn4(1);
+    vec4 row2 = rows.GetColumn4(2);
+    vec4 row3 = rows.GetColumn4(3);
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0;
+    frustum.planes[1] = row3 - row0;
+    frustum.planes[2] = row3 + row1;
+    frustum.planes[3] = row3 - row1;
+    frustum.planes[4] = row3 + row2;
+    frustum.planes[5] = row3 - row2;
+    return frustum;
+}
+
+static const JPH::Float4* loadLanes(const std::vector<float>& values, uint32_t index) {
+    return reinterpret_cast<const JPH::Float4*>(&values[index]);
+}
+
+// four boxes per iteration, planes don't need normalizing since distance and radius scale together
+void cullBounds(const RenderBounds* bounds, uint32_t count, const Frustum* frustum, std::vector<uint32_t>* visible) {
+    vec4 planeX[6], planeY[6], planeZ[6], planeW[6];
+    vec4 absX[6], absY[6], absZ[6];
+
+    for (int p = 0; p < 6; p++) {
+        const vec4& plane = frustum->planes[p];
+        planeX[p] = vec4::sReplicate(plane.GetX());
+        planeY[p] = vec4::sReplicate(plane.GetY());
+        planeZ[p] = vec4::sReplicate(plane.GetZ());
+        planeW[p] = vec4::sReplicate(plane.GetW());
+        absX[p] = planeX[p].Abs();
+        absY[p] = planeY[p].Abs();
+        absZ[p] = planeZ[p].Abs();
+    }
+
+    for (uint32_t i = 0; i < count; i += 4) {
+        vec4 centerX = vec4::sLoadFloat4(loadLanes(bounds->centerX, i));
+        vec4 centerY = vec4::sLoadFloat4(loadLanes(bounds->centerY, i));
+        vec4 centerZ = vec4::sLoadFloat4(loadLanes(bounds->centerZ, i));
+        vec4 extentX = vec4::sLoadFloat4(loadLanes(bounds->extentX, i));
+        vec4 extentY = vec4::sLoadFloat4(loadLanes(bounds->extentY, i));
+        vec4 extentZ = vec4::sLoadFloat4(loadLanes(bounds->extentZ, i));
+        JPH::UVec4 outside = JPH::UVec4::sZero();
+
+        for (int p = 0; p < 6; p++) {
+            vec4 distance = vec4::sFusedMultiplyAdd(planeX[p], centerX, vec4::sFusedMultiplyAdd(planeY[p], centerY, vec4::sFusedMultiplyAdd(planeZ[p], centerZ, planeW[p])));
+            vec4 radius = vec4::sFusedMultiplyAdd(absX[p], extentX, vec4::sFusedMultiplyAdd(absY[p], extentY, absZ[p] * extentZ));
+            outside = JPH::UVec4::sOr(outside, vec4::sLess(distance, -radius));
+        }
+
+        const int outsideMask = outside.GetTrues();
+        const uint32_t lanes = JPH::min(count - i, 4u);
+        for (uint32_t lane = 0; lane < lanes; lane++) {
+            if ((outsideMask & (1 << lane)) == 0) {
+                visible->push_back(i + lane);
+            }
+        }
+    }
+}
+
+static void allVisible(uint32_t count, std::vector<uint32_t>* visible) {
+    for (uint32_t i = 0; i < count; i++) {
+        visible->push_back(i);
+    }
+}
+
+void cullRenderWorld(RenderWorld* world, const mat4& cameraViewProjection) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const uint32_t count = static_cast<uint32_t>(world->objects.size());
+    CullStats* stats = &world->cullStats;
+
+    world->cameraVisible.clear();
+    world->shadowVisible.clear();
+    stats->objects = count;
+    stats->shadowViews = 0;
+    stats->shadowTested = 0;
+
+    if (world->cullingEnabled) {
+        Frustum frustum = frustumFromMatrix(cameraViewProjection);
+        cullBounds(&world->bounds, count, &frustum, &world->cameraVisible);
+    } else {
+        allVisible(count, &world->cameraVisible);
+    }
+
+    for (RenderSpotLight& light : world->spotLights) {
+        light.firstVisible = static_cast<uint32_t>(world->shadowVisible.size());
+        if (light.shadowIndex >= 0) {
+            if (world->cullingEnabled) {
+                Frustum frustum = frustumFromMatrix(light.lightSpaceMatrix);
+                cullBounds(&world->bounds, count, &frustum, &world->shadowVisible);
+            } else {
+                allVisible(count, &world->shadowVisible);
+            }
+
+            stats->shadowViews++;
+            stats->shadowTested += count;
+        }
+        light.visibleCount = static_cast<uint32_t>(world->shadowVisible.size()) - light.firstVisible;
+    }
+
+    stats->cameraVisible = static_cast<uint32_t>(world->cameraVisible.size());
+    stats->shadowVisible = static_cast<uint32_t>(world->shadowVisible.size());
+    stats->cullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// slab test of the camera visible boxes against the cursor ray, only these can cover the picked pixel
+void cullPickRay(RenderWorld* world, vec3 origin, vec3 direction) {
+    const RenderBounds* bounds = &world->bounds;
+    const vec3 inverseDirection = vec3::sReplicate(1.0f) / direction;
+    world->pickVisible.clear();
+
+    for (uint32_t object : world->cameraVisible) {
+        vec3 center(bounds->centerX[object], bounds->centerY[object], bounds->centerZ[object]);
+        vec3 extent(bounds->extentX[object], bounds->extentY[object], bounds->extentZ[object]);
+        vec3 t0 = (center - extent - origin) * inverseDirection;
+        vec3 t1 = (center + extent - origin) * inverseDirection;
+        const float enter = vec3::sMin(t0, t1).ReduceMax();
+        const float leave = vec3::sMax(t0, t1).ReduceMin();
+
+        if (enter <= leave && leave >= 0.0f) {
+            world->pickVisible.push_back(object);
+        }
+    }
+}
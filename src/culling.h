@@ -0,0 +1,16 @@
+#pragma once
+#include <vector>
+#include "utils/mathutils.h"
+
+struct RenderWorld;
+struct RenderBounds;
+
+// planes point inwards, a box is outside once it is fully behind any of them
+struct Frustum {
+    vec4 planes[6];
+};
+
+Frustum frustumFromMatrix(const mat4& viewProjection);
+void cullBounds(const RenderBounds* bounds, uint32_t count, const Frustum* frustum, std::vector<uint32_t>* visible);
+void cullRenderWorld(RenderWorld* world, const mat4& cameraViewProjection);
+void cullPickRay(RenderWorld* world, vec3 origin, vec3 direction);
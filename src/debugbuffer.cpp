@@ -0,0 +1,160 @@
+#include <iostream>
+
+#include "debugbuffer.h"
+
+static void createDebugStore(DebugBuffer* debug, uint32_t capacity) {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr size = static_cast<GLsizeiptr>(capacity) * cDebugBufferFrames * sizeof(DebugVertex);
+
+    debug->capacity = capacity;
+    glCreateBuffers(1, &debug->buffer);
+    glNamedBufferStorage(debug->buffer, size, nullptr, flags);
+    debug->mapped = static_cast<DebugVertex*>(glMapNamedBufferRange(debug->buffer, 0, size, flags));
+    glVertexArrayVertexBuffer(debug->vao, 0, debug->buffer, 0, sizeof(DebugVertex));
+
+    if (debug->mapped == nullptr) {
+        std::cerr << "ERROR::RENDERER::DEBUG_BUFFER::Failed to map " << size << " bytes" << std::endl;
+    }
+}
+
+static void destroyDebugStore(DebugBuffer* debug) {
+    if (debug->buffer != 0) {
+        glUnmapNamedBuffer(debug->buffer);
+        glDeleteBuffers(1, &debug->buffer);
+    }
+
+    debug->buffer = 0;
+    debug->mapped = nullptr;
+}
+
+void createDebugBuffer(DebugBuffer* debug, uint32_t capacity) {
+    glCreateVertexArrays(1, &debug->vao);
+    glEnableVertexArrayAttrib(debug->vao, 0);
+    glVertexArrayAttribFormat(debug->vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(DebugVertex, position));
+    glVertexArrayAttribBinding(debug->vao, 0, 0);
+    glEnableVertexArrayAttrib(debug->vao, 1);
+    glVertexArrayAttribFormat(debug->vao, 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(DebugVertex, color));
+    glVertexArrayAttribBinding(debug->vao, 1, 0);
+
+    debug->frame = 0;
+    createDebugStore(debug, capacity);
+}
+
+void destroyDebugBuffer(DebugBuffer* debug) {
+    for (uint32_t i = 0; i < cDebugBufferFrames; i++) {
+        waitForFence(&debug->fences[i]);
+    }
+
+    destroyDebugStore(debug);
+    glDeleteVertexArrays(1, &debug->vao);
+    *debug = DebugBuffer();
+}
+
+static DebugVertex* getDebugRegion(DebugBuffer* debug) {
+    return debug->mapped + static_cast<size_t>(debug->frame) * debug->capacity;
+}
+
+// grows in the middle of a frame. what this frame already wrote is copied over on the gpu, coherent writes are
+// visible to the copy without a flush. the new store has nothing in flight so the old fences are simply dropped
+static void growDebugBuffer(DebugBuffer* debug, uint32_t required) {
+    uint32_t capacity = JPH::max(debug->capacity, cDefaultDebugVertexCapacity);
+    while (capacity < required) {
+        capacity *= 2;
+    }
+    capacity = JPH::min(capacity, cMaxDebugVertexCapacity);
+
+    const GLuint oldBuffer = debug->buffer;
+    const GLintptr oldRegion = static_cast<GLintptr>(debug->frame) * debug->capacity;
+    const uint32_t oldCapacity = debug->capacity;
+    debug->buffer = 0;
+
+    createDebugStore(debug, capacity);
+    const GLintptr region = static_cast<GLintptr>(debug->frame) * debug->capacity;
+    const GLsizeiptr stride = sizeof(DebugVertex);
+    glCopyNamedBufferSubData(oldBuffer, debug->buffer, oldRegion * stride, region * stride, debug->lineVertices * stride);
+    glCopyNamedBufferSubData(oldBuffer, debug->buffer, (oldRegion + oldCapacity - debug->triangleVertices) * stride, (region + capacity - debug->triangleVertices) * stride, debug->triangleVertices * stride);
+
+    glUnmapNamedBuffer(oldBuffer);
+    glDeleteBuffers(1, &oldBuffer);
+    for (uint32_t i = 0; i < cDebugBufferFrames; i++) {
+        if (debug->fences[i] != nullptr) {
+            glDeleteSync(debug->fences[i]);
+            debug->fences[i] = nullptr;
+        }
+    }
+    debug->stats.grows++;
+}
+
+static bool reserveDebugVertices(DebugBuffer* debug, uint32_t count) {
+    const uint32_t required = debug->lineVertices + debug->triangleVertices + count;
+    if (debug->mapped != nullptr && required <= debug->capacity) {
+        return true;
+    }
+
+    if (debug->mapped == nullptr || required > cMaxDebugVertexCapacity) {
+        debug->droppedVertices += count;
+        return false;
+    }
+
+    growDebugBuffer(debug, required);
+    return debug->mapped != nullptr;
+}
+
+// mapped memory is write only, every field is stored and nothing is read back
+static void writeDebugVertex(DebugVertex* vertex, vec3 position, JPH::Color color) {
+    vertex->position[0] = position.GetX();
+    vertex->position[1] = position.GetY();
+    vertex->position[2] = position.GetZ();
+    vertex->color = color;
+}
+
+void pushDebugLine(DebugBuffer* debug, vec3 from, vec3 to, JPH::Color color) {
+    if (!reserveDebugVertices(debug, 2)) {
+        return;
+    }
+
+    DebugVertex* vertex = getDebugRegion(debug) + debug->lineVertices;
+    writeDebugVertex(vertex, from, color);
+    writeDebugVertex(vertex + 1, to, color);
+    debug->lineVertices += 2;
+}
+
+void pushDebugTriangle(DebugBuffer* debug, vec3 v0, vec3 v1, vec3 v2, JPH::Color color) {
+    if (!reserveDebugVertices(debug, 3)) {
+        return;
+    }
+
+    debug->triangleVertices += 3;
+    DebugVertex* vertex = getDebugRegion(debug) + debug->capacity - debug->triangleVertices;
+    writeDebugVertex(vertex, v0, color);
+    writeDebugVertex(vertex + 1, v1, color);
+    writeDebugVertex(vertex + 2, v2, color);
+}
+
+void drawDebugBuffer(DebugBuffer* debug) {
+    const GLint region = static_cast<GLint>(debug->frame * debug->capacity);
+    glBindVertexArray(debug->vao);
+
+    if (debug->lineVertices > 0) {
+        glDrawArrays(GL_LINES, region, debug->lineVertices);
+    }
+
+    if (debug->triangleVertices > 0) {
+        glDrawArrays(GL_TRIANGLES, region + debug->capacity - debug->triangleVertices, debug->triangleVertices);
+    }
+}
+
+// fences the region that was just drawn and waits on the next one right away, everything drawn until the next
+// endDebugFrame goes straight into it
+void endDebugFrame(DebugBuffer* debug) {
+    debug->fences[debug->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    debug->frame = (debug->frame + 1) % cDebugBufferFrames;
+    waitForFence(&debug->fences[debug->frame]);
+
+    debug->stats.lines = debug->lineVertices / 2;
+    debug->stats.triangles = debug->triangleVertices / 3;
+    debug->stats.dropped = debug->droppedVertices;
+    debug->lineVertices = 0;
+    debug->triangleVertices = 0;
+    debug->droppedVertices = 0;
+}
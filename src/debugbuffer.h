@@ -0,0 +1,45 @@
+#pragma once
+#include "utils/mathutils.h"
+#include "instancebuffer.h"
+
+// fenced and cycled exactly like the instance buffer
+constexpr uint32_t cDebugBufferFrames = cInstanceBufferFrames;
+constexpr uint32_t cDefaultDebugVertexCapacity = 1 << 16;
+// a region never grows past this, vertices that don't fit are dropped and counted
+constexpr uint32_t cMaxDebugVertexCapacity = 1 << 22;
+
+struct DebugVertex {
+    float position[3];
+    JPH::Color color;
+};
+
+// counts are for the last finished frame, dropped is in vertices
+struct DebugBufferStats {
+    uint32_t lines = 0;
+    uint32_t triangles = 0;
+    uint32_t dropped = 0;
+    uint32_t grows = 0;
+};
+
+// persistently mapped vertex ring behind one vao. lines fill a region from the front and triangles from the back,
+// a region is full when they meet
+struct DebugBuffer {
+    GLuint vao = 0;
+    GLuint buffer = 0;
+    DebugVertex* mapped = nullptr;
+    // vertices per region
+    uint32_t capacity = 0;
+    uint32_t frame = 0;
+    uint32_t lineVertices = 0;
+    uint32_t triangleVertices = 0;
+    uint32_t droppedVertices = 0;
+    GLsync fences[cDebugBufferFrames] = {};
+    DebugBufferStats stats;
+};
+
+void createDebugBuffer(DebugBuffer* debug, uint32_t capacity);
+void destroyDebugBuffer(DebugBuffer* debug);
+void pushDebugLine(DebugBuffer* debug, vec3 from, vec3 to, JPH::Color color);
+void pushDebugTriangle(DebugBuffer* debug, vec3 v0, vec3 v1, vec3 v2, JPH::Color color);
+void drawDebugBuffer(DebugBuffer* debug);
+void endDebugFrame(DebugBuffer* debug);
@@ -223,19 +223,16 @@ void removeRigidbody(EntityGroup* scene, uint32_t entityID, JPH::BodyInterface*
         }
 
         if (bodyInterface != nullptr) {
+            JPH::ShapeRefC shape = bodyInterface->GetShape(rb->joltBody);
             bodyInterface->RemoveBody(rb->joltBody);
             bodyInterface->DestroyBody(rb->joltBody);
+            releaseCachedShape(shape.GetPtr());
         }
     }
 
     destroyComponent(scene->rigidbodies, scene->rigidbodyIndexMap, entityID);
 }
 void removeSpotLight(EntityGroup* scene, uint32_t entityID) {
-    SpotLight* spotLight = getSpotLight(scene, entityID);
-    if (spotLight != nullptr && spotLight->enableShadows) {
-        deleteSpotLightShadowMap(spotLight);
-    }
-
     destroyComponent(scene->spotLights, scene->spotLightIndexMap, entityID);
 }
 void removePointLight(EntityGroup* scene, uint32_t entityID) {
@@ -293,7 +290,8 @@ void destroyEntity(EntityGroup* entityGroup, uint32_t entityID, JPH::BodyInterfa
     destroyComponent(entityGroup->entities, entityGroup->entityIndexMap, entityID);
 }
 
-uint32_t createEntityFromModel(EntityGroup* scene, PhysicsScene* physicsScene, ModelNode* node, uint32_t parentEntityID, bool addColliders, uint32_t rootEntity, bool first, bool isDynamic) {
+// colliders are only added as components, the caller creates the bodies with addRigidbodies once the model is placed
+uint32_t createEntityFromModel(EntityGroup* scene, ModelNode* node, uint32_t parentEntityID, ColliderType colliders, uint32_t rootEntity, bool first, bool isDynamic, std::vector<uint32_t>* rigidbodyIDs) {
     uint32_t childEntity = getNewEntity(scene, node->name)->entityID;
     Entity* entity = getEntity(scene, childEntity);
 
@@ -311,33 +309,54 @@ uint32_t createEntityFromModel(EntityGroup* scene, PhysicsScene* physicsScene, M
         meshRenderer->mesh = node->mesh;
         meshRenderer->rootEntity = rootEntity;
 
-        if (addColliders) {
-            JPH::BoxShapeSettings floor_shape_settings(node->mesh->extent);
-            // floor_shape_settings.SetEmbedded();  // A ref counted object on the stack (base class RefTarget) should be marked as such to prevent it from being freed when its reference count goes to 0.
+        if (colliders != ColliderType::None) {
+            RigidBody* rb = addRigidbody(scene, childEntity);
+            rb->layer = isDynamic ? Layers::MOVING : Layers::NON_MOVING;
+            rb->motionType = isDynamic ? JPH::EMotionType::Dynamic : JPH::EMotionType::Static;
+            rb->halfExtents = node->mesh->extent;
+            rb->shape = JPH::EShapeSubType::Box;
+
+            if (colliders == ColliderType::Mesh && !isDynamic) {
+                rb->shape = JPH::EShapeSubType::Mesh;
+            } else if (colliders != ColliderType::Box) {
+                rb->shape = JPH::EShapeSubType::ConvexHull;
+            }
 
-            JPH::ShapeSettings::ShapeResult floor_shape_result = floor_shape_settings.Create();
-            JPH::ShapeRefC floor_shape = floor_shape_result.Get();  // We don't expect an error here, but you can check floor_shape_result for HasError() / GetError()
-            JPH::ObjectLayer layer = isDynamic ? Layers::MOVING : Layers::NON_MOVING;
-            JPH::EActivation shouldActivate = isDynamic ? JPH::EActivation::Activate : JPH::EActivation::DontActivate;
-            JPH::EMotionType motionType = isDynamic ? JPH::EMotionType::Dynamic : JPH::EMotionType::Static;
-            JPH::BodyCreationSettings floor_settings(floor_shape, getPosition(scene, childEntity), getRotation(scene, childEntity), motionType, layer);
-            JPH::Body* floor = physicsScene->bodyInterface->CreateBody(floor_settings);
-            physicsScene->bodyInterface->AddBody(floor->GetID(), shouldActivate);
+            if (rb->shape != JPH::EShapeSubType::Box) {
+                // import cooks with the model's own settings, a dynamic mesh collider falls back to a hull here
+                rb->cookedShape = node->colliderHash;
+                if (rb->cookedShape == 0 || (colliders == ColliderType::Mesh && isDynamic)) {
+                    vec3 scale;
+                    node->transform.Decompose(scale);
+                    rb->cookedShape = cookMeshCollider(node->mesh, ColliderType::ConvexHull, scale);
+                }
+            }
 
-            RigidBody* rb = addRigidbody(scene, childEntity);
-            rb->lastPosition = getPosition(scene, childEntity);
-            rb->lastRotation = getRotation(scene, childEntity);
-            rb->joltBody = floor->GetID();
+            rigidbodyIDs->push_back(childEntity);
         }
     }
 
     for (int i = 0; i < node->children.size(); i++) {
-        createEntityFromModel(scene, physicsScene, node->children[i], childEntity, addColliders, rootEntity, false, isDynamic);
+        createEntityFromModel(scene, node->children[i], childEntity, colliders, rootEntity, false, isDynamic, rigidbodyIDs);
     }
 
     return childEntity;
 }
 
+// one static body for the whole model, see cookModelCollider
+void addMergedModelCollider(EntityGroup* scene, Model* model, uint32_t rootEntity, std::vector<uint32_t>* rigidbodyIDs) {
+    if (model->mergedColliderHash == 0) {
+        return;
+    }
+
+    RigidBody* rb = addRigidbody(scene, rootEntity);
+    rb->layer = Layers::NON_MOVING;
+    rb->motionType = JPH::EMotionType::Static;
+    rb->shape = model->colliderType == ColliderType::Mesh ? JPH::EShapeSubType::Mesh : JPH::EShapeSubType::StaticCompound;
+    rb->cookedShape = model->mergedColliderHash;
+    rigidbodyIDs->push_back(rootEntity);
+}
+
 static uint32_t copyEntityInternal(Scene* scene, EntityCopier* copier, uint32_t parentID) {
     EntityGroup* templateGroup = copier->fromGroup;
     EntityGroup* newGroup = copier->toGroup;
@@ -377,7 +396,6 @@ static uint32_t copyEntityInternal(Scene* scene, EntityCopier* copier, uint32_t
     if (meshRenderer != nullptr) {
         MeshRenderer* newMeshRenderer = addMeshRenderer(newGroup, newEntityID);
         newMeshRenderer->boneMatrices = meshRenderer->boneMatrices;
-        newMeshRenderer->boneMatricesSet = false;
         newMeshRenderer->materials = meshRenderer->materials;
         newMeshRenderer->mesh = meshRenderer->mesh;
         newMeshRenderer->subMeshes = meshRenderer->subMeshes;
@@ -403,7 +421,8 @@ static uint32_t copyEntityInternal(Scene* scene, EntityCopier* copier, uint32_t
         newRB->center = rb->center;
         newRB->radius = rb->radius;
         newRB->rotationLocked = rb->rotationLocked;
-        initializeRigidbody(newRB, &scene->physicsScene, newGroup);
+        newRB->cookedShape = rb->cookedShape;
+        copier->rigidbodiesTemp.push_back(newRB->entityID);
     }
 
     if (pointLight != nullptr) {
@@ -426,9 +445,6 @@ static uint32_t copyEntityInternal(Scene* scene, EntityCopier* copier, uint32_t
         newLight->range = spotLight->range;
         newLight->shadowWidth = spotLight->shadowWidth;
         newLight->shadowHeight = spotLight->shadowHeight;
-        if (newLight->enableShadows) {
-            createSpotLightShadowMap(newLight);
-        }
     }
 
     if (camera != nullptr) {
@@ -476,6 +492,8 @@ uint32_t copyEntity(Scene* scene, EntityCopier* copier) {
         initializeAnimator(copier->toGroup, animator);
     }
 
+    addRigidbodies(&scene->physicsScene, copier->toGroup, copier->rigidbodiesTemp, JPH::EActivation::DontActivate);
+
     copier->meshRenderersTemp.clear();
     copier->animatorsTemp.clear();
     copier->rigidbodiesTemp.clear();
@@ -7,6 +7,7 @@
 // #include "physics.h"
 #include "meshrenderer.h"
 #include "physics.h"
+#include "meshcollider.h"
 
 constexpr uint32_t INVALID_ID = 0xFFFFFFFF;
 struct Player;
@@ -70,7 +71,8 @@ struct EntityCopier {
     std::vector<uint32_t> playersTemp;
 };
 
-uint32_t createEntityFromModel(EntityGroup* scene, PhysicsScene* physicsScene, ModelNode* node, uint32_t parentEntityID, bool addColliders, uint32_t rootEntity, bool first, bool isDynamic);
+uint32_t createEntityFromModel(EntityGroup* scene, ModelNode* node, uint32_t parentEntityID, ColliderType colliders, uint32_t rootEntity, bool first, bool isDynamic, std::vector<uint32_t>* rigidbodyIDs);
+void addMergedModelCollider(EntityGroup* scene, Model* model, uint32_t rootEntity, std::vector<uint32_t>* rigidbodyIDs);
 uint32_t getEntityID(EntityGroup* scene);
 Entity* getNewEntity(EntityGroup* scene, std::string name = "NewEntity", uint32_t id = -1, bool createTransform = true);
 
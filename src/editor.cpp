@@ -1,6 +1,7 @@
 #include <iostream>
 #include <filesystem>
 #include <fstream>
+#include <cstring>
 
 #include "utils/imgui.h"
 #include "utils/imgui_impl_glfw.h"
@@ -18,28 +19,25 @@
 static void createProjectTree(Scene* scene, EditorState* editor, ImGuiTreeNodeFlags node_flags, std::string directory);
 void ExportImGuiStyleSizes();
 
+// queues a pick at the cursor, the entity comes back through collectPick once the gpu has drawn it
 static void checkPicker(Scene* scene, RenderState* renderer, EditorState* editor) {
-    /* if (!editor->isPicking) {
-        return;
-    } */
-
-    EntityGroup* entities = &scene->entities;
     editor->isPicking = true;
-    unsigned char pixel[3];
-    glBindFramebuffer(GL_FRAMEBUFFER, renderer->pickingFBO);
-    // glReadPixels(pickPosition.x, renderer->windowData.height - pickPosition.y, 1, 1, GL_RGB, GL_UNSIGNED_BYTE, pixel);
+    GLint xPos = static_cast<GLint>(editor->cursorPos.x * renderer->windowData.viewportWidth);
+    GLint yPos = static_cast<GLint>((1.0f - editor->cursorPos.y) * renderer->windowData.viewportHeight);
+    requestPick(&renderer->picker, xPos, yPos);
+}
 
-    float xPos = editor->cursorPos.x * renderer->windowData.width;
-    float yPos = (1.0 - editor->cursorPos.y) * renderer->windowData.height;
-    glReadPixels(xPos, yPos, 1, 1, GL_RGB, GL_UNSIGNED_BYTE, pixel);
-    uint32_t id = pixel[0] + (pixel[1] << 8) + (pixel[2] << 16);
+static void collectPick(Scene* scene, RenderState* renderer, EditorState* editor) {
+    EntityGroup* entities = &scene->entities;
+    uint32_t id;
+    if (!pollPick(&renderer->picker, &id)) {
+        return;
+    }
 
     if (entities->entityIndexMap.count(id)) {
         editor->nodeClicked = id;
         scene->pickedEntity = id;
     }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 static void createEntityTree(Scene* scene, EditorState* editor, uint32_t entityID, ImGuiTreeNodeFlags node_flags, ImGuiSelectionBasicStorage& selection) {
@@ -270,14 +268,50 @@ static void buildSceneView(Scene* scene, RenderState* renderer, EditorState* edi
         if (ImGui::Button("Play", ImVec2(40, 20))) {
             editor->playing = true;
             writeTempScene(scene);
+            saveSceneSnapshot(scene, &editor->playSnapshot);
+            clearPhysicsHistory(&editor->physicsHistory);
         }
     } else if (editor->playing) {
         if (ImGui::Button("Stop", ImVec2(40, 20))) {
             editor->playing = false;
-            clearScene(scene);
-            loadTempScene(resources, scene);
+            clearPhysicsHistory(&editor->physicsHistory);
+
+            // the temp scene is only reparsed when the snapshot can't be restored
+            if (!restoreSceneSnapshot(scene, &editor->playSnapshot)) {
+                clearScene(scene);
+                loadTempScene(resources, scene);
+            }
         }
     }
+    const CullStats* cullStats = &renderer->world.cullStats;
+    ImGui::SameLine();
+    ImGui::Text("Visible: %u / %u, Shadow: %u / %u (%u views), Cull: %.3fms", cullStats->cameraVisible, cullStats->objects, cullStats->shadowVisible, cullStats->shadowTested, cullStats->shadowViews, cullStats->cullMs);
+    ImGui::SameLine();
+    ImGui::Checkbox("Culling", &renderer->world.cullingEnabled);
+    const LightClusterStats* clusterStats = &renderer->clusters.stats;
+    ImGui::Text("Lights: %u, Cluster entries: %u (max %u per cluster), Clusters: %.3fms", clusterStats->lights, clusterStats->entries, clusterStats->maxPerCluster, clusterStats->buildMs);
+    ShadowAtlas* shadowAtlas = &renderer->shadowAtlas;
+    const ShadowAtlasStats* shadowStats = &shadowAtlas->stats;
+    ImGui::Text("Shadow tiles: %u (%u dropped), Updates: %u (%u static, %u deferred), Schedule: %.3fms", shadowStats->tiles, shadowStats->dropped, shadowStats->updates, shadowStats->staticRedraws, shadowStats->deferred, shadowStats->scheduleMs);
+    ImGui::SameLine();
+    int shadowBudget = static_cast<int>(shadowAtlas->updateBudget);
+    ImGui::SetNextItemWidth(80.0f);
+    if (ImGui::DragInt("Shadow Budget", &shadowBudget, 0.1f, 0, static_cast<int>(cMaxShadowPasses))) {
+        shadowAtlas->updateBudget = static_cast<uint32_t>(shadowBudget);
+    }
+    const MeshBufferStats* meshStats = &renderer->meshes.stats;
+    ImGui::Text("Meshes: %u (%.2f MB vertices, %u defrags)", meshStats->meshes, meshStats->vertexBytes / (1024.0 * 1024.0), meshStats->defrags);
+    const RenderGraphStats* graphStats = &renderer->graph.stats;
+    ImGui::Text("Render graph: %u passes (%u culled), %u targets for %u resources, %.2f MB (%.2f MB unaliased)", graphStats->passes, graphStats->culled, graphStats->textures, graphStats->resources, graphStats->bytes / (1024.0 * 1024.0), graphStats->unaliasedBytes / (1024.0 * 1024.0));
+    const DebugBufferStats* debugStats = &static_cast<MyDebugRenderer*>(renderer->debugRenderer)->buffer.stats;
+    ImGui::Text("Debug draw: %u lines, %u triangles (%u vertices dropped, %u grows)", debugStats->lines, debugStats->triangles, debugStats->dropped, debugStats->grows);
+    const RenderStats* renderStats = &renderer->stats;
+    ImGui::Text("Draws: %u (%u instances, %u submits), Programs: %u, Textures: %u, VAOs: %u, Material uploads: %u, Sort: %.3fms", renderStats->draws, renderStats->instances, renderStats->submits, renderStats->programBinds, renderStats->textureBinds, renderStats->vaoBinds, renderStats->materialUploads, renderStats->sortMs);
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Log Render Stats")) {
+        writeRenderStats(renderStats, std::cout);
+        std::cout << std::endl;
+    }
     ImGui::Separator();
     ImVec2 availableSize = ImGui::GetContentRegionAvail();
 
@@ -322,9 +356,16 @@ static void buildSceneView(Scene* scene, RenderState* renderer, EditorState* edi
 
             } else if (extension == ".gltf") {
                 Model* prefab = resources->modelMap[fileDragged];
-                id = createEntityFromModel(&scene->entities, &scene->physicsScene, prefab->rootNode, INVALID_ID, false, INVALID_ID, true, false);
+                std::vector<uint32_t> rigidbodyIDs;
+                ColliderType nodeColliders = prefab->mergeStaticColliders ? ColliderType::None : prefab->colliderType;
+                id = createEntityFromModel(&scene->entities, prefab->rootNode, INVALID_ID, nodeColliders, INVALID_ID, true, false, &rigidbodyIDs);
+                if (prefab->mergeStaticColliders) {
+                    addMergedModelCollider(entities, prefab, id, &rigidbodyIDs);
+                }
+
                 vec3 pos = getPosition(entities, entities->cameras[0].entityID) + (editor->worldPos * 2.0f);
                 setPosition(entities, id, pos);
+                addRigidbodies(&scene->physicsScene, entities, rigidbodyIDs, JPH::EActivation::DontActivate);
             }
         }
 
@@ -489,6 +530,172 @@ static void buildEnvironmentSettings(RenderState* renderer, EditorState* editor,
     ImGui::End();
 }
 
+static void buildPhysicsLayers(PhysicsScene* physicsScene) {
+    if (!ImGui::CollapsingHeader("Layers")) {
+        return;
+    }
+
+    PhysicsLayers* layers = &physicsScene->layers;
+
+    for (uint32_t i = 0; i < layers->numLayers; i++) {
+        ImGui::PushID(i);
+        char nameBuffer[64];
+        strncpy(nameBuffer, layers->names[i].c_str(), sizeof(nameBuffer) - 1);
+        nameBuffer[sizeof(nameBuffer) - 1] = '\0';
+        ImGui::SetNextItemWidth(150.0f);
+
+        // names end up as scene file tokens so keep them to characters the tokenizer accepts
+        if (ImGui::InputText("##LayerName", nameBuffer, sizeof(nameBuffer), ImGuiInputTextFlags_CharsUppercase | ImGuiInputTextFlags_CharsNoBlank)) {
+            std::string name = nameBuffer;
+            for (char& c : name) {
+                if (!std::isalnum(static_cast<unsigned char>(c))) {
+                    c = '_';
+                }
+            }
+
+            if (!name.empty()) {
+                layers->names[i] = name;
+            }
+        }
+
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(120.0f);
+        if (ImGui::BeginCombo("##BroadPhase", getBroadPhaseLayerName(layers->broadPhaseLayers[i]))) {
+            for (JPH::uint j = 0; j < BroadPhaseLayers::NUM_LAYERS; j++) {
+                JPH::BroadPhaseLayer broadPhaseLayer(static_cast<JPH::BroadPhaseLayer::Type>(j));
+                if (ImGui::Selectable(getBroadPhaseLayerName(broadPhaseLayer), broadPhaseLayer == layers->broadPhaseLayers[i])) {
+                    setLayerBroadPhase(physicsScene, static_cast<JPH::ObjectLayer>(i), broadPhaseLayer);
+                }
+            }
+
+            ImGui::EndCombo();
+        }
+
+        ImGui::SameLine();
+        ImGui::Checkbox("Contact Events", &layers->contactEvents[i]);
+
+        ImGui::PopID();
+    }
+
+    if (layers->numLayers < cMaxObjectLayers && ImGui::Button("Add Layer")) {
+        addPhysicsLayer(layers, "LAYER" + std::to_string(layers->numLayers), BroadPhaseLayers::MOVING);
+        updateBroadPhaseMasks(layers);
+    }
+
+    ImGui::Separator();
+    ImGui::Text("Collision Matrix");
+    if (ImGui::BeginTable("Collision Matrix", layers->numLayers + 1, ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_Borders)) {
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        for (uint32_t j = 0; j < layers->numLayers; j++) {
+            ImGui::TableSetColumnIndex(j + 1);
+            ImGui::Text("%u", j);
+        }
+
+        for (uint32_t i = 0; i < layers->numLayers; i++) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%u %s", i, layers->names[i].c_str());
+
+            for (uint32_t j = 0; j <= i; j++) {
+                ImGui::TableSetColumnIndex(j + 1);
+                ImGui::PushID(i * cMaxObjectLayers + j);
+                bool collide = layersCollide(layers, i, j);
+                if (ImGui::Checkbox("##Collide", &collide)) {
+                    setLayersCollide(layers, i, j, collide);
+                }
+                ImGui::PopID();
+            }
+        }
+
+        ImGui::EndTable();
+    }
+}
+
+static void buildPhysicsSettings(Scene* scene, EditorState* editor) {
+    PhysicsScene* physicsScene = &scene->physicsScene;
+    PhysicsStepStats* stats = &physicsScene->stepStats;
+    ImGui::Begin("Physics");
+    ImGui::DragInt("Max Sub Steps", &physicsScene->maxSubSteps, 0.1f, 1, 16);
+    ImGui::DragInt("Max Collision Steps", &physicsScene->maxCollisionSteps, 0.1f, 1, 16);
+    float maxAccumulatedTime = static_cast<float>(physicsScene->maxAccumulatedTime);
+    if (ImGui::DragFloat("Max Accumulated Time", &maxAccumulatedTime, 0.001f, static_cast<float>(cDeltaTime), 1.0f)) {
+        physicsScene->maxAccumulatedTime = maxAccumulatedTime;
+    }
+
+    ImGui::Separator();
+    ImGui::Text("Steps this frame: %u (%u collision steps)", stats->stepsThisFrame, stats->collisionStepsThisFrame);
+    ImGui::Text("Max steps per frame: %u", stats->maxStepsPerFrame);
+    ImGui::Text("Total steps: %llu", static_cast<unsigned long long>(stats->totalSteps));
+    ImGui::Text("Dropped this frame: %.2f ms", stats->droppedTime * 1000.0);
+    ImGui::Text("Total dropped: %.3f s", stats->totalDroppedTime);
+
+    PhysicsProfile* profile = &physicsScene->profile;
+    ImGui::Separator();
+    ImGui::Checkbox("Profile Phases", &profile->enabled);
+    ImGui::SameLine();
+    ImGui::Checkbox("Auto Size Temp Allocator", &profile->autoSizeTempAllocator);
+    ImGui::Text("Step: %.3f ms, sync: %.3f ms, interpolate: %.3f ms", profile->stepMs, profile->syncMs, profile->interpolateMs);
+    if (profile->enabled) {
+        for (int i = 0; i < PHASE_COUNT; i++) {
+            ImGui::Text("  %s: %.3f ms", getPhysicsPhaseName(static_cast<PhysicsPhase>(i)), profile->phaseMs[i]);
+        }
+    }
+
+    ImGui::Text("Temp allocator: %.2f / %.2f MB (peak ever %.2f MB)", profile->tempPeakBytes / (1024.0 * 1024.0), profile->tempAllocatorSize / (1024.0 * 1024.0), profile->tempPeakBytesEver / (1024.0 * 1024.0));
+    if (profile->totalTempFallbacks > 0) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Temp allocator heap fallbacks: %u this frame, %u total", profile->tempFallbacks, profile->totalTempFallbacks);
+    }
+
+    ImGui::Text("Bodies: %u (%u active, %u static, %u dynamic, %u kinematic)", profile->numBodies, profile->numActiveBodies, profile->numStaticBodies, profile->numDynamicBodies, profile->numKinematicBodies);
+    ImGui::Text("Contact pairs: %u, constraints: %u", profile->numContactPairs, profile->numConstraints);
+#ifdef JPH_PROFILE_ENABLED
+    if (ImGui::Button("Dump Jolt Profile")) {
+        JPH_PROFILE_DUMP("physics");
+    }
+#endif
+
+    const PhysicsLoadStats* loadStats = &physicsScene->loadStats;
+    ImGui::Separator();
+    ImGui::Text("Last body batch: %u bodies in %.2f ms%s", loadStats->lastBatchSize, loadStats->lastBatchMs, loadStats->broadPhaseOptimized ? " (broadphase optimized)" : "");
+    ImGui::Text("Load to first step: %.2f ms", loadStats->loadToFirstStepMs);
+
+    ImGui::Text("Queries last flush: %u in %.3f ms", physicsScene->queries.lastFlushCount, physicsScene->queries.lastFlushMs);
+
+    const ShapeCache* shapeCache = getShapeCache();
+    ImGui::Separator();
+    ImGui::Text("Cached shapes: %zu", shapeCache->shapes.size());
+    ImGui::Text("Shape cache hits/misses: %llu / %llu", static_cast<unsigned long long>(shapeCache->hits), static_cast<unsigned long long>(shapeCache->misses));
+
+    const CookedShapeCache* cookedShapes = getCookedShapeCache();
+    ImGui::Text("Cooked shapes: %zu", cookedShapes->shapes.size());
+    ImGui::Text("Cooked: %u (%.2f ms)", cookedShapes->cooked, cookedShapes->cookMs);
+    ImGui::Text("Loaded from disk: %u (%.2f ms)", cookedShapes->loadedFromDisk, cookedShapes->loadMs);
+
+    ContactEvents* contactEvents = &physicsScene->contactEvents;
+    ImGui::Separator();
+    ImGui::CheckboxFlags("Contact Added", &contactEvents->eventTypes, CONTACT_ADDED);
+    ImGui::SameLine();
+    ImGui::CheckboxFlags("Persisted", &contactEvents->eventTypes, CONTACT_PERSISTED);
+    ImGui::SameLine();
+    ImGui::CheckboxFlags("Removed", &contactEvents->eventTypes, CONTACT_REMOVED);
+    ImGui::Text("Contact events this frame: %u (%zu entity events)", contactEvents->lastRawCount, contactEvents->frameEvents.size());
+    ImGui::Text("Contact events dropped: %u", contactEvents->lastDropped);
+
+    PhysicsHistory* history = &editor->physicsHistory;
+    ImGui::Separator();
+    ImGui::Checkbox("Record History", &history->enabled);
+    ImGui::SameLine();
+    ImGui::Text("%u / %zu frames", history->count, history->frames.size());
+    ImGui::DragInt("Rewind Frames", &editor->rewindFrames, 1.0f, 1, static_cast<int>(history->frames.size()));
+    if (ImGui::Button("Rewind") && editor->playing) {
+        rewindPhysicsFrames(scene, history, static_cast<uint32_t>(editor->rewindFrames));
+    }
+
+    buildPhysicsLayers(physicsScene);
+    ImGui::End();
+}
+
 static bool checkFilenameUnique(std::string path, std::string filename) {
     for (const std::filesystem::directory_entry& dir : std::filesystem::directory_iterator(path)) {
         if (dir.is_regular_file()) {
@@ -519,6 +726,7 @@ void updateAndDrawEditor(Scene* scene, RenderState* renderer, Resources* resourc
     buildProjectFiles(scene, resources, editor);
     buildInspector(scene, resources, renderer, editor);
     buildEnvironmentSettings(renderer, editor, scene);
+    buildPhysicsSettings(scene, editor);
 
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -586,6 +794,8 @@ static void pickingUpdate(Scene* scene, EditorState* editor, RenderState* render
 }
 
 void updateEditor(Scene* scene, Resources* resources, RenderState* renderer, EditorState* editor) {
+    collectPick(scene, renderer, editor);
+
     switch (editor->editorMode) {
         case Default:
             defaultUpdate(scene, resources, renderer, editor);
@@ -600,6 +810,7 @@ void updateEditor(Scene* scene, Resources* resources, RenderState* renderer, Edi
 }
 
 void initEditor(EditorState* editor, GLFWwindow* window) {
+    initPhysicsHistory(&editor->physicsHistory, 120);
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO();
@@ -6,6 +6,7 @@
 #include "utils/mathutils.h"
 #include "physics.h"
 #include "ecs.h"
+#include "snapshot.h"
 
 struct Scene;
 struct Resources;
@@ -61,6 +62,10 @@ struct EditorState {
     std::string fileDragged = "";
 
     std::unordered_set<uint32_t> selectedEntities;
+
+    SceneSnapshot playSnapshot;
+    PhysicsHistory physicsHistory;
+    int rewindFrames = 60;
 };
 
 void initEditor(EditorState* editor, GLFWwindow* window);
@@ -35,12 +35,12 @@ bool buildFloatRow(std::string label, float* value, float speed = 0.01f, float m
     return ImGui::DragFloat(("##" + label).c_str(), value, speed, min, max);
 }
 
-void buildFloat2Row(std::string label, float* value, float speed = 0.01f, float min = 0.0f, float max = 0.0f) {
+bool buildFloat2Row(std::string label, float* value, float speed = 0.01f, float min = 0.0f, float max = 0.0f) {
     ImGui::TableNextRow();
     ImGui::TableSetColumnIndex(0);
     ImGui::Text(label.c_str());
     ImGui::TableSetColumnIndex(1);
-    ImGui::DragFloat2(("##" + label).c_str(), value, speed, min, max);
+    return ImGui::DragFloat2(("##" + label).c_str(), value, speed, min, max);
 }
 
 bool buildFloat3Row(std::string label, float* value, float speed = 0.01f, float min = 0.0f, float max = 0.0f) {
@@ -67,34 +67,38 @@ void buildColor4Row(std::string label, float* value, ImGuiColorEditFlags flags)
     ImGui::ColorEdit4(("##" + label).c_str(), value, flags);
 }
 
-void buildTextureMapRow(Resources* resources, std::string label, Texture* tex, float* value, float max = 1.0f, bool color = false) {
+bool buildTextureMapRow(Resources* resources, std::string label, Texture** tex, float* value, float max = 1.0f, bool color = false) {
+    bool changed = false;
     ImGui::TableNextRow();
     ImGui::TableSetColumnIndex(0);
     ImGui::Text(label.c_str());
     ImGui::TableSetColumnIndex(1);
-    if (ImGui::BeginCombo(("##" + label).c_str(), tex->name.c_str())) {
+    if (ImGui::BeginCombo(("##" + label).c_str(), (*tex)->name.c_str())) {
         const bool isSelected = false;
 
         for (auto& pair : resources->textureMap) {
             ImGui::Image((ImTextureID)(intptr_t)pair.second->id, ImVec2(20, 20));
             ImGui::SameLine();
             if (ImGui::Selectable(pair.first.c_str(), isSelected)) {
-                tex = pair.second;
+                *tex = pair.second;
+                changed = true;
             }
         }
 
         ImGui::EndCombo();
     }
     ImGui::SameLine();
-    ImGui::Image((ImTextureID)(intptr_t)tex->id, ImVec2(20, 20));
+    ImGui::Image((ImTextureID)(intptr_t)(*tex)->id, ImVec2(20, 20));
 
     if (color) {
         ImGui::TableSetColumnIndex(2);
-        ImGui::ColorEdit4(("##" + label + "color").c_str(), value, ImGuiColorEditFlags_HDR);
+        changed |= ImGui::ColorEdit4(("##" + label + "color").c_str(), value, ImGuiColorEditFlags_HDR);
     } else {
         ImGui::TableSetColumnIndex(2);
-        ImGui::DragFloat(("##max" + label).c_str(), value, 0.001f, 0.0f, max);
+        changed |= ImGui::DragFloat(("##max" + label).c_str(), value, 0.001f, 0.0f, max);
     }
+
+    return changed;
 }
 
 Material* buildMaterialInspector(Resources* resources, Material* material, bool forMesh) {
@@ -116,12 +120,17 @@ Material* buildMaterialInspector(Resources* resources, Material* material, bool
         }
     }
 
-    buildTextureMapRow(resources, "Albedo", material->textures[0], material->baseColor.mF32, 1.0f, true);
-    buildTextureMapRow(resources, "Roughness", material->textures[1], &material->roughness);
-    buildTextureMapRow(resources, "Metalness", material->textures[2], &material->metalness);
-    buildTextureMapRow(resources, "AO", material->textures[3], &material->aoStrength);
-    buildTextureMapRow(resources, "Normal", material->textures[4], &material->normalStrength, 0.0f);
-    buildFloat2Row("Tiling", glm::value_ptr(material->textureTiling), 0.001f);
+    // only an edit marks the material, so the table rewrites this one slot
+    bool changed = false;
+    changed |= buildTextureMapRow(resources, "Albedo", &material->textures[0], material->baseColor.mF32, 1.0f, true);
+    changed |= buildTextureMapRow(resources, "Roughness", &material->textures[1], &material->roughness);
+    changed |= buildTextureMapRow(resources, "Metalness", &material->textures[2], &material->metalness);
+    changed |= buildTextureMapRow(resources, "AO", &material->textures[3], &material->aoStrength);
+    changed |= buildTextureMapRow(resources, "Normal", &material->textures[4], &material->normalStrength, 0.0f);
+    changed |= buildFloat2Row("Tiling", glm::value_ptr(material->textureTiling), 0.001f);
+    if (changed) {
+        material->dirty = true;
+    }
     return material;
 }
 
@@ -263,6 +272,7 @@ void buildRigidbodyInspector(Scene* scene, RenderState* renderer, EditorState* e
 
     float radius = 0.5f;
     float halfHeight = 0.5f;
+    bool shapeChanged = false;
     std::string shapeComboPreview = "NULL";
     std::vector<std::string> shapes;
     shapes.push_back("Box");
@@ -319,6 +329,15 @@ void buildRigidbodyInspector(Scene* scene, RenderState* renderer, EditorState* e
                     renderer->debugRenderer->DrawCylinder(bodyInterface->GetWorldTransform(rigidbody->joltBody), halfHeight, radius, color, JPH::DebugRenderer::ECastShadow::Off, JPH::DebugRenderer::EDrawMode::Wireframe);
                     break;
                 }
+                case JPH::EShapeSubType::ConvexHull:
+                case JPH::EShapeSubType::Mesh:
+                case JPH::EShapeSubType::StaticCompound: {
+                    // cooked shapes can't be edited, only swapped for a primitive
+                    shapeComboPreview = shapeType == JPH::EShapeSubType::Mesh ? "Mesh" : shapeType == JPH::EShapeSubType::ConvexHull ? "Convex Hull" : "Compound";
+                    localBox = shape->GetLocalBounds();
+                    renderer->debugRenderer->DrawBox(bodyInterface->GetWorldTransform(rigidbody->joltBody), localBox, color, JPH::DebugRenderer::ECastShadow::Off, JPH::DebugRenderer::EDrawMode::Wireframe);
+                    break;
+                }
             }
 
             ImGui::TableNextRow();
@@ -333,28 +352,24 @@ void buildRigidbodyInspector(Scene* scene, RenderState* renderer, EditorState* e
                         if (ImGui::Selectable(shape.c_str(), isSelected)) {
                             if (shape == "Box") {
                                 vec3 newExtent = vec3(0.5f, 0.5f, 0.5f);
-                                JPH::BoxShapeSettings boxShapeSettings(newExtent);
-                                JPH::ShapeSettings::ShapeResult boxResult = boxShapeSettings.Create();
-                                JPH::ShapeRefC boxShape = boxResult.Get();
+                                JPH::ShapeRefC boxShape = getCachedBoxShape(newExtent);
                                 bodyInterface->SetShape(rigidbody->joltBody, boxShape, false, JPH::EActivation::DontActivate);
+                                shapeChanged = true;
                                 shapeType = JPH::EShapeSubType::Box;
                             } else if (shape == "Sphere") {
-                                JPH::SphereShapeSettings sphereShapeSettings(0.5f);
-                                JPH::ShapeSettings::ShapeResult sphereResult = sphereShapeSettings.Create();
-                                JPH::ShapeRefC sphereShape = sphereResult.Get();
+                                JPH::ShapeRefC sphereShape = getCachedShape(JPH::EShapeSubType::Sphere, vec3::sZero(), 0.0f, 0.5f);
                                 bodyInterface->SetShape(rigidbody->joltBody, sphereShape, false, JPH::EActivation::DontActivate);
+                                shapeChanged = true;
                                 shapeType = JPH::EShapeSubType::Sphere;
                             } else if (shape == "Capsule") {
-                                JPH::CapsuleShapeSettings capsuleShapeSettings(0.5f, 0.5f);
-                                JPH::ShapeSettings::ShapeResult capsuleResult = capsuleShapeSettings.Create();
-                                JPH::ShapeRefC capsuleShape = capsuleResult.Get();
+                                JPH::ShapeRefC capsuleShape = getCachedShape(JPH::EShapeSubType::Capsule, vec3::sZero(), 0.5f, 0.5f);
                                 bodyInterface->SetShape(rigidbody->joltBody, capsuleShape, false, JPH::EActivation::DontActivate);
+                                shapeChanged = true;
                                 shapeType = JPH::EShapeSubType::Capsule;
                             } else if (shape == "Cylinder") {
-                                JPH::CylinderShapeSettings cylinderShapeSettings(0.5f, 0.5f);
-                                JPH::ShapeSettings::ShapeResult cylinderResult = cylinderShapeSettings.Create();
-                                JPH::ShapeRefC cylinderShape = cylinderResult.Get();
+                                JPH::ShapeRefC cylinderShape = getCachedShape(JPH::EShapeSubType::Cylinder, vec3::sZero(), 0.5f, 0.5f);
                                 bodyInterface->SetShape(rigidbody->joltBody, cylinderShape, false, JPH::EActivation::DontActivate);
+                                shapeChanged = true;
                                 shapeType = JPH::EShapeSubType::Cylinder;
                             }
                         }
@@ -375,31 +390,27 @@ void buildRigidbodyInspector(Scene* scene, RenderState* renderer, EditorState* e
             if (shapeType == JPH::EShapeSubType::Box) {
                 if (buildFloat3Row("Half Extents: ", halfExtents.mF32, 0.01f, 0.1f)) {
                     vec3 newExtent = vec3(std::max(halfExtents.GetX(), 0.0f), std::max(halfExtents.GetY(), 0.0f), std::max(halfExtents.GetZ(), 0.0f));
-                    JPH::BoxShapeSettings boxShapeSettings(newExtent);
-                    JPH::ShapeSettings::ShapeResult boxResult = boxShapeSettings.Create();
-                    JPH::ShapeRefC boxShape = boxResult.Get();
+                    JPH::ShapeRefC boxShape = getCachedBoxShape(newExtent);
                     bodyInterface->SetShape(rigidbody->joltBody, boxShape, false, JPH::EActivation::DontActivate);
+                    shapeChanged = true;
                 }
             } else if (shapeType == JPH::EShapeSubType::Sphere) {
                 if (buildFloatRow("Radius: ", &radius, 0.01f, 0.1f)) {
-                    JPH::SphereShapeSettings sphereShapeSettings(radius);
-                    JPH::ShapeSettings::ShapeResult sphereResult = sphereShapeSettings.Create();
-                    JPH::ShapeRefC sphereShape = sphereResult.Get();
+                    JPH::ShapeRefC sphereShape = getCachedShape(JPH::EShapeSubType::Sphere, vec3::sZero(), 0.0f, radius);
                     bodyInterface->SetShape(rigidbody->joltBody, sphereShape, false, JPH::EActivation::DontActivate);
+                    shapeChanged = true;
                 }
             } else if (shapeType == JPH::EShapeSubType::Capsule) {
                 if (buildFloatRow("Half Height: ", &halfHeight, 0.01f, 0.1f) || buildFloatRow("Radius: ", &radius, 0.01f, 0.1f)) {
-                    JPH::CapsuleShapeSettings capsuleShapeSettings(halfHeight, radius);
-                    JPH::ShapeSettings::ShapeResult capsuleResult = capsuleShapeSettings.Create();
-                    JPH::ShapeRefC capsuleShape = capsuleResult.Get();
+                    JPH::ShapeRefC capsuleShape = getCachedShape(JPH::EShapeSubType::Capsule, vec3::sZero(), halfHeight, radius);
                     bodyInterface->SetShape(rigidbody->joltBody, capsuleShape, false, JPH::EActivation::DontActivate);
+                    shapeChanged = true;
                 }
             } else if (shapeType == JPH::EShapeSubType::Cylinder) {
                 if (buildFloatRow("Half Height: ", &halfHeight, 0.01f, 0.1f) || buildFloatRow("Radius: ", &radius, 0.01f, 0.1f)) {
-                    JPH::CylinderShapeSettings cylinderShapeSettings(halfHeight, radius);
-                    JPH::ShapeSettings::ShapeResult cylinderResult = cylinderShapeSettings.Create();
-                    JPH::ShapeRefC cylinderShape = cylinderResult.Get();
+                    JPH::ShapeRefC cylinderShape = getCachedShape(JPH::EShapeSubType::Cylinder, vec3::sZero(), halfHeight, radius);
                     bodyInterface->SetShape(rigidbody->joltBody, cylinderShape, false, JPH::EActivation::DontActivate);
+                    shapeChanged = true;
                 }
             }
 
@@ -454,6 +465,24 @@ void buildRigidbodyInspector(Scene* scene, RenderState* renderer, EditorState* e
                 ImGui::EndCombo();
             }
 
+            PhysicsLayers* layers = &scene->physicsScene.layers;
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("Layer");
+            ImGui::TableSetColumnIndex(1);
+
+            const char* layerPreview = objectLayer < layers->numLayers ? layers->names[objectLayer].c_str() : "INVALID";
+            if (ImGui::BeginCombo("##Layer", layerPreview)) {
+                for (uint32_t i = 0; i < layers->numLayers; i++) {
+                    if (ImGui::Selectable(layers->names[i].c_str(), i == objectLayer)) {
+                        objectLayer = static_cast<JPH::ObjectLayer>(i);
+                        bodyInterface->SetObjectLayer(rigidbody->joltBody, objectLayer);
+                    }
+                }
+
+                ImGui::EndCombo();
+            }
+
             rigidbody->motionType = motionType;
             rigidbody->shape = shapeType;
             rigidbody->halfExtents = halfExtents;
@@ -463,6 +492,10 @@ void buildRigidbodyInspector(Scene* scene, RenderState* renderer, EditorState* e
             ImGui::EndTable();
         }
     }
+
+    if (shapeChanged) {
+        releaseUnusedShapes();
+    }
 }
 
 void buildPointLightInspector(Scene* scene, PointLight* light) {
@@ -492,7 +525,7 @@ void buildPointLightInspector(Scene* scene, PointLight* light) {
     }
 }
 
-void buildSpotLightInspector(Scene* scene, SpotLight* spotLight) {
+void buildSpotLightInspector(Scene* scene, RenderState* renderer, SpotLight* spotLight) {
     bool isOpen = ImGui::CollapsingHeader("Spot Light", ImGuiTreeNodeFlags_DefaultOpen);
     if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Right)) {
         ImGui::OpenPopup("SpotLightContextMenu");
@@ -519,16 +552,17 @@ void buildSpotLightInspector(Scene* scene, SpotLight* spotLight) {
             buildFloatRow("Range", &spotLight->range);
             buildFloatRow("Light Radius UV", &spotLight->lightRadiusUV, 0.0001f, 0.0f, 180.0f);
             buildFloatRow("Blocker Search UV", &spotLight->blockerSearchUV, 0.0001f, 0.0f, 180.0f);
-            if (buildBoolRow("Shadows", &spotLight->enableShadows)) {
-                if (spotLight->enableShadows) {
-                    createSpotLightShadowMap(spotLight);
-                } else {
-                    deleteSpotLightShadowMap(spotLight);
-                }
-            }
-
-            if (spotLight->enableShadows && ImGui::CollapsingHeader("Shadow Map")) {
-                ImGui::Image((ImTextureID)(intptr_t)spotLight->depthTex, ImVec2(200, 200));
+            buildBoolRow("Shadows", &spotLight->enableShadows);
+
+            // the tile is whatever the atlas handed out last frame, lights without one show nothing
+            auto tile = renderer->shadowAtlas.tiles.find(spotLight->entityID);
+            if (spotLight->enableShadows && tile != renderer->shadowAtlas.tiles.end() && ImGui::CollapsingHeader("Shadow Map")) {
+                GLint x, y;
+                GLsizei size;
+                getShadowTileRect(tile->second.sizeClass, tile->second.slot, &x, &y, &size);
+                const float atlasSize = static_cast<float>(cShadowAtlasSize);
+                ImGui::Text("%dx%d tile", size, size);
+                ImGui::Image((ImTextureID)(intptr_t)renderer->shadowAtlas.blurTex, ImVec2(200, 200), ImVec2(x / atlasSize, y / atlasSize), ImVec2((x + size) / atlasSize, (y + size) / atlasSize));
             }
 
             ImGui::EndTable();
@@ -536,7 +570,7 @@ void buildSpotLightInspector(Scene* scene, SpotLight* spotLight) {
     }
 }
 
-void buildTextureInspector(Resources* resources, EditorState* editor) {
+void buildTextureInspector(Resources* resources, RenderState* renderer, EditorState* editor) {
     std::string extension = editor->fileClicked.substr(editor->fileClicked.find_last_of('.'));
     std::string fileName = editor->fileClicked.substr(editor->fileClicked.find_last_of('\\'));
     std::string name = fileName.substr(1);
@@ -578,6 +612,7 @@ void buildTextureInspector(Resources* resources, EditorState* editor) {
         ImGui::TableNextRow();
         ImGui::TableSetColumnIndex(0);
         if (ImGui::Button("Apply", ImVec2(40.0f, 25.0f))) {
+            releaseTextureRef(&renderer->materials, resources, resources->textureMap[name]);
             glDeleteTextures(1, &resources->textureMap[name]->id);
             resources->textureMap[name]->id = loadTextureFromFile(settings->path.c_str(), *settings);
             writeTextureSettings(*settings);
@@ -610,11 +645,10 @@ void buildAddComponentCombo(Scene* scene, EditorState* editor) {
             if (ImGui::Selectable("Rigidbody: Box", isSelected)) {
                 RigidBody* rb = addRigidbody(entities, entityID);
                 JPH::BodyInterface* bodyInterface = scene->physicsScene.bodyInterface;
-                JPH::BoxShapeSettings boxSettings(vec3(0.5f, 0.5f, 0.5f));
-                JPH::ShapeSettings::ShapeResult shapeResult = boxSettings.Create();
-                JPH::ShapeRefC shape = shapeResult.Get();
+                JPH::ShapeRefC shape = getCachedBoxShape(vec3(0.5f, 0.5f, 0.5f));
                 JPH::BodyCreationSettings bodySettings(shape, JPH::RVec3(0.0_r, 0.0_r, 0.0_r), quat::sIdentity(), JPH::EMotionType::Static, Layers::NON_MOVING);
                 bodySettings.mAllowDynamicOrKinematic = true;
+                bodySettings.mUserData = entityID;
                 JPH::Body* body = bodyInterface->CreateBody(bodySettings);
                 bodyInterface->AddBody(body->GetID(), JPH::EActivation::DontActivate);
                 rb->joltBody = body->GetID();
@@ -628,7 +662,6 @@ void buildAddComponentCombo(Scene* scene, EditorState* editor) {
                 light->color = vec3(1.0f, 1.0f, 1.0f);
                 light->cutoff = 1.0f;
                 light->outerCutoff = 15.0f;
-                createSpotLightShadowMap(light);
             }
         }
 
@@ -678,7 +711,7 @@ void buildSceneEntityInspector(Scene* scene, RenderState* renderer, Resources* r
     }
 
     if (spotLight != nullptr) {
-        buildSpotLightInspector(scene, spotLight);
+        buildSpotLightInspector(scene, renderer, spotLight);
     }
 
     if (rigidbody != nullptr) {
@@ -699,13 +732,13 @@ void buildSceneEntityInspector(Scene* scene, RenderState* renderer, Resources* r
 void buildPrefabInspector(Scene* scene) {
 }
 
-void buildResourceInspector(Scene* scene, Resources* resources, EditorState* editor) {
+void buildResourceInspector(Scene* scene, Resources* resources, RenderState* renderer, EditorState* editor) {
     std::string extension = editor->fileClicked.substr(editor->fileClicked.find_last_of('.'));
     std::string fileName = editor->fileClicked.substr(editor->fileClicked.find_last_of('\\'));
     std::string name = fileName.substr(1);
 
     if (extension == ".png") {
-        buildTextureInspector(resources, editor);
+        buildTextureInspector(resources, renderer, editor);
     } else if (extension == ".mat") {
         if (ImGui::BeginTable("Material Table", 3, ImGuiTableFlags_SizingFixedFit)) {
             ImGui::TableSetupColumn("##Label", ImGuiTableColumnFlags_WidthFixed, 95.0f);
@@ -757,7 +790,7 @@ void buildInspector(Scene* scene, Resources* resources, RenderState* renderer, E
             buildPrefabInspector(scene);
             break;
         case Resource:
-            buildResourceInspector(scene, resources, editor);
+            buildResourceInspector(scene, resources, renderer, editor);
             break;
     }
 
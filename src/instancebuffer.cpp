@@ -0,0 +1,70 @@
+#include <iostream>
+
+#include "instancebuffer.h"
+
+// blocks until the gpu is done with whatever was fenced, then releases the fence. a null fence is already done
+void waitForFence(GLsync* fence) {
+    if (*fence == nullptr) {
+        return;
+    }
+
+    while (glClientWaitSync(*fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+    }
+
+    glDeleteSync(*fence);
+    *fence = nullptr;
+}
+
+void createInstanceBuffer(InstanceBuffer* instances, uint32_t capacity) {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr size = static_cast<GLsizeiptr>(capacity) * cInstanceBufferFrames * sizeof(InstanceData);
+
+    instances->capacity = capacity;
+    instances->frame = 0;
+    glGenBuffers(1, &instances->buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, instances->buffer);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, size, nullptr, flags);
+    instances->mapped = static_cast<InstanceData*>(glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, size, flags));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cInstanceBufferBinding, instances->buffer);
+
+    if (instances->mapped == nullptr) {
+        std::cerr << "ERROR::RENDERER::INSTANCE_BUFFER::Failed to map " << size << " bytes" << std::endl;
+    }
+}
+
+void destroyInstanceBuffer(InstanceBuffer* instances) {
+    for (uint32_t i = 0; i < cInstanceBufferFrames; i++) {
+        waitForFence(&instances->fences[i]);
+    }
+
+    if (instances->buffer != 0) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, instances->buffer);
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+        glDeleteBuffers(1, &instances->buffer);
+    }
+
+    instances->buffer = 0;
+    instances->mapped = nullptr;
+    instances->capacity = 0;
+}
+
+// returns the first instance of this frame's region, grows (stalling on every frame in flight) when it won't fit
+uint32_t beginInstanceFrame(InstanceBuffer* instances, uint32_t count) {
+    if (count > instances->capacity) {
+        uint32_t capacity = JPH::max(instances->capacity, cDefaultInstanceCapacity);
+        while (capacity < count) {
+            capacity *= 2;
+        }
+
+        destroyInstanceBuffer(instances);
+        createInstanceBuffer(instances, capacity);
+    }
+
+    waitForFence(&instances->fences[instances->frame]);
+    return instances->frame * instances->capacity;
+}
+
+void endInstanceFrame(InstanceBuffer* instances) {
+    instances->fences[instances->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    instances->frame = (instances->frame + 1) % cInstanceBufferFrames;
+}
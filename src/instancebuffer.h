@@ -0,0 +1,30 @@
+#pragma once
+#include "utils/mathutils.h"
+
+// one region per frame in flight so the cpu never writes what the gpu is still reading
+constexpr uint32_t cInstanceBufferFrames = 3;
+constexpr uint32_t cDefaultInstanceCapacity = 4096;
+constexpr GLuint cInstanceBufferBinding = 1;
+
+// mirrors InstanceData in the vertex shaders (std430)
+struct InstanceData {
+    mat4 model;
+    uint32_t entityID;
+    uint32_t materialIndex;
+    uint32_t padding[2];
+};
+
+// persistently mapped ssbo, the whole buffer stays bound and draws pick their region through the base instance
+struct InstanceBuffer {
+    GLuint buffer = 0;
+    InstanceData* mapped = nullptr;
+    uint32_t capacity = 0;
+    uint32_t frame = 0;
+    GLsync fences[cInstanceBufferFrames] = {};
+};
+
+void createInstanceBuffer(InstanceBuffer* instances, uint32_t capacity);
+void destroyInstanceBuffer(InstanceBuffer* instances);
+uint32_t beginInstanceFrame(InstanceBuffer* instances, uint32_t count);
+void endInstanceFrame(InstanceBuffer* instances);
+void waitForFence(GLsync* fence);
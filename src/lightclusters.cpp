@@ -0,0 +1,302 @@
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+
+#include <Jolt/Math/Float4.h>
+
+#include "lightclusters.h"
+#include "renderer.h"
+
+void createLightClusters(LightClusters* clusters) {
+    glCreateBuffers(1, &clusters->lightBuffer);
+    glCreateBuffers(1, &clusters->gridBuffer);
+    glCreateBuffers(1, &clusters->indexBuffer);
+    glCreateBuffers(1, &clusters->shadowBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cLightBufferBinding, clusters->lightBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cClusterGridBinding, clusters->gridBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cLightIndexBinding, clusters->indexBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cShadowBufferBinding, clusters->shadowBuffer);
+}
+
+void destroyLightClusters(LightClusters* clusters) {
+    GLuint buffers[4] = {clusters->lightBuffer, clusters->gridBuffer, clusters->indexBuffer, clusters->shadowBuffer};
+    glDeleteBuffers(4, buffers);
+    clusters->lightBuffer = 0;
+    clusters->gridBuffer = 0;
+    clusters->indexBuffer = 0;
+    clusters->shadowBuffer = 0;
+}
+
+// works for both perspective and orthographic projections, neither shears x or y by the other axis
+static float ndcToView(const mat4& projection, uint32_t axis, float ndc, float depth) {
+    const float z = -depth;
+    const float w = projection(3, 2) * z + projection(3, 3);
+    return (ndc * w - projection(axis, 2) * z - projection(axis, 3)) / projection(axis, axis);
+}
+
+static float viewToNDC(const mat4& projection, uint32_t axis, float view, float depth) {
+    const float z = -depth;
+    const float w = projection(3, 2) * z + projection(3, 3);
+    return (projection(axis, axis) * view + projection(axis, 2) * z + projection(axis, 3)) / w;
+}
+
+void buildClusterBounds(LightClusters* clusters, const mat4& projection, float nearPlane, float farPlane) {
+    const float logRatio = std::log(farPlane / nearPlane);
+    clusters->projection = projection;
+    clusters->nearPlane = nearPlane;
+    clusters->farPlane = farPlane;
+    clusters->sliceScale = cClusterGridZ / logRatio;
+    clusters->sliceBias = -static_cast<float>(cClusterGridZ) * std::log(nearPlane) / logRatio;
+
+    clusters->minX.resize(cClusterCount);
+    clusters->minY.resize(cClusterCount);
+    clusters->minZ.resize(cClusterCount);
+    clusters->maxX.resize(cClusterCount);
+    clusters->maxY.resize(cClusterCount);
+    clusters->maxZ.resize(cClusterCount);
+
+    for (uint32_t z = 0; z < cClusterGridZ; z++) {
+        const float depth0 = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z) / cClusterGridZ);
+        const float depth1 = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z + 1) / cClusterGridZ);
+
+        for (uint32_t y = 0; y < cClusterGridY; y++) {
+            const float ndcY0 = -1.0f + 2.0f * y / cClusterGridY;
+            const float ndcY1 = -1.0f + 2.0f * (y + 1) / cClusterGridY;
+
+            for (uint32_t x = 0; x < cClusterGridX; x++) {
+                const float ndcX0 = -1.0f + 2.0f * x / cClusterGridX;
+                const float ndcX1 = -1.0f + 2.0f * (x + 1) / cClusterGridX;
+                const uint32_t i = (z * cClusterGridY + y) * cClusterGridX + x;
+
+                const float x00 = ndcToView(projection, 0, ndcX0, depth0);
+                const float x01 = ndcToView(projection, 0, ndcX0, depth1);
+                const float x10 = ndcToView(projection, 0, ndcX1, depth0);
+                const float x11 = ndcToView(projection, 0, ndcX1, depth1);
+                const float y00 = ndcToView(projection, 1, ndcY0, depth0);
+                const float y01 = ndcToView(projection, 1, ndcY0, depth1);
+                const float y10 = ndcToView(projection, 1, ndcY1, depth0);
+                const float y11 = ndcToView(projection, 1, ndcY1, depth1);
+
+                clusters->minX[i] = JPH::min(JPH::min(x00, x01), JPH::min(x10, x11));
+                clusters->maxX[i] = JPH::max(JPH::max(x00, x01), JPH::max(x10, x11));
+                clusters->minY[i] = JPH::min(JPH::min(y00, y01), JPH::min(y10, y11));
+                clusters->maxY[i] = JPH::max(JPH::max(y00, y01), JPH::max(y10, y11));
+                clusters->minZ[i] = -depth1;
+                clusters->maxZ[i] = -depth0;
+            }
+        }
+    }
+}
+
+static uint32_t getClusterSlice(const LightClusters* clusters, float depth) {
+    const float slice = std::floor(std::log(depth) * clusters->sliceScale + clusters->sliceBias);
+    return static_cast<uint32_t>(JPH::Clamp(slice, 0.0f, static_cast<float>(cClusterGridZ - 1)));
+}
+
+static uint32_t getClusterTile(float ndc, uint32_t tiles) {
+    const float tile = std::floor((ndc * 0.5f + 0.5f) * tiles);
+    return static_cast<uint32_t>(JPH::Clamp(tile, 0.0f, static_cast<float>(tiles - 1)));
+}
+
+static const JPH::Float4* loadLanes(const std::vector<float>& values, uint32_t index) {
+    return reinterpret_cast<const JPH::Float4*>(&values[index]);
+}
+
+// exact sphere against box test over the candidate block, four clusters along x at a time
+static void refineLightClusters(LightClusters* clusters, uint32_t light, const uint32_t minTile[3], const uint32_t maxTile[3]) {
+    const LightSphere* sphere = &clusters->spheres[light];
+    const vec4 centerX = vec4::sReplicate(sphere->center.GetX());
+    const vec4 centerY = vec4::sReplicate(sphere->center.GetY());
+    const vec4 centerZ = vec4::sReplicate(sphere->center.GetZ());
+    const vec4 radiusSq = vec4::sReplicate(sphere->radius * sphere->radius);
+    const vec4 zero = vec4::sZero();
+
+    for (uint32_t z = minTile[2]; z <= maxTile[2]; z++) {
+        for (uint32_t y = minTile[1]; y <= maxTile[1]; y++) {
+            const uint32_t row = (z * cClusterGridY + y) * cClusterGridX;
+
+            for (uint32_t x = minTile[0] & ~3u; x <= maxTile[0]; x += 4) {
+                const uint32_t i = row + x;
+                vec4 dx = vec4::sMax(vec4::sMax(vec4::sLoadFloat4(loadLanes(clusters->minX, i)) - centerX, centerX - vec4::sLoadFloat4(loadLanes(clusters->maxX, i))), zero);
+                vec4 dy = vec4::sMax(vec4::sMax(vec4::sLoadFloat4(loadLanes(clusters->minY, i)) - centerY, centerY - vec4::sLoadFloat4(loadLanes(clusters->maxY, i))), zero);
+                vec4 dz = vec4::sMax(vec4::sMax(vec4::sLoadFloat4(loadLanes(clusters->minZ, i)) - centerZ, centerZ - vec4::sLoadFloat4(loadLanes(clusters->maxZ, i))), zero);
+                const int inside = vec4::sLessOrEqual(dx * dx + dy * dy + dz * dz, radiusSq).GetTrues();
+
+                for (uint32_t lane = 0; lane < 4; lane++) {
+                    const uint32_t tileX = x + lane;
+                    if (tileX >= minTile[0] && tileX <= maxTile[0] && (inside & (1 << lane))) {
+                        clusters->pairs.push_back({i + lane, light});
+                    }
+                }
+            }
+        }
+    }
+}
+
+// counting sort of the pairs by cluster, lights stay in ascending order within a cluster
+static void buildClusterLists(LightClusters* clusters) {
+    LightClusterStats* stats = &clusters->stats;
+    clusters->grid.assign(cClusterCount * 2, 0);
+    clusters->indices.resize(clusters->pairs.size());
+
+    for (const LightClusterPair& pair : clusters->pairs) {
+        clusters->grid[pair.cluster * 2 + 1]++;
+    }
+
+    uint32_t offset = 0;
+    stats->maxPerCluster = 0;
+    for (uint32_t i = 0; i < cClusterCount; i++) {
+        const uint32_t count = clusters->grid[i * 2 + 1];
+        stats->maxPerCluster = JPH::max(stats->maxPerCluster, count);
+        clusters->grid[i * 2] = offset;
+        clusters->grid[i * 2 + 1] = 0;
+        offset += count;
+    }
+
+    for (const LightClusterPair& pair : clusters->pairs) {
+        uint32_t* cell = &clusters->grid[pair.cluster * 2];
+        clusters->indices[cell[0] + cell[1]++] = pair.light;
+    }
+}
+
+// light major, each view space sphere is projected to a tile and slice block first so only nearby clusters are
+// tested. no gl calls, only needs buildClusterBounds to have run
+void assignLightClusters(LightClusters* clusters) {
+    const mat4& projection = clusters->projection;
+    const uint32_t tiles[2] = {cClusterGridX, cClusterGridY};
+    clusters->pairs.clear();
+
+    for (uint32_t i = 0; i < clusters->spheres.size(); i++) {
+        const LightSphere* sphere = &clusters->spheres[i];
+        const float depth = -sphere->center.GetZ();
+        if (depth + sphere->radius < clusters->nearPlane || depth - sphere->radius > clusters->farPlane) {
+            continue;
+        }
+
+        const float nearDepth = JPH::max(depth - sphere->radius, clusters->nearPlane);
+        const float farDepth = JPH::min(depth + sphere->radius, clusters->farPlane);
+        uint32_t minTile[3];
+        uint32_t maxTile[3];
+
+        // the projection is monotonic in view position and depth, so the sphere's box corners bound its footprint
+        for (uint32_t axis = 0; axis < 2; axis++) {
+            const float low = sphere->center[axis] - sphere->radius;
+            const float high = sphere->center[axis] + sphere->radius;
+            const float ndc[4] = {viewToNDC(projection, axis, low, nearDepth), viewToNDC(projection, axis, low, farDepth),
+                                  viewToNDC(projection, axis, high, nearDepth), viewToNDC(projection, axis, high, farDepth)};
+            minTile[axis] = getClusterTile(JPH::min(JPH::min(ndc[0], ndc[1]), JPH::min(ndc[2], ndc[3])), tiles[axis]);
+            maxTile[axis] = getClusterTile(JPH::max(JPH::max(ndc[0], ndc[1]), JPH::max(ndc[2], ndc[3])), tiles[axis]);
+        }
+
+        minTile[2] = getClusterSlice(clusters, nearDepth);
+        maxTile[2] = getClusterSlice(clusters, farDepth);
+        refineLightClusters(clusters, i, minTile, maxTile);
+    }
+
+    buildClusterLists(clusters);
+    clusters->stats.entries = static_cast<uint32_t>(clusters->pairs.size());
+}
+
+static float getLightRange(float intensity) {
+    return std::sqrt(JPH::max(intensity, 0.0f) / cLightInfluenceCutoff);
+}
+
+// bounding sphere of the cone, wide cones are bounded by their cap, narrow ones pass through the apex
+static vec3 getSpotBoundsCenter(const RenderSpotLight* light, float range, float* radius) {
+    const float cosOuter = light->cosOuterCutoff;
+    if (cosOuter < 0.70710678f) {
+        *radius = range * std::sqrt(1.0f - cosOuter * cosOuter);
+        return light->position + light->direction * (range * cosOuter);
+    }
+
+    *radius = range / (2.0f * cosOuter);
+    return light->position + light->direction * *radius;
+}
+
+static void gatherLights(LightClusters* clusters, const RenderWorld* world, const mat4& view) {
+    clusters->lights.clear();
+    clusters->spheres.clear();
+    clusters->shadows.resize(world->shadowMaps);
+
+    for (const RenderPointLight& light : world->pointLights) {
+        if (light.brightness <= 0.0f) {
+            continue;
+        }
+
+        LightData data;
+        const float range = getLightRange(light.color.ReduceMax() * light.brightness);
+        data.positionRange = vec4(light.position, range);
+        data.colorBrightness = vec4(light.color, light.brightness);
+        data.directionCosOuter = vec4::sZero();
+        data.cosCutoff = 0.0f;
+        data.type = LIGHT_POINT;
+        data.shadowIndex = -1;
+        data.padding = 0.0f;
+        clusters->lights.push_back(data);
+        clusters->spheres.push_back({view * light.position, range});
+    }
+
+    for (const RenderSpotLight& light : world->spotLights) {
+        if (!light.isActive || light.brightness <= 0.0f) {
+            continue;
+        }
+
+        // the fragment shader projects into light space itself, only for shadowed lights in its cluster
+        if (light.shadowIndex >= 0) {
+            ShadowData* shadow = &clusters->shadows[light.shadowIndex];
+            shadow->lightSpaceMatrix = light.shadowMatrix;
+            shadow->atlasRect = vec4(static_cast<float>(light.atlasX), static_cast<float>(light.atlasY), static_cast<float>(light.atlasSize), static_cast<float>(light.atlasSize)) / static_cast<float>(cShadowAtlasSize);
+            shadow->lightRadiusUV = light.lightRadiusUV;
+            shadow->blockerSearchUV = light.blockerSearchUV;
+            shadow->padding[0] = 0.0f;
+            shadow->padding[1] = 0.0f;
+        }
+
+        // the lit shader scales spot radiance by brightness twice
+        LightData data;
+        const float range = getLightRange(light.color.ReduceMax() * light.brightness * light.brightness);
+        data.positionRange = vec4(light.position, range);
+        data.colorBrightness = vec4(light.color, light.brightness);
+        data.directionCosOuter = vec4(light.direction, light.cosOuterCutoff);
+        data.cosCutoff = light.cosCutoff;
+        data.type = LIGHT_SPOT;
+        data.shadowIndex = light.shadowIndex;
+        data.padding = 0.0f;
+        clusters->lights.push_back(data);
+
+        float radius;
+        vec3 center = getSpotBoundsCenter(&light, range, &radius);
+        clusters->spheres.push_back({view * center, radius});
+    }
+}
+
+// orphans the old store, the driver hands back fresh memory while the previous frame still reads the old one
+static void uploadClusterBuffer(GLuint buffer, const void* data, size_t size) {
+    glNamedBufferData(buffer, JPH::max(size, sizeof(LightData)), nullptr, GL_DYNAMIC_DRAW);
+    if (size > 0) {
+        glNamedBufferSubData(buffer, 0, size, data);
+    }
+}
+
+// runs after updateBufferData so the view and projection are this frame's
+void updateLightClusters(RenderState* renderer) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    LightClusters* clusters = &renderer->clusters;
+    RenderWorld* world = &renderer->world;
+    const mat4& projection = renderer->matricesUBOData.projection;
+
+    if (projection != clusters->projection || world->cameraNear != clusters->nearPlane || world->cameraFar != clusters->farPlane) {
+        buildClusterBounds(clusters, projection, world->cameraNear, world->cameraFar);
+    }
+
+    gatherLights(clusters, world, renderer->matricesUBOData.view);
+    assignLightClusters(clusters);
+
+    uploadClusterBuffer(clusters->lightBuffer, clusters->lights.data(), clusters->lights.size() * sizeof(LightData));
+    uploadClusterBuffer(clusters->gridBuffer, clusters->grid.data(), clusters->grid.size() * sizeof(uint32_t));
+    uploadClusterBuffer(clusters->indexBuffer, clusters->indices.data(), clusters->indices.size() * sizeof(uint32_t));
+    uploadClusterBuffer(clusters->shadowBuffer, clusters->shadows.data(), clusters->shadows.size() * sizeof(ShadowData));
+
+    clusters->stats.lights = static_cast<uint32_t>(clusters->lights.size());
+    clusters->stats.buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
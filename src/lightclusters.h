@@ -0,0 +1,95 @@
+#pragma once
+#include <vector>
+#include "utils/mathutils.h"
+
+struct RenderState;
+
+// screen tiles times exponential depth slices, x has to stay a multiple of four for the simd refine
+constexpr uint32_t cClusterGridX = 16;
+constexpr uint32_t cClusterGridY = 9;
+constexpr uint32_t cClusterGridZ = 24;
+constexpr uint32_t cClusterCount = cClusterGridX * cClusterGridY * cClusterGridZ;
+constexpr GLuint cLightBufferBinding = 3;
+constexpr GLuint cClusterGridBinding = 4;
+constexpr GLuint cLightIndexBinding = 5;
+constexpr GLuint cShadowBufferBinding = 6;
+// lights have no explicit range, they reach until their falloff drops below this
+constexpr float cLightInfluenceCutoff = 0.002f;
+
+enum LightType : int32_t {
+    LIGHT_POINT = 0,
+    LIGHT_SPOT = 1
+};
+
+// mirrors LightData in pbrlitshader.fs (std430)
+struct LightData {
+    vec4 positionRange;
+    vec4 colorBrightness;
+    // spot only, w is the outer cutoff cosine
+    vec4 directionCosOuter;
+    float cosCutoff;
+    LightType type;
+    // slot in the shadow buffer, -1 when the light has no atlas tile
+    int32_t shadowIndex;
+    float padding;
+};
+
+// mirrors ShadowData in pbrlitshader.fs (std430), indexed by LightData::shadowIndex
+struct ShadowData {
+    mat4 lightSpaceMatrix;
+    // offset and scale of the light's tile in the shadow atlas, in uv
+    vec4 atlasRect;
+    float lightRadiusUV;
+    float blockerSearchUV;
+    float padding[2];
+};
+
+// bounding sphere of a light in view space
+struct LightSphere {
+    vec3 center;
+    float radius;
+};
+
+struct LightClusterPair {
+    uint32_t cluster;
+    uint32_t light;
+};
+
+struct LightClusterStats {
+    uint32_t lights = 0;
+    uint32_t entries = 0;
+    uint32_t maxPerCluster = 0;
+    double buildMs = 0.0;
+};
+
+// cluster bounds are view space aabbs stored as a structure of arrays and only rebuilt when the projection
+// changes. grid holds an offset, count pair into indices for every cluster
+struct LightClusters {
+    std::vector<float> minX, minY, minZ;
+    std::vector<float> maxX, maxY, maxZ;
+    mat4 projection = mat4::sZero();
+    float nearPlane = 0.0f;
+    float farPlane = 0.0f;
+    // slice = log(depth) * sliceScale + sliceBias
+    float sliceScale = 0.0f;
+    float sliceBias = 0.0f;
+
+    std::vector<LightData> lights;
+    std::vector<ShadowData> shadows;
+    std::vector<LightSphere> spheres;
+    std::vector<LightClusterPair> pairs;
+    std::vector<uint32_t> grid;
+    std::vector<uint32_t> indices;
+
+    GLuint lightBuffer = 0;
+    GLuint gridBuffer = 0;
+    GLuint indexBuffer = 0;
+    GLuint shadowBuffer = 0;
+    LightClusterStats stats;
+};
+
+void createLightClusters(LightClusters* clusters);
+void destroyLightClusters(LightClusters* clusters);
+void buildClusterBounds(LightClusters* clusters, const mat4& projection, float nearPlane, float farPlane);
+void assignLightClusters(LightClusters* clusters);
+void updateLightClusters(RenderState* renderer);
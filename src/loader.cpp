@@ -83,40 +83,6 @@ void processAnimations(Resources* resources, const aiScene* scene, Model* model)
     }
 }
 
-void createMeshBuffers(Mesh* mesh) {
-    glGenVertexArrays(1, &mesh->VAO);
-    glGenBuffers(1, &mesh->VBO);
-    glGenBuffers(1, &mesh->EBO);
-
-    glBindVertexArray(mesh->VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, mesh->VBO);
-    glBufferData(GL_ARRAY_BUFFER, mesh->vertices.size() * sizeof(Vertex), &mesh->vertices[0], GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->indices.size() * sizeof(GLuint), &mesh->indices[0], GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(vertex_attribute_location::kVertexPosition);
-    glVertexAttribPointer(vertex_attribute_location::kVertexPosition, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-
-    glEnableVertexAttribArray(vertex_attribute_location::kVertexTexCoord);
-    glVertexAttribPointer(vertex_attribute_location::kVertexTexCoord, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
-
-    glEnableVertexAttribArray(vertex_attribute_location::kVertexNormal);
-    glVertexAttribPointer(vertex_attribute_location::kVertexNormal, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-
-    glEnableVertexAttribArray(vertex_attribute_location::kVertexTangent);
-    glVertexAttribPointer(vertex_attribute_location::kVertexTangent, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
-
-    glEnableVertexAttribArray(vertex_attribute_location::kVertexBoneIDs);
-    glVertexAttribIPointer(vertex_attribute_location::kVertexBoneIDs, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, boneIDs));
-
-    glEnableVertexAttribArray(vertex_attribute_location::kVertexWeights);
-    glVertexAttribPointer(vertex_attribute_location::kVertexWeights, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, weights));
-
-    glBindVertexArray(0);
-}
-
 GLuint loadTextureFromFile(const char* path, TextureSettings settings) {
     GLuint textureID = 1;
     GLsizei width;
@@ -223,6 +189,8 @@ void processSubMesh(RenderState* renderer, Resources* resources, aiMesh* mesh, c
         vertex.normal = vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
         vertex.texCoord = vec2(0.0f, 0.0f);
         vertex.tangent = vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+        vec3 bitangent(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+        vertex.tangentSign = vertex.normal.Cross(vertex.tangent).Dot(bitangent) < 0.0f ? -1.0f : 1.0f;
 
         parentMesh->min = min(parentMesh->min, vertex.position);
         parentMesh->max = max(parentMesh->max, vertex.position);
@@ -320,6 +288,10 @@ ModelNode* processNode(aiNode* node, const aiScene* scene, Resources* resources,
                 }
             }
 
+            if (mesh->mNumBones > 0) {
+                childNode->mesh->skinned = true;
+            }
+
             for (uint32_t k = 0; k < mesh->mNumBones; k++) {
                 BoneInfo bone;
                 uint32_t vertexID;
@@ -358,7 +330,7 @@ ModelNode* processNode(aiNode* node, const aiScene* scene, Resources* resources,
             model->materials.push_back(childNode->mesh->subMeshes[i].material);
         }
 
-        createMeshBuffers(childNode->mesh);
+        allocateMeshGeometry(&renderer->meshes, childNode->mesh);
         resources->meshMap[childNode->mesh->name] = childNode->mesh;
     }
 
@@ -473,6 +445,8 @@ void findResources(Resources* resources, RenderState* renderer) {
             if (extension == ".gltf") {
                 stream << "Model {" << std::endl;
                 stream << "path: " << path.path().string() << std::endl;
+                stream << "colliders: " << "none" << std::endl;
+                stream << "mergeStaticColliders: " << "false" << std::endl;
                 stream << "}" << std::endl
                        << std::endl;
 
@@ -504,7 +478,13 @@ void findResources(Resources* resources, RenderState* renderer) {
 
     for (auto& pair : resources->modelImportMap) {
         std::string fileName = pair.first.substr(pair.first.find_last_of('\\') + 1);
-        resources->modelMap[fileName] = loadModel(resources, renderer, pair.first);
+        Model* model = loadModel(resources, renderer, pair.first);
+        resources->modelMap[fileName] = model;
+        if (model != nullptr) {
+            model->colliderType = pair.second.colliders;
+            model->mergeStaticColliders = pair.second.mergeStaticColliders;
+            cookModelColliders(model);
+        }
     }
 
     loadMaterials(resources, renderer);
@@ -6,6 +6,7 @@
 #include "forward.h"
 #include "utils/mathutils.h"
 #include "ecs.h"
+#include "meshcollider.h"
 constexpr char* resourcePath = "..\\resources\\";
 
 struct Entity;
@@ -13,6 +14,8 @@ struct EntityGroup;
 
 struct ModelSettings {
     std::string path;
+    ColliderType colliders = ColliderType::None;
+    bool mergeStaticColliders = false;
 };
 
 struct TextureSettings {
@@ -28,6 +31,7 @@ struct ModelNode {
     mat4 transform;
     mat4 localTransform;
     std::vector<ModelNode*> children;
+    uint64_t colliderHash = 0;
 };
 
 struct Model {
@@ -39,6 +43,9 @@ struct Model {
     std::vector<Material*> materials;
     std::vector<Animation*> animations;
     std::unordered_map<ModelNode*, AnimationChannel*> channelMap;
+    ColliderType colliderType = ColliderType::None;
+    bool mergeStaticColliders = false;
+    uint64_t mergedColliderHash = 0;
 };
 
 struct Resources {
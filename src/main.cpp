@@ -1,6 +1,10 @@
 #include <glad/glad.h>
 #include <glfw/glfw3.h>
 #include <stdlib.h>
+#include <climits>
+#include <fstream>
+#include <iostream>
+#include <string>
 
 #include "sceneloader.h"
 #include "miniaudio.h"
@@ -9,6 +13,7 @@
 #include "loader.h"
 #include "scene.h"
 #include "renderer.h"
+#include "culling.h"
 #include "shader.h"
 #include "physics.h"
 #include "input.h"
@@ -29,13 +34,68 @@ static void updateTime(Scene* scene) {
     scene->lastFrame = scene->currentFrame;
 }
 
+// --stats-frames N writes the render stats of frame N and closes the window, --stats-out picks a file over stdout
+struct StatsDump {
+    int frames = 0;
+    int frame = 0;
+    std::string outPath;
+};
+
+static bool parseArguments(StatsDump* dump, int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--stats-frames" && i + 1 < argc) {
+            char* end = nullptr;
+            const long frames = std::strtol(argv[++i], &end, 10);
+            if (*end != '\0' || end == argv[i] || frames <= 0 || frames > INT_MAX) {
+                std::cerr << "ERROR::MAIN::Invalid frame count for --stats-frames: " << argv[i] << std::endl;
+                return false;
+            }
+
+            dump->frames = static_cast<int>(frames);
+        } else if (arg == "--stats-out" && i + 1 < argc) {
+            dump->outPath = argv[++i];
+        } else {
+            std::cerr << "ERROR::MAIN::Unknown argument: " << arg << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void updateStatsDump(StatsDump* dump, RenderState* renderer) {
+    if (dump->frames <= 0 || ++dump->frame != dump->frames) {
+        return;
+    }
+
+    if (dump->outPath.empty()) {
+        writeRenderStats(&renderer->stats, std::cout);
+        std::cout << std::endl;
+    } else {
+        std::ofstream file(dump->outPath);
+        if (!file) {
+            std::cerr << "ERROR::MAIN::Failed to open render stats output: " << dump->outPath << std::endl;
+        } else {
+            writeRenderStats(&renderer->stats, file);
+            file << std::endl;
+        }
+    }
+
+    glfwSetWindowShouldClose(renderer->window, GLFW_TRUE);
+}
+
 #ifdef PETES_EDITOR
 
 static void updateSceneEditor(Scene* scene, Resources* resources, RenderState* renderer, EditorState* editor) {
     if (editor->playing) {
         updatePhysics(scene);
         updatePlayer(scene, resources, renderer);
+        flushPhysicsQueries(&scene->physicsScene);
         updatePhysicsBodyPositions(scene);
+        if (scene->physicsScene.stepStats.stepsThisFrame > 0) {
+            recordPhysicsFrame(scene, &editor->physicsHistory);
+        }
         updateAnimators(&scene->entities, scene->deltaTime);
         updateCamera(scene);
     } else {
@@ -43,7 +103,12 @@ static void updateSceneEditor(Scene* scene, Resources* resources, RenderState* r
     }
 }
 
-int main() {
+int main(int argc, char** argv) {
+    StatsDump statsDump;
+    if (!parseArguments(&statsDump, argc, argv)) {
+        return 1;
+    }
+
     Scene* scene = new Scene();
     Resources* resources = new Resources();
     RenderState* renderer = new RenderState();
@@ -54,8 +119,8 @@ int main() {
     createContext(renderer);
     loadEditorShaders(renderer);
     loadShaders(renderer);
-    loadResources(resources, renderer);
     initPhysics(scene);
+    loadResources(resources, renderer);
     initRenderer(renderer, scene);
     initRendererEditor(renderer);
     initEditor(editor, renderer->window);
@@ -76,20 +141,33 @@ int main() {
         updateInput(inputActions, renderer->window);
         updateAndDrawEditor(scene, renderer, resources, editor);
         updateSceneEditor(scene, resources, renderer, editor);
+        extractRenderWorld(&renderer->world, &scene->entities);
         updateBufferData(renderer, scene);
-        drawPickingScene(renderer, &scene->entities);
-        renderScene(renderer, &scene->entities);
+        assignShadowTiles(&renderer->shadowAtlas, &renderer->world);
+        cullRenderWorld(&renderer->world, renderer->matricesUBOData.projection * renderer->matricesUBOData.view);
+        scheduleShadowUpdates(&renderer->shadowAtlas, &renderer->world);
+        updateLightClusters(renderer);
+        buildRenderQueue(renderer, renderer->picker.requested);
+        drawPickingScene(renderer);
+        renderScene(renderer);
         renderDebug(renderer);
+        updateStatsDump(&statsDump, renderer);
         glfwSwapBuffers(renderer->window);
     }
 
+    destroyPhysicsHistory(&editor->physicsHistory);
     destroyEditor();
     exitProgram(renderer, resources);
     return 0;
 }
 
 #else
-int main() {
+int main(int argc, char** argv) {
+    StatsDump statsDump;
+    if (!parseArguments(&statsDump, argc, argv)) {
+        return 1;
+    }
+
     Scene* scene = new Scene();
     Resources* resources = new Resources();
     RenderState* renderer = new RenderState();
@@ -98,8 +176,8 @@ int main() {
 
     createContext(renderer);
     loadShaders(renderer);
-    loadResources(resources, renderer);
     initPhysics(scene);
+    loadResources(resources, renderer);
     loadFirstFoundScene(scene, resources);
     initRenderer(renderer, scene);
 
@@ -112,11 +190,19 @@ int main() {
         updateInput(inputActions, renderer->window);
         updatePhysics(scene);
         updatePlayer(scene, resources, renderer);
+        flushPhysicsQueries(&scene->physicsScene);
         updatePhysicsBodyPositions(scene);
         updateAnimators(&scene->entities, scene->deltaTime);
         updateCamera(scene);
+        extractRenderWorld(&renderer->world, &scene->entities);
         updateBufferData(renderer, scene);
-        renderScene(renderer, &scene->entities);
+        assignShadowTiles(&renderer->shadowAtlas, &renderer->world);
+        cullRenderWorld(&renderer->world, renderer->matricesUBOData.projection * renderer->matricesUBOData.view);
+        scheduleShadowUpdates(&renderer->shadowAtlas, &renderer->world);
+        updateLightClusters(renderer);
+        buildRenderQueue(renderer, false);
+        renderScene(renderer);
+        updateStatsDump(&statsDump, renderer);
         glfwSwapBuffers(renderer->window);
     }
 
@@ -0,0 +1,249 @@
+#include <iostream>
+
+#include "materialtable.h"
+#include "renderer.h"
+#include "loader.h"
+
+// the loader asks for unsized formats, immutable storage needs sized ones
+static GLenum getSizedFormat(GLenum format) {
+    switch (format) {
+        case GL_RED:
+            return GL_R8;
+        case GL_RGB:
+            return GL_RGB8;
+        case GL_RGBA:
+            return GL_RGBA8;
+        case GL_SRGB:
+            return GL_SRGB8;
+        case GL_SRGB_ALPHA:
+            return GL_SRGB8_ALPHA8;
+        default:
+            return format;
+    }
+}
+
+static void bindMaterialBuffer(MaterialTable* table) {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cMaterialBufferBinding, table->buffer);
+}
+
+static void allocateTextureArray(TextureArray* array, uint32_t capacity) {
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+    glTextureStorage3D(texture, array->levels, getSizedFormat(array->format), array->width, array->height, capacity);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, array->minFilter);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, array->magFilter);
+
+    if (array->texture != 0) {
+        for (GLsizei level = 0; level < array->levels; level++) {
+            GLsizei width = JPH::max(array->width >> level, 1);
+            GLsizei height = JPH::max(array->height >> level, 1);
+            glCopyImageSubData(array->texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, width, height, array->layers);
+        }
+
+        glDeleteTextures(1, &array->texture);
+    }
+
+    array->texture = texture;
+    array->capacity = capacity;
+}
+
+void createMaterialTable(MaterialTable* table, uint32_t capacity) {
+    table->capacity = capacity;
+    glCreateBuffers(1, &table->buffer);
+    glNamedBufferData(table->buffer, static_cast<GLsizeiptr>(capacity) * sizeof(MaterialData), nullptr, GL_DYNAMIC_DRAW);
+    bindMaterialBuffer(table);
+
+    TextureArray fallback;
+    fallback.width = 1;
+    fallback.height = 1;
+    fallback.levels = 1;
+    fallback.format = GL_RGBA8;
+    allocateTextureArray(&fallback, cDefaultTextureArrayLayers);
+    const uint8_t white[4] = {255, 255, 255, 255};
+    glClearTexSubImage(fallback.texture, 0, 0, 0, 0, 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    fallback.layers = 1;
+    table->arrays.push_back(fallback);
+}
+
+void destroyMaterialTable(MaterialTable* table) {
+    glDeleteBuffers(1, &table->buffer);
+    for (TextureArray& array : table->arrays) {
+        glDeleteTextures(1, &array.texture);
+    }
+
+    table->buffer = 0;
+    table->capacity = 0;
+    table->arrays.clear();
+    table->textureRefs.clear();
+}
+
+// slots already written are copied over, only dirty materials get uploaded again
+static void growMaterialTable(MaterialTable* table, uint32_t required) {
+    uint32_t capacity = JPH::max(table->capacity, 1u);
+    while (capacity < required) {
+        capacity *= 2;
+    }
+
+    GLuint buffer;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferData(buffer, static_cast<GLsizeiptr>(capacity) * sizeof(MaterialData), nullptr, GL_DYNAMIC_DRAW);
+    glCopyNamedBufferSubData(table->buffer, buffer, 0, 0, static_cast<GLsizeiptr>(table->capacity) * sizeof(MaterialData));
+    glDeleteBuffers(1, &table->buffer);
+
+    table->buffer = buffer;
+    table->capacity = capacity;
+    bindMaterialBuffer(table);
+}
+
+// levels the loader actually generated, a texture without mips stays a single level
+static GLsizei getTextureLevels(GLuint texture, GLsizei width, GLsizei height) {
+    GLsizei levels = 1;
+    GLsizei size = JPH::max(width, height);
+
+    while ((size >> levels) > 0) {
+        GLint levelWidth = 0;
+        glGetTextureLevelParameteriv(texture, levels, GL_TEXTURE_WIDTH, &levelWidth);
+        if (levelWidth == 0) {
+            break;
+        }
+        levels++;
+    }
+
+    return levels;
+}
+
+static TextureArray* findTextureArray(MaterialTable* table, const TextureArray* desc) {
+    for (TextureArray& array : table->arrays) {
+        if (array.width == desc->width && array.height == desc->height && array.levels == desc->levels && array.format == desc->format &&
+            array.minFilter == desc->minFilter && array.magFilter == desc->magFilter) {
+            return &array;
+        }
+    }
+
+    if (table->arrays.size() >= cMaxTextureArrays) {
+        return nullptr;
+    }
+
+    table->arrays.push_back(*desc);
+    return &table->arrays.back();
+}
+
+// copies the texture into a layer the first time it's seen
+uint32_t getTextureRef(MaterialTable* table, GLuint texture) {
+    auto found = table->textureRefs.find(texture);
+    if (found != table->textureRefs.end()) {
+        return found->second;
+    }
+
+    TextureArray desc;
+    GLint width, height, format;
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_HEIGHT, &height);
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+    glGetTextureParameteriv(texture, GL_TEXTURE_MIN_FILTER, &desc.minFilter);
+    glGetTextureParameteriv(texture, GL_TEXTURE_MAG_FILTER, &desc.magFilter);
+    desc.width = width;
+    desc.height = height;
+    desc.format = format;
+    desc.levels = getTextureLevels(texture, width, height);
+
+    TextureArray* array = findTextureArray(table, &desc);
+    if (array == nullptr) {
+        std::cerr << "ERROR::RENDERER::MATERIAL_TABLE::Out of texture arrays, texture " << texture << " (" << width << "x" << height << ") falls back to white" << std::endl;
+        table->textureRefs[texture] = cFallbackTextureRef;
+        return cFallbackTextureRef;
+    }
+
+    uint32_t layer;
+    if (!array->freeLayers.empty()) {
+        layer = array->freeLayers.back();
+        array->freeLayers.pop_back();
+    } else {
+        if (array->layers == array->capacity) {
+            allocateTextureArray(array, array->capacity == 0 ? cDefaultTextureArrayLayers : array->capacity * 2);
+        }
+        layer = array->layers++;
+    }
+
+    for (GLsizei level = 0; level < array->levels; level++) {
+        GLsizei levelWidth = JPH::max(array->width >> level, 1);
+        GLsizei levelHeight = JPH::max(array->height >> level, 1);
+        glCopyImageSubData(texture, GL_TEXTURE_2D, level, 0, 0, 0, array->texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levelWidth, levelHeight, 1);
+    }
+
+    const uint32_t ref = static_cast<uint32_t>(array - table->arrays.data()) << 16 | layer;
+    table->textureRefs[texture] = ref;
+    return ref;
+}
+
+static void markTextureUsers(Material* material, const Texture* texture) {
+    for (const Texture* used : material->textures) {
+        if (used == texture) {
+            material->dirty = true;
+        }
+    }
+}
+
+// call before the texture's gl name is deleted, a reused name would otherwise pick up the old layer. materials using
+// the texture are marked dirty so their next sync copies the new pixels into a layer
+void releaseTextureRef(MaterialTable* table, Resources* resources, Texture* texture) {
+    auto found = table->textureRefs.find(texture->id);
+    if (found != table->textureRefs.end()) {
+        if (found->second != cFallbackTextureRef) {
+            table->arrays[found->second >> 16].freeLayers.push_back(found->second & 0xFFFF);
+        }
+        table->textureRefs.erase(found);
+    }
+
+    for (auto& pair : resources->materialMap) {
+        markTextureUsers(pair.second, texture);
+    }
+    for (Model* model : resources->models) {
+        for (Material* material : model->materials) {
+            markTextureUsers(material, texture);
+        }
+    }
+}
+
+// only materials drawn this frame are looked at, a dirty one writes its own slot and nothing else
+void syncMaterialTable(RenderState* renderer) {
+    MaterialTable* table = &renderer->materials;
+    RenderWorld* world = &renderer->world;
+
+    for (const RenderDraw& draw : world->draws) {
+        Material* material = draw.material;
+        if (!material->dirty) {
+            continue;
+        }
+
+        if (material->sortID >= table->capacity) {
+            growMaterialTable(table, material->sortID + 1);
+        }
+
+        MaterialData data;
+        data.baseColor = material->baseColor;
+        data.textureTiling[0] = material->textureTiling.x;
+        data.textureTiling[1] = material->textureTiling.y;
+        data.roughness = material->roughness;
+        data.metalness = material->metalness;
+        data.aoStrength = material->aoStrength;
+        data.normalStrength = material->normalStrength;
+        data.padding = 0;
+        for (uint32_t i = 0; i < 5; i++) {
+            data.textures[i] = getTextureRef(table, material->textures[i]->id);
+        }
+
+        glNamedBufferSubData(table->buffer, static_cast<GLintptr>(material->sortID) * sizeof(MaterialData), sizeof(MaterialData), &data);
+        material->dirty = false;
+        renderer->stats.materialUploads++;
+    }
+}
+
+void bindMaterialTextures(RenderState* renderer) {
+    MaterialTable* table = &renderer->materials;
+    for (uint32_t i = 0; i < table->arrays.size(); i++) {
+        bindTexture(renderer, uniform_location::kTextureMaterialUnit + i, table->arrays[i].texture);
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include "utils/mathutils.h"
+
+struct RenderState;
+struct Resources;
+struct Texture;
+
+// texture arrays take units 0..15, the shadow atlas sits right after them
+constexpr uint32_t cMaxTextureArrays = 16;
+constexpr uint32_t cDefaultMaterialCapacity = 256;
+constexpr uint32_t cDefaultTextureArrayLayers = 4;
+constexpr GLuint cMaterialBufferBinding = 2;
+// first layer of the first array, a 1x1 white texture for anything that can't get a layer of its own
+constexpr uint32_t cFallbackTextureRef = 0;
+
+// mirrors MaterialData in pbrlitshader.fs (std430), a texture is array << 16 | layer
+struct MaterialData {
+    vec4 baseColor;
+    float textureTiling[2];
+    float roughness;
+    float metalness;
+    float aoStrength;
+    float normalStrength;
+    uint32_t textures[5];
+    uint32_t padding;
+};
+
+// every source texture with the same size, format and filtering shares one array
+struct TextureArray {
+    GLuint texture = 0;
+    GLsizei width = 0;
+    GLsizei height = 0;
+    GLsizei levels = 0;
+    GLenum format = GL_NONE;
+    GLint minFilter = GL_LINEAR;
+    GLint magFilter = GL_LINEAR;
+    uint32_t layers = 0;
+    uint32_t capacity = 0;
+    // layers given back by re-imported textures, reused before the array grows
+    std::vector<uint32_t> freeLayers;
+};
+
+// one MaterialData per Material::sortID. source textures are copied into the arrays the first time a material
+// uses them, the originals stay around for the editor previews
+struct MaterialTable {
+    GLuint buffer = 0;
+    uint32_t capacity = 0;
+    std::vector<TextureArray> arrays;
+    std::unordered_map<GLuint, uint32_t> textureRefs;
+};
+
+void createMaterialTable(MaterialTable* table, uint32_t capacity);
+void destroyMaterialTable(MaterialTable* table);
+uint32_t getTextureRef(MaterialTable* table, GLuint texture);
+void releaseTextureRef(MaterialTable* table, Resources* resources, Texture* texture);
+void syncMaterialTable(RenderState* renderer);
+void bindMaterialTextures(RenderState* renderer);
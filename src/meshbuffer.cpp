@@ -0,0 +1,400 @@
+#include <algorithm>
+#include <cstring>
+
+#include "meshbuffer.h"
+#include "renderer.h"
+#include "shader.h"
+
+constexpr GLuint cVertexBinding = 0;
+constexpr GLuint cSkinBinding = 1;
+
+// a block of elements that moves when a store is compacted
+struct MeshMove {
+    uint32_t from;
+    uint32_t to;
+    uint32_t count;
+};
+
+static MeshPool* getMeshPool(MeshBuffer* buffer, const Mesh* mesh) {
+    return mesh->skinned ? &buffer->skinnedPool : &buffer->staticPool;
+}
+
+static size_t getVertexSize(const Mesh* mesh) {
+    return mesh->skinned ? sizeof(PackedVertex) + sizeof(SkinVertex) : sizeof(PackedVertex);
+}
+
+static void bindMeshStores(MeshBuffer* buffer) {
+    MeshPool* pools[2] = {&buffer->staticPool, &buffer->skinnedPool};
+    for (MeshPool* pool : pools) {
+        glVertexArrayVertexBuffer(pool->vao, cVertexBinding, pool->vertexBuffer, 0, sizeof(PackedVertex));
+        glVertexArrayElementBuffer(pool->vao, buffer->indexBuffer);
+    }
+    glVertexArrayVertexBuffer(buffer->skinnedPool.vao, cSkinBinding, buffer->skinnedPool.skinBuffer, 0, sizeof(SkinVertex));
+}
+
+static void setVertexAttribute(GLuint vao, GLuint location, GLint size, GLenum type, GLuint offset, GLuint binding) {
+    glEnableVertexArrayAttrib(vao, location);
+    if (type == GL_UNSIGNED_BYTE) {
+        glVertexArrayAttribIFormat(vao, location, size, type, offset);
+    } else {
+        glVertexArrayAttribFormat(vao, location, size, type, type != GL_FLOAT && type != GL_HALF_FLOAT, offset);
+    }
+    glVertexArrayAttribBinding(vao, location, binding);
+}
+
+static void createMeshVertexArray(MeshPool* pool, bool skinned) {
+    glCreateVertexArrays(1, &pool->vao);
+    setVertexAttribute(pool->vao, vertex_attribute_location::kVertexPosition, 3, GL_FLOAT, offsetof(PackedVertex, position), cVertexBinding);
+    setVertexAttribute(pool->vao, vertex_attribute_location::kVertexTexCoord, 2, GL_HALF_FLOAT, offsetof(PackedVertex, texCoord), cVertexBinding);
+    setVertexAttribute(pool->vao, vertex_attribute_location::kVertexNormal, 2, GL_SHORT, offsetof(PackedVertex, normal), cVertexBinding);
+    setVertexAttribute(pool->vao, vertex_attribute_location::kVertexTangent, 4, GL_INT_2_10_10_10_REV, offsetof(PackedVertex, tangent), cVertexBinding);
+    if (skinned) {
+        setVertexAttribute(pool->vao, vertex_attribute_location::kVertexBoneIDs, 4, GL_UNSIGNED_BYTE, offsetof(SkinVertex, boneIDs), cSkinBinding);
+        setVertexAttribute(pool->vao, vertex_attribute_location::kVertexWeights, 4, GL_UNSIGNED_BYTE, offsetof(SkinVertex, weights), cSkinBinding);
+    }
+}
+
+// unit vector onto the octahedron, the lower half folded over the diagonals
+static void encodeOctahedral(vec3 n, float* x, float* y) {
+    n /= std::abs(n.GetX()) + std::abs(n.GetY()) + std::abs(n.GetZ());
+    *x = n.GetX();
+    *y = n.GetY();
+    if (n.GetZ() < 0.0f) {
+        *x = (1.0f - std::abs(n.GetY())) * (n.GetX() >= 0.0f ? 1.0f : -1.0f);
+        *y = (1.0f - std::abs(n.GetX())) * (n.GetY() >= 0.0f ? 1.0f : -1.0f);
+    }
+}
+
+static int32_t packSnorm(float value, int32_t maximum) {
+    return static_cast<int32_t>(std::round(JPH::Clamp(value, -1.0f, 1.0f) * maximum));
+}
+
+// round to nearest, values too small for a normal half flush to zero. uvs never get near the half range
+static uint16_t packHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+    const uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (exponent <= 0) {
+        return static_cast<uint16_t>(sign);
+    }
+    if (exponent >= 31) {
+        return static_cast<uint16_t>(sign | 0x7C00);
+    }
+
+    // a carry out of the mantissa correctly bumps the exponent
+    uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000) {
+        half++;
+    }
+    return static_cast<uint16_t>(half);
+}
+
+static PackedVertex packVertex(const Vertex* vertex) {
+    PackedVertex packed;
+    packed.position[0] = vertex->position.GetX();
+    packed.position[1] = vertex->position.GetY();
+    packed.position[2] = vertex->position.GetZ();
+
+    float x, y;
+    encodeOctahedral(vertex->normal, &x, &y);
+    packed.normal[0] = static_cast<int16_t>(packSnorm(x, 32767));
+    packed.normal[1] = static_cast<int16_t>(packSnorm(y, 32767));
+
+    encodeOctahedral(vertex->tangent, &x, &y);
+    const uint32_t sign = vertex->tangentSign < 0.0f ? 0x3 : 0x1;
+    packed.tangent = (static_cast<uint32_t>(packSnorm(x, 511)) & 0x3FF) | ((static_cast<uint32_t>(packSnorm(y, 511)) & 0x3FF) << 10) | (sign << 30);
+
+    packed.texCoord[0] = packHalf(vertex->texCoord.x);
+    packed.texCoord[1] = packHalf(vertex->texCoord.y);
+    return packed;
+}
+
+// rounding error goes to the heaviest influence so the weights still sum to one. ids the palette can't hold, like
+// the loader's unskinned marker, get no weight and the shader keeps such a vertex in its bind pose
+static SkinVertex packSkinVertex(const Vertex* vertex) {
+    SkinVertex packed = {};
+    int32_t total = 0;
+    uint32_t heaviest = 0;
+    float weightSum = 0.0f;
+
+    for (uint32_t i = 0; i < 4; i++) {
+        if (vertex->boneIDs[i] >= 0 && vertex->boneIDs[i] < static_cast<GLint>(cMaxBones)) {
+            weightSum += vertex->weights[i];
+        }
+    }
+
+    if (weightSum <= 0.0f) {
+        return packed;
+    }
+
+    for (uint32_t i = 0; i < 4; i++) {
+        if (vertex->boneIDs[i] < 0 || vertex->boneIDs[i] >= static_cast<GLint>(cMaxBones)) {
+            continue;
+        }
+
+        packed.boneIDs[i] = static_cast<uint8_t>(vertex->boneIDs[i]);
+        packed.weights[i] = static_cast<uint8_t>(std::round(vertex->weights[i] / weightSum * 255.0f));
+        total += packed.weights[i];
+        if (packed.weights[i] > packed.weights[heaviest]) {
+            heaviest = i;
+        }
+    }
+
+    packed.weights[heaviest] = static_cast<uint8_t>(packed.weights[heaviest] + 255 - total);
+    return packed;
+}
+
+// first fit in the holes, then the top
+static bool allocateRange(MeshAllocator* allocator, uint32_t count, uint32_t* offset) {
+    for (size_t i = 0; i < allocator->freeRanges.size(); i++) {
+        MeshRange* range = &allocator->freeRanges[i];
+        if (range->count < count) {
+            continue;
+        }
+
+        *offset = range->offset;
+        range->offset += count;
+        range->count -= count;
+        allocator->freeCount -= count;
+        if (range->count == 0) {
+            allocator->freeRanges.erase(allocator->freeRanges.begin() + i);
+        }
+        return true;
+    }
+
+    if (allocator->top + count > allocator->capacity) {
+        return false;
+    }
+
+    *offset = allocator->top;
+    allocator->top += count;
+    return true;
+}
+
+static void freeRange(MeshAllocator* allocator, uint32_t offset, uint32_t count) {
+    auto it = std::lower_bound(allocator->freeRanges.begin(), allocator->freeRanges.end(), offset, [](const MeshRange& range, uint32_t value) {
+        return range.offset < value;
+    });
+    it = allocator->freeRanges.insert(it, {offset, count});
+    allocator->freeCount += count;
+
+    if (it + 1 != allocator->freeRanges.end() && it->offset + it->count == (it + 1)->offset) {
+        it->count += (it + 1)->count;
+        allocator->freeRanges.erase(it + 1);
+    }
+
+    if (it != allocator->freeRanges.begin() && (it - 1)->offset + (it - 1)->count == it->offset) {
+        (it - 1)->count += it->count;
+        it = allocator->freeRanges.erase(it) - 1;
+    }
+
+    // a hole touching the top just lowers it
+    if (it->offset + it->count == allocator->top) {
+        allocator->top = it->offset;
+        allocator->freeCount -= it->count;
+        allocator->freeRanges.erase(it);
+    }
+}
+
+// the used part is copied over on the gpu
+static void resizeStore(GLuint* store, uint32_t used, uint32_t capacity, GLsizeiptr stride) {
+    GLuint newStore;
+    glCreateBuffers(1, &newStore);
+    glNamedBufferData(newStore, capacity * stride, nullptr, GL_STATIC_DRAW);
+    if (*store != 0) {
+        glCopyNamedBufferSubData(*store, newStore, 0, 0, used * stride);
+        glDeleteBuffers(1, store);
+    }
+    *store = newStore;
+}
+
+static uint32_t getGrownCapacity(const MeshAllocator* allocator, uint32_t required, uint32_t defaultCapacity) {
+    uint32_t capacity = JPH::max(allocator->capacity, defaultCapacity);
+    while (capacity < allocator->top + required) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+// both streams of a pool grow together so their offsets stay in step, the vaos are pointed at the new stores
+static void growMeshPool(MeshBuffer* buffer, MeshPool* pool, uint32_t required) {
+    const uint32_t capacity = getGrownCapacity(&pool->vertices, required, cDefaultMeshVertexCapacity);
+    resizeStore(&pool->vertexBuffer, pool->vertices.top, capacity, sizeof(PackedVertex));
+    if (pool == &buffer->skinnedPool) {
+        resizeStore(&pool->skinBuffer, pool->vertices.top, capacity, sizeof(SkinVertex));
+    }
+
+    pool->vertices.capacity = capacity;
+    bindMeshStores(buffer);
+}
+
+static void growIndices(MeshBuffer* buffer, uint32_t required) {
+    const uint32_t capacity = getGrownCapacity(&buffer->indices, required, cDefaultMeshIndexCapacity);
+    resizeStore(&buffer->indexBuffer, buffer->indices.top, capacity, sizeof(GLuint));
+    buffer->indices.capacity = capacity;
+    bindMeshStores(buffer);
+}
+
+void allocateMeshGeometry(MeshBuffer* buffer, Mesh* mesh) {
+    if (buffer->staticPool.vao == 0) {
+        createMeshVertexArray(&buffer->staticPool, false);
+        createMeshVertexArray(&buffer->skinnedPool, true);
+    }
+
+    MeshPool* pool = getMeshPool(buffer, mesh);
+    const uint32_t vertexCount = static_cast<uint32_t>(mesh->vertices.size());
+    const uint32_t indexCount = static_cast<uint32_t>(mesh->indices.size());
+    uint32_t vertexOffset, indexOffset;
+
+    if (!allocateRange(&pool->vertices, vertexCount, &vertexOffset)) {
+        growMeshPool(buffer, pool, vertexCount);
+        allocateRange(&pool->vertices, vertexCount, &vertexOffset);
+    }
+
+    if (!allocateRange(&buffer->indices, indexCount, &indexOffset)) {
+        growIndices(buffer, indexCount);
+        allocateRange(&buffer->indices, indexCount, &indexOffset);
+    }
+
+    std::vector<PackedVertex> packed(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; i++) {
+        packed[i] = packVertex(&mesh->vertices[i]);
+    }
+    glNamedBufferSubData(pool->vertexBuffer, static_cast<GLintptr>(vertexOffset) * sizeof(PackedVertex), vertexCount * sizeof(PackedVertex), packed.data());
+
+    if (mesh->skinned) {
+        std::vector<SkinVertex> skin(vertexCount);
+        for (uint32_t i = 0; i < vertexCount; i++) {
+            skin[i] = packSkinVertex(&mesh->vertices[i]);
+        }
+        glNamedBufferSubData(pool->skinBuffer, static_cast<GLintptr>(vertexOffset) * sizeof(SkinVertex), vertexCount * sizeof(SkinVertex), skin.data());
+    }
+
+    glNamedBufferSubData(buffer->indexBuffer, static_cast<GLintptr>(indexOffset) * sizeof(GLuint), indexCount * sizeof(GLuint), mesh->indices.data());
+
+    mesh->baseVertex = static_cast<GLint>(vertexOffset);
+    mesh->firstIndex = indexOffset;
+    buffer->meshes.push_back(mesh);
+    buffer->stats.meshes = static_cast<uint32_t>(buffer->meshes.size());
+    buffer->stats.vertexBytes += vertexCount * getVertexSize(mesh);
+}
+
+void freeMeshGeometry(MeshBuffer* buffer, Mesh* mesh) {
+    auto found = std::find(buffer->meshes.begin(), buffer->meshes.end(), mesh);
+    if (found == buffer->meshes.end()) {
+        return;
+    }
+
+    MeshPool* pool = getMeshPool(buffer, mesh);
+    buffer->meshes.erase(found);
+    buffer->stats.meshes = static_cast<uint32_t>(buffer->meshes.size());
+    buffer->stats.vertexBytes -= mesh->vertices.size() * getVertexSize(mesh);
+    freeRange(&pool->vertices, static_cast<uint32_t>(mesh->baseVertex), static_cast<uint32_t>(mesh->vertices.size()));
+    freeRange(&buffer->indices, mesh->firstIndex, static_cast<uint32_t>(mesh->indices.size()));
+
+    if (pool->vertices.freeCount > pool->vertices.top * cMeshBufferDefragRatio || buffer->indices.freeCount > buffer->indices.top * cMeshBufferDefragRatio) {
+        defragmentMeshBuffer(buffer);
+    }
+}
+
+static void moveStore(GLuint* store, uint32_t capacity, GLsizeiptr stride, const std::vector<MeshMove>& moves) {
+    GLuint newStore;
+    glCreateBuffers(1, &newStore);
+    glNamedBufferData(newStore, capacity * stride, nullptr, GL_STATIC_DRAW);
+    for (const MeshMove& move : moves) {
+        glCopyNamedBufferSubData(*store, newStore, move.from * stride, move.to * stride, move.count * stride);
+    }
+    glDeleteBuffers(1, store);
+    *store = newStore;
+}
+
+static void resetAllocator(MeshAllocator* allocator, uint32_t top) {
+    allocator->top = top;
+    allocator->freeCount = 0;
+    allocator->freeRanges.clear();
+}
+
+// packs the pool's meshes to the front in their current order, copies stay on the gpu
+static void compactMeshPool(MeshBuffer* buffer, MeshPool* pool) {
+    std::vector<Mesh*> meshes;
+    for (Mesh* mesh : buffer->meshes) {
+        if (getMeshPool(buffer, mesh) == pool) {
+            meshes.push_back(mesh);
+        }
+    }
+    std::sort(meshes.begin(), meshes.end(), [](const Mesh* a, const Mesh* b) {
+        return a->baseVertex < b->baseVertex;
+    });
+
+    std::vector<MeshMove> moves;
+    uint32_t cursor = 0;
+    for (Mesh* mesh : meshes) {
+        const uint32_t count = static_cast<uint32_t>(mesh->vertices.size());
+        moves.push_back({static_cast<uint32_t>(mesh->baseVertex), cursor, count});
+        mesh->baseVertex = static_cast<GLint>(cursor);
+        cursor += count;
+    }
+
+    if (pool->vertexBuffer != 0) {
+        moveStore(&pool->vertexBuffer, pool->vertices.capacity, sizeof(PackedVertex), moves);
+    }
+    if (pool->skinBuffer != 0) {
+        moveStore(&pool->skinBuffer, pool->vertices.capacity, sizeof(SkinVertex), moves);
+    }
+    resetAllocator(&pool->vertices, cursor);
+}
+
+static void compactIndices(MeshBuffer* buffer) {
+    std::sort(buffer->meshes.begin(), buffer->meshes.end(), [](const Mesh* a, const Mesh* b) {
+        return a->firstIndex < b->firstIndex;
+    });
+
+    std::vector<MeshMove> moves;
+    uint32_t cursor = 0;
+    for (Mesh* mesh : buffer->meshes) {
+        const uint32_t count = static_cast<uint32_t>(mesh->indices.size());
+        moves.push_back({mesh->firstIndex, cursor, count});
+        mesh->firstIndex = cursor;
+        cursor += count;
+    }
+
+    moveStore(&buffer->indexBuffer, buffer->indices.capacity, sizeof(GLuint), moves);
+    resetAllocator(&buffer->indices, cursor);
+}
+
+void defragmentMeshBuffer(MeshBuffer* buffer) {
+    if (buffer->staticPool.vao == 0) {
+        return;
+    }
+
+    compactMeshPool(buffer, &buffer->staticPool);
+    compactMeshPool(buffer, &buffer->skinnedPool);
+    compactIndices(buffer);
+    bindMeshStores(buffer);
+    buffer->stats.defrags++;
+}
+
+static void destroyMeshPool(MeshPool* pool) {
+    GLuint buffers[2] = {pool->vertexBuffer, pool->skinBuffer};
+    glDeleteBuffers(2, buffers);
+    glDeleteVertexArrays(1, &pool->vao);
+    *pool = MeshPool();
+}
+
+void destroyMeshBuffer(MeshBuffer* buffer) {
+    destroyMeshPool(&buffer->staticPool);
+    destroyMeshPool(&buffer->skinnedPool);
+    glDeleteBuffers(1, &buffer->indexBuffer);
+
+    buffer->indexBuffer = 0;
+    buffer->indices = MeshAllocator();
+    buffer->meshes.clear();
+    buffer->stats = MeshBufferStats();
+}
+
+GLuint getMeshVertexArray(const MeshBuffer* buffer, bool skinned) {
+    return skinned ? buffer->skinnedPool.vao : buffer->staticPool.vao;
+}
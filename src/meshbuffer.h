@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include "utils/mathutils.h"
+
+struct Mesh;
+
+constexpr uint32_t cDefaultMeshVertexCapacity = 1 << 16;
+constexpr uint32_t cDefaultMeshIndexCapacity = 1 << 18;
+// freeing a mesh compacts the pool once holes make up more than this much of it
+constexpr float cMeshBufferDefragRatio = 0.25f;
+// size of the bone palette in the skinned shader variants, bone ids outside it carry no weight
+constexpr uint32_t cMaxBones = 100;
+
+// what the gpu reads for every mesh, 24 bytes. normal and tangent are octahedral, the tangent is 10:10 with the
+// bitangent sign in its 2 bit w, uvs are half floats
+struct PackedVertex {
+    float position[3];
+    int16_t normal[2];
+    uint32_t tangent;
+    uint16_t texCoord[2];
+};
+
+// second stream for skinned meshes only, weights are unorm8 and sum to 255
+struct SkinVertex {
+    uint8_t boneIDs[4];
+    uint8_t weights[4];
+};
+
+struct MeshRange {
+    uint32_t offset;
+    uint32_t count;
+};
+
+// elements below top are either used or in freeRanges, which stays sorted by offset and coalesced
+struct MeshAllocator {
+    uint32_t capacity = 0;
+    uint32_t top = 0;
+    uint32_t freeCount = 0;
+    std::vector<MeshRange> freeRanges;
+};
+
+// one vertex layout. the skinned pool keeps its skin stream parallel to the vertex stream so a single baseVertex
+// addresses both, static meshes never pay for bone data
+struct MeshPool {
+    GLuint vao = 0;
+    GLuint vertexBuffer = 0;
+    GLuint skinBuffer = 0;
+    MeshAllocator vertices;
+};
+
+struct MeshBufferStats {
+    uint32_t meshes = 0;
+    uint32_t defrags = 0;
+    size_t vertexBytes = 0;
+};
+
+// meshes of a layout share one vao that reads the whole pool, indices are shared by both. indices stay relative to
+// the mesh's first vertex and draws add Mesh::baseVertex. created with the first mesh, resources load before the
+// renderer is up
+struct MeshBuffer {
+    MeshPool staticPool;
+    MeshPool skinnedPool;
+    GLuint indexBuffer = 0;
+    MeshAllocator indices;
+    std::vector<Mesh*> meshes;
+    MeshBufferStats stats;
+};
+
+void allocateMeshGeometry(MeshBuffer* buffer, Mesh* mesh);
+void freeMeshGeometry(MeshBuffer* buffer, Mesh* mesh);
+void defragmentMeshBuffer(MeshBuffer* buffer);
+void destroyMeshBuffer(MeshBuffer* buffer);
+GLuint getMeshVertexArray(const MeshBuffer* buffer, bool skinned);
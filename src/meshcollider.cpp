@@ -0,0 +1,359 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+#include <Jolt/Core/StreamWrapper.h>
+#include <Jolt/Physics/Collision/Shape/MeshShape.h>
+#include <Jolt/Physics/Collision/Shape/ConvexHullShape.h>
+#include <Jolt/Physics/Collision/Shape/StaticCompoundShape.h>
+
+#include "meshcollider.h"
+#include "loader.h"
+#include "renderer.h"
+
+static CookedShapeCache cookedShapes;
+
+constexpr uint64_t cFnvOffset = 14695981039346656037ull;
+constexpr uint64_t cFnvPrime = 1099511628211ull;
+
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= cFnvPrime;
+    }
+
+    return hash;
+}
+
+static uint64_t hashVec3(uint64_t hash, vec3 v) {
+    float components[3] = {v.GetX(), v.GetY(), v.GetZ()};
+    return hashBytes(hash, components, sizeof(components));
+}
+
+static uint64_t hashGeometry(const std::vector<vec3>& points, const std::vector<uint32_t>& indices, ColliderType type) {
+    uint64_t hash = hashBytes(cFnvOffset, &cShapeCacheVersion, sizeof(cShapeCacheVersion));
+    hash = hashBytes(hash, &type, sizeof(type));
+    for (const vec3& point : points) {
+        hash = hashVec3(hash, point);
+    }
+
+    // hulls only care about the points
+    if (type == ColliderType::Mesh && !indices.empty()) {
+        hash = hashBytes(hash, indices.data(), indices.size() * sizeof(uint32_t));
+    }
+
+    return hash;
+}
+
+std::string shapeHashToString(uint64_t hash) {
+    std::stringstream stream;
+    stream << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return stream.str();
+}
+
+uint64_t shapeHashFromString(const std::string& hashString) {
+    try {
+        return std::stoull(hashString, nullptr, 16);
+    } catch (...) {
+        std::cerr << "ERROR::MESH_COLLIDER::Invalid shape hash: " << hashString << std::endl;
+        return 0;
+    }
+}
+
+const char* getColliderTypeName(ColliderType type) {
+    switch (type) {
+        case ColliderType::Box:
+            return "box";
+        case ColliderType::ConvexHull:
+            return "convexhull";
+        case ColliderType::Mesh:
+            return "mesh";
+        default:
+            return "none";
+    }
+}
+
+ColliderType getColliderType(const std::string& name) {
+    if (name == "box") {
+        return ColliderType::Box;
+    } else if (name == "convexhull") {
+        return ColliderType::ConvexHull;
+    } else if (name == "mesh") {
+        return ColliderType::Mesh;
+    }
+
+    return ColliderType::None;
+}
+
+static std::string getShapeCacheFile(uint64_t hash) {
+    return std::string(shapeCachePath) + shapeHashToString(hash) + ".jshape";
+}
+
+static void saveShapeToDisk(uint64_t hash, const JPH::Shape* shape) {
+    std::error_code error;
+    std::filesystem::create_directories(shapeCachePath, error);
+
+    std::string path = getShapeCacheFile(hash);
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream) {
+        std::cerr << "ERROR::MESH_COLLIDER::Can't write shape cache file " << path << std::endl;
+        return;
+    }
+
+    JPH::StreamOutWrapper out(stream);
+    out.Write(cShapeCacheMagic);
+    out.Write(cShapeCacheVersion);
+    out.Write(hash);
+
+    JPH::Shape::ShapeToIDMap shapeMap;
+    JPH::Shape::MaterialToIDMap materialMap;
+    shape->SaveWithChildren(out, shapeMap, materialMap);
+
+    if (out.IsFailed()) {
+        std::cerr << "ERROR::MESH_COLLIDER::Failed writing shape cache file " << path << std::endl;
+    }
+}
+
+static JPH::ShapeRefC loadShapeFromDisk(uint64_t hash) {
+    std::ifstream stream(getShapeCacheFile(hash), std::ios::binary);
+    if (!stream) {
+        return nullptr;
+    }
+
+    JPH::StreamInWrapper in(stream);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint64_t fileHash = 0;
+    in.Read(magic);
+    in.Read(version);
+    in.Read(fileHash);
+
+    if (in.IsFailed() || magic != cShapeCacheMagic || version != cShapeCacheVersion || fileHash != hash) {
+        return nullptr;
+    }
+
+    JPH::Shape::IDToShapeMap shapeMap;
+    JPH::Shape::IDToMaterialMap materialMap;
+    JPH::Shape::ShapeResult result = JPH::Shape::sRestoreWithChildren(in, shapeMap, materialMap);
+    if (result.HasError()) {
+        std::cerr << "ERROR::MESH_COLLIDER::Corrupt shape cache file " << getShapeCacheFile(hash) << "\n"
+                  << result.GetError() << std::endl;
+        return nullptr;
+    }
+
+    return result.Get();
+}
+
+// memory first, then the disk cache, the caller only builds the shape when both miss
+static bool findCookedShape(uint64_t hash) {
+    if (cookedShapes.shapes.count(hash)) {
+        cookedShapes.memoryHits++;
+        return true;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    JPH::ShapeRefC shape = loadShapeFromDisk(hash);
+    if (shape == nullptr) {
+        return false;
+    }
+
+    cookedShapes.shapes[hash] = shape;
+    cookedShapes.loadedFromDisk++;
+    cookedShapes.loadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+static void storeCookedShape(uint64_t hash, JPH::ShapeSettings::ShapeResult& result, std::chrono::steady_clock::time_point start) {
+    if (result.HasError()) {
+        std::cerr << "ERROR::MESH_COLLIDER::COOK_FAILED\n"
+                  << result.GetError() << std::endl;
+        return;
+    }
+
+    JPH::ShapeRefC shape = result.Get();
+    cookedShapes.shapes[hash] = shape;
+    cookedShapes.cooked++;
+    cookedShapes.cookMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    saveShapeToDisk(hash, shape.GetPtr());
+}
+
+static uint64_t cookGeometry(const std::vector<vec3>& points, const std::vector<uint32_t>& indices, ColliderType type) {
+    if (points.empty() || (type != ColliderType::ConvexHull && type != ColliderType::Mesh)) {
+        return 0;
+    }
+
+    uint64_t hash = hashGeometry(points, indices, type);
+    if (findCookedShape(hash)) {
+        return hash;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    JPH::ShapeSettings::ShapeResult result;
+
+    if (type == ColliderType::ConvexHull) {
+        JPH::Array<vec3> hullPoints(points.begin(), points.end());
+        JPH::ConvexHullShapeSettings settings(hullPoints);
+        result = settings.Create();
+    } else {
+        JPH::VertexList vertices;
+        vertices.reserve(points.size());
+        for (const vec3& point : points) {
+            vertices.push_back(JPH::Float3(point.GetX(), point.GetY(), point.GetZ()));
+        }
+
+        JPH::IndexedTriangleList triangles;
+        triangles.reserve(indices.size() / 3);
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            triangles.push_back(JPH::IndexedTriangle(indices[i], indices[i + 1], indices[i + 2]));
+        }
+
+        JPH::MeshShapeSettings settings(vertices, triangles);
+        result = settings.Create();
+    }
+
+    storeCookedShape(hash, result, start);
+    return cookedShapes.shapes.count(hash) ? hash : 0;
+}
+
+static void appendMeshGeometry(Mesh* mesh, mat4 transform, std::vector<vec3>* points, std::vector<uint32_t>* indices) {
+    uint32_t baseVertex = static_cast<uint32_t>(points->size());
+    for (const Vertex& vertex : mesh->vertices) {
+        points->push_back(transform * vec3(vertex.position));
+    }
+
+    for (GLuint index : mesh->indices) {
+        indices->push_back(baseVertex + index);
+    }
+}
+
+// bodies only take position and rotation from the entity so the node scale is baked into the points
+uint64_t cookMeshCollider(Mesh* mesh, ColliderType type, vec3 scale) {
+    if (mesh == nullptr) {
+        return 0;
+    }
+
+    std::vector<vec3> points;
+    std::vector<uint32_t> indices;
+    appendMeshGeometry(mesh, mat4::sScale(scale), &points, &indices);
+    return cookGeometry(points, indices, type);
+}
+
+static void collectMeshNodes(ModelNode* node, std::vector<ModelNode*>* nodes) {
+    if (node->mesh != nullptr) {
+        nodes->push_back(node);
+    }
+
+    for (ModelNode* child : node->children) {
+        collectMeshNodes(child, nodes);
+    }
+}
+
+// merges every mesh under rootNode into one shape in the root's space, a single triangle mesh for level geometry
+// or a static compound of hulls so a whole prop ends up as one body
+uint64_t cookModelCollider(ModelNode* rootNode, ColliderType type) {
+    std::vector<ModelNode*> nodes;
+    collectMeshNodes(rootNode, &nodes);
+    if (nodes.empty()) {
+        return 0;
+    }
+
+    mat4 rootInverse = rootNode->transform.Inversed();
+
+    if (type == ColliderType::Mesh) {
+        std::vector<vec3> points;
+        std::vector<uint32_t> indices;
+        for (ModelNode* node : nodes) {
+            appendMeshGeometry(node->mesh, rootInverse * node->transform, &points, &indices);
+        }
+
+        return cookGeometry(points, indices, type);
+    }
+
+    if (type != ColliderType::ConvexHull) {
+        return 0;
+    }
+
+    std::vector<uint64_t> childHashes;
+    std::vector<mat4> childTransforms;
+    uint64_t hash = hashBytes(cFnvOffset, &cShapeCacheVersion, sizeof(cShapeCacheVersion));
+
+    for (ModelNode* node : nodes) {
+        vec3 scale;
+        mat4 relative = (rootInverse * node->transform).Decompose(scale);
+        uint64_t childHash = cookMeshCollider(node->mesh, ColliderType::ConvexHull, scale);
+        if (childHash == 0) {
+            continue;
+        }
+
+        childHashes.push_back(childHash);
+        childTransforms.push_back(relative);
+        hash = hashBytes(hash, &childHash, sizeof(childHash));
+        hash = hashVec3(hash, relative.GetTranslation());
+        hash = hashVec3(hash, relative.GetQuaternion().GetXYZ());
+        float w = relative.GetQuaternion().GetW();
+        hash = hashBytes(hash, &w, sizeof(w));
+    }
+
+    if (childHashes.empty()) {
+        return 0;
+    }
+
+    if (findCookedShape(hash)) {
+        return hash;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    JPH::StaticCompoundShapeSettings settings;
+    for (size_t i = 0; i < childHashes.size(); i++) {
+        settings.AddShape(childTransforms[i].GetTranslation(), childTransforms[i].GetQuaternion(), cookedShapes.shapes[childHashes[i]].GetPtr());
+    }
+
+    JPH::ShapeSettings::ShapeResult result = settings.Create();
+    storeCookedShape(hash, result, start);
+    return cookedShapes.shapes.count(hash) ? hash : 0;
+}
+
+static void cookNodeColliders(ModelNode* node, ColliderType type) {
+    if (node->mesh != nullptr) {
+        vec3 scale;
+        node->transform.Decompose(scale);
+        node->colliderHash = cookMeshCollider(node->mesh, type, scale);
+    }
+
+    for (ModelNode* child : node->children) {
+        cookNodeColliders(child, type);
+    }
+}
+
+// runs at import so placing the model or loading a scene that uses it only has to look the shapes up
+void cookModelColliders(Model* model) {
+    if (model->colliderType != ColliderType::ConvexHull && model->colliderType != ColliderType::Mesh) {
+        return;
+    }
+
+    if (model->mergeStaticColliders) {
+        model->mergedColliderHash = cookModelCollider(model->rootNode, model->colliderType);
+    } else {
+        cookNodeColliders(model->rootNode, model->colliderType);
+    }
+}
+
+JPH::ShapeRefC getCookedShape(uint64_t hash) {
+    if (hash == 0 || !findCookedShape(hash)) {
+        return nullptr;
+    }
+
+    return cookedShapes.shapes[hash];
+}
+
+void clearCookedShapes() {
+    cookedShapes.shapes.clear();
+}
+
+const CookedShapeCache* getCookedShapeCache() {
+    return &cookedShapes;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <Jolt/Jolt.h>
+#include <Jolt/Physics/Collision/Shape/Shape.h>
+
+#include "forward.h"
+#include "utils/mathutils.h"
+
+JPH_SUPPRESS_WARNINGS
+
+constexpr char* shapeCachePath = "..\\data\\shapecache\\";
+constexpr uint32_t cShapeCacheMagic = 0x5350484a;
+// bump when the cooking inputs or settings change so stale cache files are ignored
+constexpr uint32_t cShapeCacheVersion = 1;
+
+enum class ColliderType {
+    None,
+    Box,
+    ConvexHull,
+    Mesh
+};
+
+// cooked shapes are keyed by a hash of the data they were built from, the hash is what rigidbodies store and
+// what the on disk cache file is named after
+struct CookedShapeCache {
+    std::unordered_map<uint64_t, JPH::ShapeRefC> shapes;
+    uint32_t cooked = 0;
+    uint32_t loadedFromDisk = 0;
+    uint32_t memoryHits = 0;
+    double cookMs = 0.0;
+    double loadMs = 0.0;
+};
+
+const char* getColliderTypeName(ColliderType type);
+ColliderType getColliderType(const std::string& name);
+uint64_t cookMeshCollider(Mesh* mesh, ColliderType type, vec3 scale);
+uint64_t cookModelCollider(ModelNode* rootNode, ColliderType type);
+void cookModelColliders(Model* model);
+JPH::ShapeRefC getCookedShape(uint64_t hash);
+void clearCookedShapes();
+const CookedShapeCache* getCookedShapeCache();
+std::string shapeHashToString(uint64_t hash);
+uint64_t shapeHashFromString(const std::string& hashString);
@@ -15,7 +15,6 @@ struct MeshRenderer {
     uint32_t rootEntity;
     GLint vao;
     Mesh* mesh;
-    bool boneMatricesSet = false;
     std::vector<Material*> materials;
     std::vector<SubMesh> subMeshes;
     std::vector<mat4> boneMatrices;
@@ -1,8 +1,10 @@
 #include <iostream>
 #include <cstdarg>
 #include <thread>
+#include <cmath>
 
 #include "physics.h"
+#include "meshcollider.h"
 #include "transform.h"
 #include "scene.h"
 
@@ -17,59 +19,188 @@ static void TraceImpl(const char* inFMT, ...) {
     va_end(list);
 }
 
+MyObjectLayerPairFilter::MyObjectLayerPairFilter(const PhysicsLayers* layers) : mLayers(layers) {}
+
 bool MyObjectLayerPairFilter::ShouldCollide(ObjectLayer inObject1, ObjectLayer inObject2) const {
-    switch (inObject1) {
-        case Layers::NON_MOVING:
-            return inObject2 == Layers::MOVING;  // Non moving only collides with moving
-        case Layers::MOVING:
-            return true;  // Moving collides with everything
-        default:
-            // JPH_ASSERT(false);
-            return false;
-    }
+    return layersCollide(mLayers, inObject1, inObject2);
 }
 
-MyBroadPhaseLayerInterface::MyBroadPhaseLayerInterface() {
-    mObjectToBroadPhase[Layers::NON_MOVING] = BroadPhaseLayers::NON_MOVING;
-    mObjectToBroadPhase[Layers::MOVING] = BroadPhaseLayers::MOVING;
-}
+MyBroadPhaseLayerInterface::MyBroadPhaseLayerInterface(const PhysicsLayers* layers) : mLayers(layers) {}
 
 uint MyBroadPhaseLayerInterface::GetNumBroadPhaseLayers() const {
     return BroadPhaseLayers::NUM_LAYERS;
 }
 
 BroadPhaseLayer MyBroadPhaseLayerInterface::GetBroadPhaseLayer(ObjectLayer inLayer) const {
-    // JPH_ASSERT(inLayer < Layers::NUM_LAYERS);
-    return mObjectToBroadPhase[inLayer];
+    if (inLayer >= mLayers->numLayers) {
+        return BroadPhaseLayers::NON_MOVING;
+    }
+
+    return mLayers->broadPhaseLayers[inLayer];
 }
 
 #if defined(JPH_EXTERNAL_PROFILE) || defined(JPH_PROFILE_ENABLED)
 const char* MyBroadPhaseLayerInterface::GetBroadPhaseLayerName(BroadPhaseLayer inLayer) const {
-    switch ((BroadPhaseLayer::Type)inLayer) {
+    return getBroadPhaseLayerName(inLayer);
+}
+#endif  // JPH_EXTERNAL_PROFILE || JPH_PROFILE_ENABLED
+
+MyObjectVsBroadPhaseLayerFilter::MyObjectVsBroadPhaseLayerFilter(const PhysicsLayers* layers) : mLayers(layers) {}
+
+/// Class that determines if an object layer can collide with a broadphase layer
+bool MyObjectVsBroadPhaseLayerFilter::ShouldCollide(ObjectLayer inLayer1, BroadPhaseLayer inLayer2) const {
+    if (inLayer1 >= mLayers->numLayers) {
+        return false;
+    }
+
+    return (mLayers->broadPhaseMasks[inLayer1] & (1u << static_cast<BroadPhaseLayer::Type>(inLayer2))) != 0;
+}
+
+const char* getBroadPhaseLayerName(BroadPhaseLayer layer) {
+    switch ((BroadPhaseLayer::Type)layer) {
         case (BroadPhaseLayer::Type)BroadPhaseLayers::NON_MOVING:
             return "NON_MOVING";
         case (BroadPhaseLayer::Type)BroadPhaseLayers::MOVING:
             return "MOVING";
+        case (BroadPhaseLayer::Type)BroadPhaseLayers::DEBRIS:
+            return "DEBRIS";
+        case (BroadPhaseLayer::Type)BroadPhaseLayers::SENSOR:
+            return "SENSOR";
         default:
-            // JPH_ASSERT(false);
             return "INVALID";
     }
 }
-#endif  // JPH_EXTERNAL_PROFILE || JPH_PROFILE_ENABLED
 
-/// Class that determines if an object layer can collide with a broadphase layer
-bool MyObjectVsBroadPhaseLayerFilter::ShouldCollide(ObjectLayer inLayer1, BroadPhaseLayer inLayer2) const {
-    switch (inLayer1) {
-        case Layers::NON_MOVING:
-            return inLayer2 == BroadPhaseLayers::MOVING;
-        case Layers::MOVING:
-            return true;
-        default:
-            // JPH_ASSERT(false);
-            return false;
+bool layersCollide(const PhysicsLayers* layers, ObjectLayer layer1, ObjectLayer layer2) {
+    if (layer1 >= layers->numLayers || layer2 >= layers->numLayers) {
+        return false;
+    }
+
+    return (layers->collisionMasks[layer1] & (1u << layer2)) != 0;
+}
+
+// a broadphase tree only needs visiting if some layer mapped into it collides with the querying layer
+void updateBroadPhaseMasks(PhysicsLayers* layers) {
+    for (uint32_t i = 0; i < layers->numLayers; i++) {
+        uint32_t mask = 0;
+        for (uint32_t j = 0; j < layers->numLayers; j++) {
+            if (layers->collisionMasks[i] & (1u << j)) {
+                mask |= 1u << static_cast<BroadPhaseLayer::Type>(layers->broadPhaseLayers[j]);
+            }
+        }
+
+        layers->broadPhaseMasks[i] = mask;
     }
 }
 
+void setLayersCollide(PhysicsLayers* layers, ObjectLayer layer1, ObjectLayer layer2, bool collide) {
+    if (layer1 >= layers->numLayers || layer2 >= layers->numLayers) {
+        return;
+    }
+
+    if (collide) {
+        layers->collisionMasks[layer1] |= 1u << layer2;
+        layers->collisionMasks[layer2] |= 1u << layer1;
+    } else {
+        layers->collisionMasks[layer1] &= ~(1u << layer2);
+        layers->collisionMasks[layer2] &= ~(1u << layer1);
+    }
+
+    updateBroadPhaseMasks(layers);
+}
+
+// the broadphase only reads the layer mapping when a body is added, so bodies already on the layer have to be pulled
+// out of their old tree and re-added to land in the new one
+void setLayerBroadPhase(PhysicsScene* physicsScene, ObjectLayer layer, BroadPhaseLayer broadPhaseLayer) {
+    PhysicsLayers* layers = &physicsScene->layers;
+    if (layer >= layers->numLayers || layers->broadPhaseLayers[layer] == broadPhaseLayer) {
+        return;
+    }
+
+    BodyInterface* bodyInterface = physicsScene->bodyInterface;
+    BodyIDVector bodies;
+    physicsScene->physicsSystem->GetBodies(bodies);
+
+    std::vector<BodyID> activeIDs;
+    std::vector<BodyID> inactiveIDs;
+    for (const BodyID& bodyID : bodies) {
+        if (!bodyInterface->IsAdded(bodyID) || bodyInterface->GetObjectLayer(bodyID) != layer) {
+            continue;
+        }
+
+        if (bodyInterface->IsActive(bodyID)) {
+            activeIDs.push_back(bodyID);
+        } else {
+            inactiveIDs.push_back(bodyID);
+        }
+    }
+
+    if (!activeIDs.empty()) {
+        bodyInterface->RemoveBodies(activeIDs.data(), static_cast<int>(activeIDs.size()));
+    }
+    if (!inactiveIDs.empty()) {
+        bodyInterface->RemoveBodies(inactiveIDs.data(), static_cast<int>(inactiveIDs.size()));
+    }
+
+    layers->broadPhaseLayers[layer] = broadPhaseLayer;
+    updateBroadPhaseMasks(layers);
+
+    if (!activeIDs.empty()) {
+        const int numBodies = static_cast<int>(activeIDs.size());
+        BodyInterface::AddState addState = bodyInterface->AddBodiesPrepare(activeIDs.data(), numBodies);
+        bodyInterface->AddBodiesFinalize(activeIDs.data(), numBodies, addState, EActivation::Activate);
+    }
+    if (!inactiveIDs.empty()) {
+        const int numBodies = static_cast<int>(inactiveIDs.size());
+        BodyInterface::AddState addState = bodyInterface->AddBodiesPrepare(inactiveIDs.data(), numBodies);
+        bodyInterface->AddBodiesFinalize(inactiveIDs.data(), numBodies, addState, EActivation::DontActivate);
+    }
+}
+
+ObjectLayer addPhysicsLayer(PhysicsLayers* layers, std::string name, BroadPhaseLayer broadPhaseLayer) {
+    if (layers->numLayers >= cMaxObjectLayers) {
+        std::cerr << "ERROR::PHYSICS::LAYERS::Too many object layers, max is " << cMaxObjectLayers << std::endl;
+        return cObjectLayerInvalid;
+    }
+
+    ObjectLayer layer = static_cast<ObjectLayer>(layers->numLayers++);
+    layers->names[layer] = name;
+    layers->broadPhaseLayers[layer] = broadPhaseLayer;
+    layers->collisionMasks[layer] = 0;
+    layers->broadPhaseMasks[layer] = 0;
+    layers->contactEvents[layer] = false;
+    return layer;
+}
+
+ObjectLayer findPhysicsLayer(const PhysicsLayers* layers, const std::string& name) {
+    for (uint32_t i = 0; i < layers->numLayers; i++) {
+        if (layers->names[i] == name) {
+            return static_cast<ObjectLayer>(i);
+        }
+    }
+
+    return cObjectLayerInvalid;
+}
+
+void setDefaultPhysicsLayers(PhysicsLayers* layers) {
+    layers->numLayers = 0;
+    addPhysicsLayer(layers, "NON_MOVING", BroadPhaseLayers::NON_MOVING);
+    addPhysicsLayer(layers, "MOVING", BroadPhaseLayers::MOVING);
+    addPhysicsLayer(layers, "DEBRIS", BroadPhaseLayers::DEBRIS);
+    addPhysicsLayer(layers, "SENSOR", BroadPhaseLayers::SENSOR);
+    addPhysicsLayer(layers, "CHARACTER", BroadPhaseLayers::MOVING);
+
+    setLayersCollide(layers, Layers::NON_MOVING, Layers::MOVING, true);
+    setLayersCollide(layers, Layers::NON_MOVING, Layers::DEBRIS, true);
+    setLayersCollide(layers, Layers::NON_MOVING, Layers::CHARACTER, true);
+    setLayersCollide(layers, Layers::MOVING, Layers::MOVING, true);
+    setLayersCollide(layers, Layers::MOVING, Layers::DEBRIS, true);
+    setLayersCollide(layers, Layers::MOVING, Layers::SENSOR, true);
+    setLayersCollide(layers, Layers::MOVING, Layers::CHARACTER, true);
+    setLayersCollide(layers, Layers::SENSOR, Layers::CHARACTER, true);
+    setLayersCollide(layers, Layers::CHARACTER, Layers::CHARACTER, true);
+}
+
 #ifdef JPH_ENABLE_ASSERTS
 // Callback for asserts, connect this to your own assert handler if you have one
 static bool AssertFailedImpl(const char* inExpression, const char* inMessage, const char* inFile, uint inLine) {
@@ -78,70 +209,280 @@ static bool AssertFailedImpl(const char* inExpression, const char* inMessage, co
 
 #endif  // JPH_ENABLE_ASSERTS
 
+static ShapeCache shapeCache;
+
+static int32_t quantizeShapeDimension(float value) {
+    return static_cast<int32_t>(std::lround(value * cShapeQuantization));
+}
+
+static float dequantizeShapeDimension(int32_t value) {
+    return static_cast<float>(value) / cShapeQuantization;
+}
+
+size_t ShapeKeyHasher::operator()(const ShapeKey& key) const {
+    size_t hash = std::hash<uint32_t>()(static_cast<uint32_t>(key.type));
+    for (int i = 0; i < 3; i++) {
+        hash ^= std::hash<int32_t>()(key.dims[i]) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+
+    return hash;
+}
+
+JPH::ShapeRefC getCachedShape(JPH::EShapeSubType type, vec3 halfExtents, float halfHeight, float radius) {
+    ShapeKey key;
+    key.type = type;
+    key.dims[0] = 0;
+    key.dims[1] = 0;
+    key.dims[2] = 0;
+
+    switch (type) {
+        case JPH::EShapeSubType::Box:
+            key.dims[0] = quantizeShapeDimension(halfExtents.GetX());
+            key.dims[1] = quantizeShapeDimension(halfExtents.GetY());
+            key.dims[2] = quantizeShapeDimension(halfExtents.GetZ());
+            break;
+        case JPH::EShapeSubType::Sphere:
+            key.dims[0] = quantizeShapeDimension(radius);
+            break;
+        case JPH::EShapeSubType::Capsule:
+        case JPH::EShapeSubType::Cylinder:
+            key.dims[0] = quantizeShapeDimension(halfHeight);
+            key.dims[1] = quantizeShapeDimension(radius);
+            break;
+        default:
+            std::cerr << "ERROR::PHYSICS::SHAPE_CACHE::UNSUPPORTED_SHAPE_TYPE" << std::endl;
+            return nullptr;
+    }
+
+    auto it = shapeCache.shapes.find(key);
+    if (it != shapeCache.shapes.end()) {
+        shapeCache.hits++;
+        return it->second;
+    }
+
+    shapeCache.misses++;
+    const float x = dequantizeShapeDimension(key.dims[0]);
+    const float y = dequantizeShapeDimension(key.dims[1]);
+    const float z = dequantizeShapeDimension(key.dims[2]);
+    JPH::ShapeSettings::ShapeResult shapeResult;
+
+    if (type == JPH::EShapeSubType::Box) {
+        JPH::BoxShapeSettings boxSettings(vec3(x, y, z));
+        shapeResult = boxSettings.Create();
+    } else if (type == JPH::EShapeSubType::Sphere) {
+        JPH::SphereShapeSettings sphereSettings(x);
+        shapeResult = sphereSettings.Create();
+    } else if (type == JPH::EShapeSubType::Capsule) {
+        JPH::CapsuleShapeSettings capsuleSettings(x, y);
+        shapeResult = capsuleSettings.Create();
+    } else if (type == JPH::EShapeSubType::Cylinder) {
+        JPH::CylinderShapeSettings cylinderSettings(x, y);
+        shapeResult = cylinderSettings.Create();
+    }
+
+    if (shapeResult.HasError()) {
+        std::cerr << "ERROR::PHYSICS::SHAPE_CACHE::CREATE_FAILED\n"
+                  << shapeResult.GetError() << std::endl;
+        return nullptr;
+    }
+
+    JPH::ShapeRefC shape = shapeResult.Get();
+    shapeCache.shapes[key] = shape;
+    shapeCache.shapeKeys[shape.GetPtr()] = key;
+    return shape;
+}
+
+JPH::ShapeRefC getCachedBoxShape(vec3 halfExtents) {
+    return getCachedShape(JPH::EShapeSubType::Box, halfExtents, 0.0f, 0.0f);
+}
+
+void releaseCachedShape(const JPH::Shape* shape) {
+    if (shape == nullptr) {
+        return;
+    }
+
+    auto it = shapeCache.shapeKeys.find(shape);
+    if (it == shapeCache.shapeKeys.end()) {
+        return;
+    }
+
+    // the caller still holds a reference while releasing, anything above that and the cache means a body uses it
+    if (shape->GetRefCount() > 2) {
+        return;
+    }
+
+    shapeCache.shapes.erase(it->second);
+    shapeCache.shapeKeys.erase(it);
+}
+
+void releaseUnusedShapes() {
+    for (auto it = shapeCache.shapes.begin(); it != shapeCache.shapes.end();) {
+        if (it->second->GetRefCount() == 1) {
+            shapeCache.shapeKeys.erase(it->second.GetPtr());
+            it = shapeCache.shapes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void clearShapeCache() {
+    shapeCache.shapeKeys.clear();
+    shapeCache.shapes.clear();
+}
+
+const ShapeCache* getShapeCache() {
+    return &shapeCache;
+}
+
 void initPhysics(Scene* scene) {
     RegisterDefaultAllocator();
     Trace = TraceImpl;
     JPH_IF_ENABLE_ASSERTS(AssertFailed = AssertFailedImpl;)
     Factory::sInstance = new Factory();
     RegisterTypes();
+    // before the job system so its workers register with jolt's profiler, no-op without JPH_PROFILE_ENABLED
+    JPH_PROFILE_START("Main");
     PhysicsScene* physicsScene = &scene->physicsScene;
     physicsScene->physicsSystem = new JPH::PhysicsSystem();
-    physicsScene->tempAllocator = new TempAllocatorImpl(10 * 1024 * 1024);
-    physicsScene->jobSystem = new JobSystemThreadPool(cMaxPhysicsJobs, cMaxPhysicsBarriers, thread::hardware_concurrency() - 1);
-    physicsScene->broad_phase_layer_interface = new MyBroadPhaseLayerInterface();
-    physicsScene->object_vs_broadphase_layer_filter = new MyObjectVsBroadPhaseLayerFilter();
-    physicsScene->object_vs_object_layer_filter = new MyObjectLayerPairFilter();
+    physicsScene->tempAllocator = new TrackingTempAllocator(cDefaultTempAllocatorSize);
+    physicsScene->jobSystem = new ProfilingJobSystem(cMaxPhysicsJobs, cMaxPhysicsBarriers, thread::hardware_concurrency() - 1);
+    physicsScene->profile.tempAllocatorSize = cDefaultTempAllocatorSize;
+    setDefaultPhysicsLayers(&physicsScene->layers);
+    physicsScene->broad_phase_layer_interface = new MyBroadPhaseLayerInterface(&physicsScene->layers);
+    physicsScene->object_vs_broadphase_layer_filter = new MyObjectVsBroadPhaseLayerFilter(&physicsScene->layers);
+    physicsScene->object_vs_object_layer_filter = new MyObjectLayerPairFilter(&physicsScene->layers);
     physicsScene->physicsSystem->Init(cMaxBodies, cNumBodyMutexes, cMaxBodyPairs, cMaxContactConstraints, *physicsScene->broad_phase_layer_interface, *physicsScene->object_vs_broadphase_layer_filter, *physicsScene->object_vs_object_layer_filter);
     physicsScene->physicsSystem->SetGravity(vec3(0.0f, -18.0f, 0.0f));
     physicsScene->bodyInterface = &physicsScene->physicsSystem->GetBodyInterface();
+
+    // one buffer per job system worker plus the thread calling Update, which also runs jobs while it waits
+    initContactEvents(&physicsScene->contactEvents, thread::hardware_concurrency());
+    physicsScene->contactListener = new ContactEventListener(&physicsScene->layers, &physicsScene->contactEvents);
+    physicsScene->physicsSystem->SetContactListener(physicsScene->contactListener);
 }
 
-void initializeRigidbody(RigidBody* rb, PhysicsScene* physicsScene, EntityGroup* entities) {
-    JPH::ObjectLayer objectLayer = rb->layer;
-    JPH::EMotionType motionType = rb->motionType;
-    JPH::EShapeSubType shapeType = rb->shape;
+JPH::ShapeRefC getRigidbodyShape(RigidBody* rb) {
+    switch (rb->shape) {
+        case JPH::EShapeSubType::Mesh:
+        case JPH::EShapeSubType::ConvexHull:
+        case JPH::EShapeSubType::StaticCompound: {
+            JPH::ShapeRefC shape = getCookedShape(rb->cookedShape);
+            if (shape != nullptr) {
+                return shape;
+            }
 
-    JPH::ShapeSettings::ShapeResult shapeResult;
-    JPH::ShapeRefC shape;
+            std::cerr << "ERROR::PHYSICS::COOKED_SHAPE_MISSING::Entity " << rb->entityID << " shape " << shapeHashToString(rb->cookedShape) << ", using a box" << std::endl;
+            return getCachedBoxShape(rb->halfExtents);
+        }
+        default:
+            return getCachedShape(rb->shape, rb->halfExtents, rb->halfHeight, rb->radius);
+    }
+}
 
-    if (shapeType == JPH::EShapeSubType::Box) {
-        JPH::BoxShapeSettings boxSettings(rb->halfExtents);
-        shapeResult = boxSettings.Create();
-        shape = shapeResult.Get();
-    } else if (shapeType == JPH::EShapeSubType::Sphere) {
-        JPH::SphereShapeSettings sphereSettings(rb->radius);
-        shapeResult = sphereSettings.Create();
-        shape = shapeResult.Get();
-    } else if (shapeType == JPH::EShapeSubType::Capsule) {
-        JPH::CapsuleShapeSettings capsuleSettings(rb->halfHeight, rb->radius);
-        shapeResult = capsuleSettings.Create();
-        shape = shapeResult.Get();
-    } else if (shapeType == JPH::EShapeSubType::Cylinder) {
-        JPH::CylinderShapeSettings cylinderSettings(rb->halfHeight, rb->radius);
-        shapeResult = cylinderSettings.Create();
-        shape = shapeResult.Get();
+JPH::Body* createRigidbodyBody(RigidBody* rb, PhysicsScene* physicsScene, vec3 position, quat rotation) {
+    JPH::ShapeRefC shape = getRigidbodyShape(rb);
+    JPH::EMotionType motionType = rb->motionType;
+
+    // triangle meshes have no volume to derive mass from, jolt only supports them on static bodies here
+    const bool isMesh = shape != nullptr && shape->GetSubType() == JPH::EShapeSubType::Mesh;
+    if (isMesh && motionType != JPH::EMotionType::Static) {
+        std::cerr << "ERROR::PHYSICS::CREATE_BODY::Mesh colliders must be static, entity " << rb->entityID << std::endl;
+        motionType = JPH::EMotionType::Static;
     }
 
-    JPH::BodyCreationSettings bodySettings(shape, JPH::RVec3(0.0_r, 0.0_r, 0.0_r), quat::sIdentity(), motionType, objectLayer);
+    JPH::BodyCreationSettings bodySettings(shape, position, rotation, motionType, rb->layer);
     if (rb->rotationLocked) {
         bodySettings.mAllowedDOFs = JPH::EAllowedDOFs::TranslationX | JPH::EAllowedDOFs::TranslationY | JPH::EAllowedDOFs::TranslationZ;
     }
 
-    bodySettings.mAllowDynamicOrKinematic = true;
+    bodySettings.mAllowDynamicOrKinematic = !isMesh;
+    bodySettings.mUserData = rb->entityID;
     JPH::Body* body = physicsScene->bodyInterface->CreateBody(bodySettings);
-    physicsScene->bodyInterface->AddBody(body->GetID(), JPH::EActivation::DontActivate);
+    if (body == nullptr) {
+        std::cerr << "ERROR::PHYSICS::CREATE_BODY::Out of bodies, entity " << rb->entityID << std::endl;
+        return nullptr;
+    }
 
     rb->joltBody = body->GetID();
+    return body;
+}
+
+void initializeRigidbody(RigidBody* rb, PhysicsScene* physicsScene, EntityGroup* entities) {
+    JPH::Body* body = createRigidbodyBody(rb, physicsScene, vec3(0.0f, 0.0f, 0.0f), quat::sIdentity());
+    if (body == nullptr) {
+        return;
+    }
 
-    if (rb->layer == Layers::MOVING) {
+    physicsScene->bodyInterface->AddBody(body->GetID(), JPH::EActivation::DontActivate);
+
+    if (rb->motionType != JPH::EMotionType::Static) {
         entities->movingRigidbodies.insert(rb->entityID);
     }
 }
 
+// creates the bodies at their entity transforms and inserts them into the broadphase in one go, a per body AddBody
+// rebuilds broadphase nodes for every insert which is what made big levels slow to load
+void addRigidbodies(PhysicsScene* physicsScene, EntityGroup* entities, const std::vector<uint32_t>& entityIDs, JPH::EActivation activation) {
+    if (entityIDs.empty()) {
+        return;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    JPH::BodyInterface* bodyInterface = physicsScene->bodyInterface;
+    std::vector<JPH::BodyID> bodyIDs;
+    bodyIDs.reserve(entityIDs.size());
+
+    for (uint32_t entityID : entityIDs) {
+        RigidBody* rb = getRigidbody(entities, entityID);
+        if (rb == nullptr) {
+            continue;
+        }
+
+        const vec3 position = getPosition(entities, entityID);
+        const quat rotation = getRotation(entities, entityID);
+        JPH::Body* body = createRigidbodyBody(rb, physicsScene, position, rotation);
+        if (body == nullptr) {
+            continue;
+        }
+
+        bodyIDs.push_back(body->GetID());
+        rb->lastPosition = position;
+        rb->lastRotation = rotation;
+
+        if (rb->motionType != JPH::EMotionType::Static) {
+            entities->movingRigidbodies.insert(rb->entityID);
+        }
+    }
+
+    const int numBodies = static_cast<int>(bodyIDs.size());
+    if (numBodies > 0) {
+        JPH::BodyInterface::AddState addState = bodyInterface->AddBodiesPrepare(bodyIDs.data(), numBodies);
+        bodyInterface->AddBodiesFinalize(bodyIDs.data(), numBodies, addState, activation);
+    }
+
+    PhysicsLoadStats* stats = &physicsScene->loadStats;
+    stats->broadPhaseOptimized = false;
+    if (numBodies >= cOptimizeBroadPhaseThreshold) {
+        physicsScene->physicsSystem->OptimizeBroadPhase();
+        stats->broadPhaseOptimized = true;
+    }
+
+    stats->lastBatchSize = numBodies;
+    stats->lastBatchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void beginPhysicsLoad(PhysicsScene* physicsScene) {
+    physicsScene->loadStartTime = std::chrono::steady_clock::now();
+    physicsScene->waitingForFirstStep = true;
+}
+
 void updatePhysicsBodyPositions(Scene* scene) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     EntityGroup* entities = &scene->entities;
     JPH::BodyInterface* bodyInterface = scene->physicsScene.bodyInterface;
-    const float t = scene->physicsAccum / cDeltaTime;
+    // the last transforms were taken before the last Update, which may have folded several ticks
+    const float t = JPH::min(static_cast<float>(scene->physicsAccum / scene->physicsScene.lastStepTime), 1.0f);
     for (uint32_t entityID : entities->movingRigidbodies) {
         RigidBody* rigidbody = getRigidbody(entities, entityID);
         vec3 center = rigidbody->center;
@@ -155,6 +496,8 @@ void updatePhysicsBodyPositions(Scene* scene) {
             setRotation(entities, rigidbody->entityID, newRot);
         }
     }
+
+    scene->physicsScene.profile.interpolateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
 static void setPreviousTransforms(Scene* scene) {
@@ -169,19 +512,88 @@ static void setPreviousTransforms(Scene* scene) {
     }
 }
 
+static void stepPhysics(Scene* scene, int ticksDue) {
+    PhysicsScene* physicsScene = &scene->physicsScene;
+    PhysicsStepStats* stats = &physicsScene->stepStats;
+
+    // under load fold several fixed ticks into one Update with more collision steps so the broadphase and job
+    // overhead is paid once, the per collision step delta stays cDeltaTime
+    const int maxSubSteps = JPH::max(physicsScene->maxSubSteps, 1);
+    const int maxCollisionSteps = JPH::max(physicsScene->maxCollisionSteps, 1);
+    int collisionSteps = cCollisionSteps;
+    if (ticksDue > maxSubSteps) {
+        collisionSteps = JPH::min((ticksDue + maxSubSteps - 1) / maxSubSteps, maxCollisionSteps);
+    }
+
+    const int maxTicks = maxSubSteps * collisionSteps;
+    if (ticksDue > maxTicks) {
+        const double dropped = (ticksDue - maxTicks) * cDeltaTime;
+        stats->droppedTime += dropped;
+        scene->physicsAccum -= dropped;
+        ticksDue = maxTicks;
+    }
+
+    beginPhysicsProfile(physicsScene);
+    PhysicsProfile* profile = &physicsScene->profile;
+
+    while (ticksDue > 0) {
+        const int steps = JPH::min(collisionSteps, ticksDue);
+        const double stepTime = steps * cDeltaTime;
+
+        std::chrono::steady_clock::time_point syncStart = std::chrono::steady_clock::now();
+        setPreviousTransforms(scene);
+        std::chrono::steady_clock::time_point stepStart = std::chrono::steady_clock::now();
+        physicsScene->physicsSystem->Update(static_cast<float>(stepTime), steps, physicsScene->tempAllocator, physicsScene->jobSystem);
+        std::chrono::steady_clock::time_point stepEnd = std::chrono::steady_clock::now();
+        collectContactEvents(physicsScene);
+
+        profile->stepMs += std::chrono::duration<double, std::milli>(stepEnd - stepStart).count();
+        profile->syncMs += std::chrono::duration<double, std::milli>((stepStart - syncStart) + (std::chrono::steady_clock::now() - stepEnd)).count();
+        scene->physicsAccum -= stepTime;
+        physicsScene->lastStepTime = stepTime;
+        ticksDue -= steps;
+        stats->stepsThisFrame++;
+        stats->collisionStepsThisFrame += steps;
+    }
+
+    if (physicsScene->waitingForFirstStep) {
+        physicsScene->loadStats.loadToFirstStepMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - physicsScene->loadStartTime).count();
+        physicsScene->waitingForFirstStep = false;
+    }
+
+    endPhysicsProfile(physicsScene);
+}
+
 void updatePhysics(Scene* scene) {
     PhysicsScene* physicsScene = &scene->physicsScene;
+    PhysicsStepStats* stats = &physicsScene->stepStats;
+    stats->stepsThisFrame = 0;
+    stats->collisionStepsThisFrame = 0;
+    stats->droppedTime = 0.0;
+    beginContactEventFrame(&physicsScene->contactEvents);
+
     scene->physicsAccum += scene->deltaTime;
-    if (scene->physicsAccum < cDeltaTime) {
-        return;
+
+    // never carry more than maxAccumulatedTime, a long hitch (loading, breakpoint, window drag) would otherwise be replayed
+    if (scene->physicsAccum > physicsScene->maxAccumulatedTime) {
+        stats->droppedTime += scene->physicsAccum - physicsScene->maxAccumulatedTime;
+        scene->physicsAccum = physicsScene->maxAccumulatedTime;
+    }
+
+    int ticksDue = static_cast<int>(scene->physicsAccum / cDeltaTime);
+    if (ticksDue > 0) {
+        stepPhysics(scene, ticksDue);
     }
 
-    setPreviousTransforms(scene);
-    physicsScene->physicsSystem->Update(cDeltaTime, cCollisionSteps, physicsScene->tempAllocator, physicsScene->jobSystem);
-    scene->physicsAccum -= cDeltaTime;
+    endContactEventFrame(&physicsScene->contactEvents);
+    stats->totalSteps += stats->stepsThisFrame;
+    stats->totalDroppedTime += stats->droppedTime;
+    stats->maxStepsPerFrame = JPH::max(stats->maxStepsPerFrame, stats->stepsThisFrame);
 }
 
 void destroyPhysicsSystem() {
+    clearShapeCache();
+    clearCookedShapes();
     UnregisterTypes();
     delete Factory::sInstance;
     Factory::sInstance = nullptr;
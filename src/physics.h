@@ -16,7 +16,12 @@
 #include <Jolt/Physics/Character/CharacterVirtual.h>
 #include <Jolt/Renderer/DebugRendererSimple.h>
 
+#include <chrono>
+
 #include "ecs.h"
+#include "physicsqueries.h"
+#include "contactevents.h"
+#include "physicsprofiler.h"
 #include "utils/mathutils.h"
 // #include "forward.h"
 
@@ -24,34 +29,88 @@ JPH_SUPPRESS_WARNINGS
 struct Scene;
 struct EntityGroup;
 
-struct PhysicsScene {
-    JPH::PhysicsSystem* physicsSystem;
-    JPH::BodyInterface* bodyInterface;
-    JPH::TempAllocatorImpl* tempAllocator;
-    JPH::JobSystemThreadPool* jobSystem;
-    JPH::BroadPhaseLayerInterface* broad_phase_layer_interface;
-    JPH::ObjectVsBroadPhaseLayerFilter* object_vs_broadphase_layer_filter;
-    JPH::ObjectLayerPairFilter* object_vs_object_layer_filter;
-};
-
 namespace Layers {
 static constexpr JPH::ObjectLayer NON_MOVING = 0;
 static constexpr JPH::ObjectLayer MOVING = 1;
-static constexpr JPH::ObjectLayer NUM_LAYERS = 2;
+static constexpr JPH::ObjectLayer DEBRIS = 2;
+static constexpr JPH::ObjectLayer SENSOR = 3;
+static constexpr JPH::ObjectLayer CHARACTER = 4;
+static constexpr JPH::ObjectLayer NUM_DEFAULT_LAYERS = 5;
 };  // namespace Layers
 
 namespace BroadPhaseLayers {
 static constexpr JPH::BroadPhaseLayer NON_MOVING(0);
 static constexpr JPH::BroadPhaseLayer MOVING(1);
-static constexpr JPH::uint NUM_LAYERS(2);
+static constexpr JPH::BroadPhaseLayer DEBRIS(2);
+static constexpr JPH::BroadPhaseLayer SENSOR(3);
+static constexpr JPH::uint NUM_LAYERS(4);
 };  // namespace BroadPhaseLayers
 
+const JPH::uint cMaxObjectLayers = 16;
+
+// object layers are data driven and saved with the scene, the broadphase layer count is fixed at init so every
+// object layer maps onto one of the BroadPhaseLayers trees
+struct PhysicsLayers {
+    uint32_t numLayers = 0;
+    std::string names[cMaxObjectLayers];
+    JPH::BroadPhaseLayer broadPhaseLayers[cMaxObjectLayers];
+    uint32_t collisionMasks[cMaxObjectLayers] = {};
+    uint32_t broadPhaseMasks[cMaxObjectLayers] = {};
+    // contacts are only reported when one of the two bodies is on a layer that opted in
+    bool contactEvents[cMaxObjectLayers] = {};
+};
+
+struct PhysicsStepStats {
+    uint32_t stepsThisFrame = 0;
+    uint32_t collisionStepsThisFrame = 0;
+    uint32_t maxStepsPerFrame = 0;
+    uint64_t totalSteps = 0;
+    double droppedTime = 0.0;
+    double totalDroppedTime = 0.0;
+};
+
+struct PhysicsLoadStats {
+    uint32_t lastBatchSize = 0;
+    double lastBatchMs = 0.0;
+    double loadToFirstStepMs = 0.0;
+    bool broadPhaseOptimized = false;
+};
+
+constexpr double cDeltaTime = 1.0 / 60.0;
+
+struct PhysicsScene {
+    JPH::PhysicsSystem* physicsSystem;
+    JPH::BodyInterface* bodyInterface;
+    TrackingTempAllocator* tempAllocator;
+    ProfilingJobSystem* jobSystem;
+    JPH::BroadPhaseLayerInterface* broad_phase_layer_interface;
+    JPH::ObjectVsBroadPhaseLayerFilter* object_vs_broadphase_layer_filter;
+    JPH::ObjectLayerPairFilter* object_vs_object_layer_filter;
+    PhysicsLayers layers;
+    PhysicsQueries queries;
+    ContactEvents contactEvents;
+    ContactEventListener* contactListener = nullptr;
+
+    // fixed step scheduler, see updatePhysics
+    int maxSubSteps = 4;
+    int maxCollisionSteps = 4;
+    double maxAccumulatedTime = 0.25;
+    // length of the last Update, longer than cDeltaTime when ticks were folded, interpolation spans this
+    double lastStepTime = cDeltaTime;
+    PhysicsStepStats stepStats;
+
+    std::chrono::steady_clock::time_point loadStartTime;
+    bool waitingForFirstStep = false;
+    PhysicsLoadStats loadStats;
+    PhysicsProfile profile;
+};
+
 const JPH::uint cMaxBodies = 65536;
 const JPH::uint cNumBodyMutexes = 0;
 const JPH::uint cMaxBodyPairs = 65536;
 const JPH::uint cMaxContactConstraints = 10240;
 const JPH::uint cCollisionSteps = 1;
-constexpr double cDeltaTime = 1.0 / 60.0;
+const JPH::uint cOptimizeBroadPhaseThreshold = 1000;
 
 struct RigidBody {
     uint32_t entityID;
@@ -68,6 +127,32 @@ struct RigidBody {
     vec3 lastPosition = vec3(0.0f, 0.0f, 0.0f);
     quat lastRotation = quat(0.0f, 0.0f, 0.0f, 1.0f);
     bool rotationLocked = false;
+    // hash of the cooked mesh, convex hull or compound shape, only used by those shape types
+    uint64_t cookedShape = 0;
+};
+
+// shapes are shared between bodies with the same type and (quantized) dimensions, an entry is evicted once
+// the cache holds the last reference
+constexpr float cShapeQuantization = 10000.0f;
+
+struct ShapeKey {
+    JPH::EShapeSubType type;
+    int32_t dims[3];
+
+    bool operator==(const ShapeKey& other) const {
+        return type == other.type && dims[0] == other.dims[0] && dims[1] == other.dims[1] && dims[2] == other.dims[2];
+    }
+};
+
+struct ShapeKeyHasher {
+    size_t operator()(const ShapeKey& key) const;
+};
+
+struct ShapeCache {
+    std::unordered_map<ShapeKey, JPH::ShapeRefC, ShapeKeyHasher> shapes;
+    std::unordered_map<const JPH::Shape*, ShapeKey> shapeKeys;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
 };
 
 void initPhysics(Scene* scene);
@@ -75,15 +160,37 @@ void updatePhysics(Scene* scene);
 void destroyPhysicsSystem();
 void updatePhysicsBodyPositions(Scene* scene);
 void initializeRigidbody(RigidBody* rb, PhysicsScene* physicsScene, EntityGroup* entities);
+JPH::Body* createRigidbodyBody(RigidBody* rb, PhysicsScene* physicsScene, vec3 position, quat rotation);
+void addRigidbodies(PhysicsScene* physicsScene, EntityGroup* entities, const std::vector<uint32_t>& entityIDs, JPH::EActivation activation);
+void beginPhysicsLoad(PhysicsScene* physicsScene);
+JPH::ShapeRefC getCachedShape(JPH::EShapeSubType type, vec3 halfExtents, float halfHeight, float radius);
+JPH::ShapeRefC getCachedBoxShape(vec3 halfExtents);
+JPH::ShapeRefC getRigidbodyShape(RigidBody* rb);
+void releaseCachedShape(const JPH::Shape* shape);
+void releaseUnusedShapes();
+void clearShapeCache();
+const ShapeCache* getShapeCache();
+void setDefaultPhysicsLayers(PhysicsLayers* layers);
+void updateBroadPhaseMasks(PhysicsLayers* layers);
+void setLayersCollide(PhysicsLayers* layers, JPH::ObjectLayer layer1, JPH::ObjectLayer layer2, bool collide);
+bool layersCollide(const PhysicsLayers* layers, JPH::ObjectLayer layer1, JPH::ObjectLayer layer2);
+void setLayerBroadPhase(PhysicsScene* physicsScene, JPH::ObjectLayer layer, JPH::BroadPhaseLayer broadPhaseLayer);
+JPH::ObjectLayer addPhysicsLayer(PhysicsLayers* layers, std::string name, JPH::BroadPhaseLayer broadPhaseLayer);
+JPH::ObjectLayer findPhysicsLayer(const PhysicsLayers* layers, const std::string& name);
+const char* getBroadPhaseLayerName(JPH::BroadPhaseLayer layer);
 
 class MyObjectLayerPairFilter : public JPH::ObjectLayerPairFilter {
    public:
+    MyObjectLayerPairFilter(const PhysicsLayers* layers);
     virtual bool ShouldCollide(JPH::ObjectLayer inObject1, JPH::ObjectLayer inObject2) const override;
+
+   private:
+    const PhysicsLayers* mLayers;
 };
 
 class MyBroadPhaseLayerInterface final : public JPH::BroadPhaseLayerInterface {
    public:
-    MyBroadPhaseLayerInterface();
+    MyBroadPhaseLayerInterface(const PhysicsLayers* layers);
     virtual JPH::uint GetNumBroadPhaseLayers() const override;
     virtual JPH::BroadPhaseLayer GetBroadPhaseLayer(JPH::ObjectLayer inLayer) const override;
 
@@ -92,11 +199,15 @@ class MyBroadPhaseLayerInterface final : public JPH::BroadPhaseLayerInterface {
 #endif  // JPH_EXTERNAL_PROFILE || JPH_PROFILE_ENABLED
 
    private:
-    JPH::BroadPhaseLayer mObjectToBroadPhase[Layers::NUM_LAYERS];
+    const PhysicsLayers* mLayers;
 };
 
 /// Class that determines if an object layer can collide with a broadphase layer
 class MyObjectVsBroadPhaseLayerFilter : public JPH::ObjectVsBroadPhaseLayerFilter {
    public:
+    MyObjectVsBroadPhaseLayerFilter(const PhysicsLayers* layers);
     virtual bool ShouldCollide(JPH::ObjectLayer inLayer1, JPH::BroadPhaseLayer inLayer2) const override;
+
+   private:
+    const PhysicsLayers* mLayers;
 };
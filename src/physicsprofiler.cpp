@@ -0,0 +1,234 @@
+#include <iostream>
+#include <chrono>
+#include <cstring>
+
+#include <Jolt/Core/Memory.h>
+#include <Jolt/Core/Profiler.h>
+
+#include "physicsprofiler.h"
+#include "physics.h"
+
+TrackingTempAllocator::TrackingTempAllocator(size_t size)
+    : mAllocator(new JPH::TempAllocatorImpl(size)) {}
+
+TrackingTempAllocator::~TrackingTempAllocator() {
+    delete mAllocator;
+}
+
+void* TrackingTempAllocator::Allocate(JPH::uint inSize) {
+    if (inSize == 0) {
+        return nullptr;
+    }
+
+    if (mAllocator->CanAllocate(inSize)) {
+        void* address = mAllocator->Allocate(inSize);
+        peakUsage = JPH::max(peakUsage, mAllocator->GetUsage() + mFallbackUsage);
+        return address;
+    }
+
+    fallbackAllocations++;
+    fallbackBytes += inSize;
+    mFallbackUsage += inSize;
+    peakUsage = JPH::max(peakUsage, mAllocator->GetUsage() + mFallbackUsage);
+    return JPH::AlignedAllocate(inSize, JPH_RVECTOR_ALIGNMENT);
+}
+
+void TrackingTempAllocator::Free(void* inAddress, JPH::uint inSize) {
+    if (inAddress == nullptr) {
+        return;
+    }
+
+    if (mAllocator->OwnsMemory(inAddress)) {
+        mAllocator->Free(inAddress, inSize);
+    } else {
+        mFallbackUsage -= inSize;
+        JPH::AlignedFree(inAddress);
+    }
+}
+
+// the stack has to be empty, which it is between updates
+bool TrackingTempAllocator::resize(size_t size) {
+    if (!mAllocator->IsEmpty() || mFallbackUsage != 0) {
+        return false;
+    }
+
+    delete mAllocator;
+    mAllocator = new JPH::TempAllocatorImpl(size);
+    return true;
+}
+
+size_t TrackingTempAllocator::getSize() const {
+    return mAllocator->GetSize();
+}
+
+ProfilingJobSystem::ProfilingJobSystem(JPH::uint maxJobs, JPH::uint maxBarriers, int numThreads)
+    : mThreadPool(maxJobs, maxBarriers, numThreads) {}
+
+int ProfilingJobSystem::GetMaxConcurrency() const {
+    return mThreadPool.GetMaxConcurrency();
+}
+
+ProfilingJobSystem::Barrier* ProfilingJobSystem::CreateBarrier() {
+    return mThreadPool.CreateBarrier();
+}
+
+void ProfilingJobSystem::DestroyBarrier(Barrier* inBarrier) {
+    mThreadPool.DestroyBarrier(inBarrier);
+}
+
+void ProfilingJobSystem::WaitForJobs(Barrier* inBarrier) {
+    mThreadPool.WaitForJobs(inBarrier);
+}
+
+void ProfilingJobSystem::setNumThreads(int numThreads) {
+    mThreadPool.SetNumThreads(numThreads);
+}
+
+// every job is created by the pool and points back at it, so these are never called
+void ProfilingJobSystem::QueueJob(Job* inJob) {
+    JPH_ASSERT(false);
+}
+
+void ProfilingJobSystem::QueueJobs(Job** inJobs, JPH::uint inNumJobs) {
+    JPH_ASSERT(false);
+}
+
+void ProfilingJobSystem::FreeJob(Job* inJob) {
+    JPH_ASSERT(false);
+}
+
+// jolt names its jobs after the step stage they belong to
+static PhysicsPhase getJobPhase(const char* name) {
+    if (strstr(name, "BroadPhase") || strstr(name, "Broadphase")) {
+        return PHASE_BROADPHASE;
+    } else if (strstr(name, "FindCollisions") || strstr(name, "FindCCDContacts")) {
+        return PHASE_NARROWPHASE;
+    } else if (strstr(name, "Constraint") || strstr(name, "Island") || strstr(name, "Integrate") || strstr(name, "Gravity") || strstr(name, "ResolveCCD")) {
+        return PHASE_SOLVER;
+    }
+
+    return PHASE_OTHER;
+}
+
+ProfilingJobSystem::JobHandle ProfilingJobSystem::CreateJob(const char* inName, JPH::ColorArg inColor, const JobFunction& inJobFunction, JPH::uint32 inNumDependencies) {
+    if (!enabled.load(std::memory_order_relaxed)) {
+        return mThreadPool.CreateJob(inName, inColor, inJobFunction, inNumDependencies);
+    }
+
+    std::atomic<uint64_t>* phaseTime = &phaseNanoseconds[getJobPhase(inName)];
+    JobFunction timedJob = [phaseTime, inJobFunction]() {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        inJobFunction();
+        uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        phaseTime->fetch_add(elapsed, std::memory_order_relaxed);
+    };
+
+    return mThreadPool.CreateJob(inName, inColor, timedJob, inNumDependencies);
+}
+
+const char* getPhysicsPhaseName(PhysicsPhase phase) {
+    switch (phase) {
+        case PHASE_BROADPHASE:
+            return "broadphase";
+        case PHASE_NARROWPHASE:
+            return "narrowphase";
+        case PHASE_SOLVER:
+            return "solver";
+        default:
+            return "other";
+    }
+}
+
+void beginPhysicsProfile(PhysicsScene* physicsScene) {
+    PhysicsProfile* profile = &physicsScene->profile;
+    TrackingTempAllocator* tempAllocator = physicsScene->tempAllocator;
+    physicsScene->jobSystem->enabled.store(profile->enabled, std::memory_order_relaxed);
+
+    profile->stepMs = 0.0;
+    profile->syncMs = 0.0;
+    tempAllocator->peakUsage = 0;
+    tempAllocator->fallbackAllocations = 0;
+    tempAllocator->fallbackBytes = 0;
+}
+
+void endPhysicsProfile(PhysicsScene* physicsScene) {
+    PhysicsProfile* profile = &physicsScene->profile;
+    TrackingTempAllocator* tempAllocator = physicsScene->tempAllocator;
+    JPH::PhysicsSystem* physicsSystem = physicsScene->physicsSystem;
+
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        uint64_t nanoseconds = physicsScene->jobSystem->phaseNanoseconds[i].exchange(0, std::memory_order_relaxed);
+        profile->phaseMs[i] = static_cast<double>(nanoseconds) / 1000000.0;
+    }
+
+    profile->tempAllocatorSize = tempAllocator->getSize();
+    profile->tempPeakBytes = tempAllocator->peakUsage;
+    profile->tempPeakBytesEver = JPH::max(profile->tempPeakBytesEver, tempAllocator->peakUsage);
+    profile->tempFallbacks = tempAllocator->fallbackAllocations;
+    profile->tempFallbackBytes = tempAllocator->fallbackBytes;
+    profile->totalTempFallbacks += tempAllocator->fallbackAllocations;
+
+    if (tempAllocator->fallbackAllocations > 0) {
+        std::cerr << "ERROR::PHYSICS::TEMP_ALLOCATOR::Out of temp memory, " << tempAllocator->fallbackAllocations << " allocations (" << tempAllocator->fallbackBytes << " bytes) fell back to the heap, peak " << tempAllocator->peakUsage << " of " << profile->tempAllocatorSize << std::endl;
+    }
+
+    if (profile->autoSizeTempAllocator && tempAllocator->peakUsage > profile->tempAllocatorSize * cTempAllocatorGrowThreshold) {
+        size_t size = static_cast<size_t>(tempAllocator->peakUsage * cTempAllocatorHeadroom);
+        size = (size + cTempAllocatorGranularity - 1) / cTempAllocatorGranularity * cTempAllocatorGranularity;
+        resizeTempAllocator(physicsScene, size);
+    }
+
+    JPH::BodyManager::BodyStats bodyStats = physicsSystem->GetBodyStats();
+    profile->numBodies = bodyStats.mNumBodies;
+    profile->numStaticBodies = bodyStats.mNumBodiesStatic;
+    profile->numDynamicBodies = bodyStats.mNumBodiesDynamic;
+    profile->numKinematicBodies = bodyStats.mNumBodiesKinematic;
+    profile->numActiveBodies = physicsSystem->GetNumActiveBodies(JPH::EBodyType::RigidBody);
+    profile->numConstraints = static_cast<uint32_t>(physicsSystem->GetConstraints().size());
+    profile->numContactPairs = physicsScene->contactEvents.lastContactPairs;
+
+    JPH_PROFILE_NEXTFRAME();
+}
+
+const PhysicsProfile* getPhysicsProfile(const PhysicsScene* physicsScene) {
+    return &physicsScene->profile;
+}
+
+bool resizeTempAllocator(PhysicsScene* physicsScene, size_t size) {
+    if (!physicsScene->tempAllocator->resize(size)) {
+        std::cerr << "ERROR::PHYSICS::TEMP_ALLOCATOR::Can't resize while allocations are live" << std::endl;
+        return false;
+    }
+
+    physicsScene->profile.tempAllocatorSize = size;
+    physicsScene->profile.tempResizes++;
+    std::cerr << "Physics temp allocator resized to " << size / (1024 * 1024) << " MB" << std::endl;
+    return true;
+}
+
+void writePhysicsProfile(const PhysicsProfile* profile, std::ostream& stream) {
+    stream << "{";
+    stream << "\"stepMs\": " << profile->stepMs << ", ";
+    stream << "\"syncMs\": " << profile->syncMs << ", ";
+    stream << "\"interpolateMs\": " << profile->interpolateMs << ", ";
+    stream << "\"phaseMs\": {";
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        stream << "\"" << getPhysicsPhaseName(static_cast<PhysicsPhase>(i)) << "\": " << profile->phaseMs[i] << (i + 1 < PHASE_COUNT ? ", " : "");
+    }
+    stream << "}, ";
+    stream << "\"tempAllocator\": {";
+    stream << "\"size\": " << profile->tempAllocatorSize << ", ";
+    stream << "\"peak\": " << profile->tempPeakBytes << ", ";
+    stream << "\"peakEver\": " << profile->tempPeakBytesEver << ", ";
+    stream << "\"fallbacks\": " << profile->tempFallbacks << ", ";
+    stream << "\"totalFallbacks\": " << profile->totalTempFallbacks << ", ";
+    stream << "\"resizes\": " << profile->tempResizes << "}, ";
+    stream << "\"bodies\": " << profile->numBodies << ", ";
+    stream << "\"activeBodies\": " << profile->numActiveBodies << ", ";
+    stream << "\"staticBodies\": " << profile->numStaticBodies << ", ";
+    stream << "\"dynamicBodies\": " << profile->numDynamicBodies << ", ";
+    stream << "\"kinematicBodies\": " << profile->numKinematicBodies << ", ";
+    stream << "\"constraints\": " << profile->numConstraints << ", ";
+    stream << "\"contactPairs\": " << profile->numContactPairs;
+    stream << "}";
+}
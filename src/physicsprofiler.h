@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <ostream>
+
+#include <Jolt/Jolt.h>
+#include <Jolt/Core/TempAllocator.h>
+#include <Jolt/Core/JobSystemThreadPool.h>
+
+JPH_SUPPRESS_WARNINGS
+struct PhysicsScene;
+
+constexpr size_t cDefaultTempAllocatorSize = 10 * 1024 * 1024;
+constexpr size_t cTempAllocatorGranularity = 1024 * 1024;
+// auto sizing grows to the peak times this once the peak gets within cTempAllocatorGrowThreshold of the capacity
+constexpr float cTempAllocatorHeadroom = 1.5f;
+constexpr float cTempAllocatorGrowThreshold = 0.9f;
+
+enum PhysicsPhase {
+    PHASE_BROADPHASE,
+    PHASE_NARROWPHASE,
+    PHASE_SOLVER,
+    PHASE_OTHER,
+    PHASE_COUNT
+};
+
+// jolt's TempAllocatorImpl asserts or falls over when it runs out, this one falls back to the heap and counts it
+class TrackingTempAllocator : public JPH::TempAllocator {
+   public:
+    explicit TrackingTempAllocator(size_t size);
+    ~TrackingTempAllocator() override;
+    void* Allocate(JPH::uint inSize) override;
+    void Free(void* inAddress, JPH::uint inSize) override;
+    bool resize(size_t size);
+    size_t getSize() const;
+
+    size_t peakUsage = 0;
+    uint32_t fallbackAllocations = 0;
+    size_t fallbackBytes = 0;
+
+   private:
+    JPH::TempAllocatorImpl* mAllocator;
+    size_t mFallbackUsage = 0;
+};
+
+// times every job jolt creates and buckets it by name, only wraps jobs while enabled since that copies the job function.
+// JobSystemThreadPool is final so this sits in front of one and forwards to it, the jobs and barriers it hands out
+// belong to the pool, which queues and frees them itself
+class ProfilingJobSystem : public JPH::JobSystem {
+   public:
+    ProfilingJobSystem(JPH::uint maxJobs, JPH::uint maxBarriers, int numThreads);
+    int GetMaxConcurrency() const override;
+    JobHandle CreateJob(const char* inName, JPH::ColorArg inColor, const JobFunction& inJobFunction, JPH::uint32 inNumDependencies = 0) override;
+    Barrier* CreateBarrier() override;
+    void DestroyBarrier(Barrier* inBarrier) override;
+    void WaitForJobs(Barrier* inBarrier) override;
+    void setNumThreads(int numThreads);
+
+    std::atomic<bool> enabled{false};
+    std::atomic<uint64_t> phaseNanoseconds[PHASE_COUNT]{};
+
+   protected:
+    void QueueJob(Job* inJob) override;
+    void QueueJobs(Job** inJobs, JPH::uint inNumJobs) override;
+    void FreeJob(Job* inJob) override;
+
+   private:
+    JPH::JobSystemThreadPool mThreadPool;
+};
+
+// per frame numbers, phase times are summed job time across all threads so they can add up to more than stepMs
+struct PhysicsProfile {
+    bool enabled = false;
+    bool autoSizeTempAllocator = false;
+
+    double stepMs = 0.0;
+    double syncMs = 0.0;
+    double interpolateMs = 0.0;
+    double phaseMs[PHASE_COUNT] = {};
+
+    size_t tempAllocatorSize = 0;
+    size_t tempPeakBytes = 0;
+    size_t tempPeakBytesEver = 0;
+    uint32_t tempFallbacks = 0;
+    size_t tempFallbackBytes = 0;
+    uint32_t totalTempFallbacks = 0;
+    uint32_t tempResizes = 0;
+
+    uint32_t numBodies = 0;
+    uint32_t numActiveBodies = 0;
+    uint32_t numStaticBodies = 0;
+    uint32_t numDynamicBodies = 0;
+    uint32_t numKinematicBodies = 0;
+    uint32_t numConstraints = 0;
+    uint32_t numContactPairs = 0;
+};
+
+const char* getPhysicsPhaseName(PhysicsPhase phase);
+void beginPhysicsProfile(PhysicsScene* physicsScene);
+void endPhysicsProfile(PhysicsScene* physicsScene);
+const PhysicsProfile* getPhysicsProfile(const PhysicsScene* physicsScene);
+bool resizeTempAllocator(PhysicsScene* physicsScene, size_t size);
+void writePhysicsProfile(const PhysicsProfile* profile, std::ostream& stream);
@@ -0,0 +1,136 @@
+#include <iostream>
+#include <chrono>
+
+#include <Jolt/Physics/Collision/RayCast.h>
+#include <Jolt/Physics/Collision/CastResult.h>
+#include <Jolt/Physics/Collision/ShapeCast.h>
+#include <Jolt/Physics/Collision/CollisionCollectorImpl.h>
+#include <Jolt/Physics/Collision/NarrowPhaseQuery.h>
+#include <Jolt/Physics/Body/BodyFilter.h>
+#include <Jolt/Physics/Body/BodyLock.h>
+
+#include "physicsqueries.h"
+#include "physics.h"
+
+QueryHandle queueRaycast(PhysicsQueries* queries, vec3 origin, vec3 direction, JPH::ObjectLayer layer, JPH::BodyID ignoreBody) {
+    QueryRequest request;
+    request.type = QueryType::Ray;
+    request.origin = origin;
+    request.direction = direction;
+    request.layer = layer;
+    request.ignoreBody = ignoreBody;
+    queries->pending.push_back(request);
+    return static_cast<QueryHandle>(queries->pending.size() - 1);
+}
+
+QueryHandle queueSphereCast(PhysicsQueries* queries, vec3 origin, vec3 direction, float radius, JPH::ObjectLayer layer, JPH::BodyID ignoreBody) {
+    QueryRequest request;
+    request.type = QueryType::ShapeCast;
+    request.origin = origin;
+    request.direction = direction;
+    request.shape = getCachedShape(JPH::EShapeSubType::Sphere, vec3::sZero(), 0.0f, radius);
+    request.layer = layer;
+    request.ignoreBody = ignoreBody;
+    queries->pending.push_back(request);
+    return static_cast<QueryHandle>(queries->pending.size() - 1);
+}
+
+static void executeQuery(PhysicsScene* physicsScene, const QueryRequest* request, QueryResult* result) {
+    const JPH::NarrowPhaseQuery& narrowPhase = physicsScene->physicsSystem->GetNarrowPhaseQuery();
+    JPH::DefaultBroadPhaseLayerFilter broadPhaseFilter(*physicsScene->object_vs_broadphase_layer_filter, request->layer);
+    JPH::DefaultObjectLayerFilter objectLayerFilter(*physicsScene->object_vs_object_layer_filter, request->layer);
+    JPH::IgnoreSingleBodyFilter bodyFilter(request->ignoreBody);
+
+    *result = QueryResult();
+    JPH::SubShapeID subShapeID;
+
+    if (request->type == QueryType::Ray) {
+        JPH::RRayCast ray(request->origin, request->direction);
+        JPH::RayCastResult hit;
+        if (!narrowPhase.CastRay(ray, hit, broadPhaseFilter, objectLayerFilter, bodyFilter)) {
+            return;
+        }
+
+        result->fraction = hit.mFraction;
+        result->point = ray.GetPointOnRay(hit.mFraction);
+        result->bodyID = hit.mBodyID;
+        subShapeID = hit.mSubShapeID2;
+    } else {
+        if (request->shape == nullptr) {
+            return;
+        }
+
+        JPH::RShapeCast shapeCast(request->shape, vec3::sReplicate(1.0f), JPH::RMat44::sTranslation(request->origin), request->direction);
+        JPH::ShapeCastSettings settings;
+        JPH::ClosestHitCollisionCollector<JPH::CastShapeCollector> collector;
+        narrowPhase.CastShape(shapeCast, settings, JPH::RVec3::sZero(), collector, broadPhaseFilter, objectLayerFilter, bodyFilter);
+        if (!collector.HadHit()) {
+            return;
+        }
+
+        result->fraction = collector.mHit.mFraction;
+        result->point = collector.mHit.mContactPointOn2;
+        result->normal = -collector.mHit.mPenetrationAxis.NormalizedOr(vec3(0.0f, 1.0f, 0.0f));
+        result->bodyID = collector.mHit.mBodyID2;
+    }
+
+    result->hit = true;
+
+    JPH::BodyLockRead lock(physicsScene->physicsSystem->GetBodyLockInterface(), result->bodyID);
+    if (lock.Succeeded()) {
+        const JPH::Body& body = lock.GetBody();
+        result->entityID = static_cast<uint32_t>(body.GetUserData());
+        if (request->type == QueryType::Ray) {
+            result->normal = body.GetWorldSpaceSurfaceNormal(subShapeID, result->point);
+        }
+    }
+}
+
+void flushPhysicsQueries(PhysicsScene* physicsScene) {
+    PhysicsQueries* queries = &physicsScene->queries;
+    std::swap(queries->pending, queries->executing);
+    queries->pending.clear();
+
+    const uint32_t numQueries = static_cast<uint32_t>(queries->executing.size());
+    queries->results.resize(numQueries);
+    queries->lastFlushCount = numQueries;
+    if (numQueries == 0) {
+        queries->lastFlushMs = 0.0;
+        return;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // small batches aren't worth the job overhead
+    if (numQueries <= cQueriesPerJob) {
+        for (uint32_t i = 0; i < numQueries; i++) {
+            executeQuery(physicsScene, &queries->executing[i], &queries->results[i]);
+        }
+    } else {
+        JPH::JobSystem* jobSystem = physicsScene->jobSystem;
+        JPH::JobSystem::Barrier* barrier = jobSystem->CreateBarrier();
+
+        for (uint32_t first = 0; first < numQueries; first += cQueriesPerJob) {
+            uint32_t last = JPH::min(first + cQueriesPerJob, numQueries);
+            JPH::JobSystem::JobHandle job = jobSystem->CreateJob("PhysicsQueries", JPH::Color::sGreen, [physicsScene, queries, first, last]() {
+                for (uint32_t i = first; i < last; i++) {
+                    executeQuery(physicsScene, &queries->executing[i], &queries->results[i]);
+                }
+            });
+            barrier->AddJob(job);
+        }
+
+        jobSystem->WaitForJobs(barrier);
+        jobSystem->DestroyBarrier(barrier);
+    }
+
+    queries->lastFlushMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const QueryResult* getQueryResult(PhysicsQueries* queries, QueryHandle handle) {
+    if (handle == INVALID_QUERY || handle >= queries->results.size()) {
+        return nullptr;
+    }
+
+    return &queries->results[handle];
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <Jolt/Jolt.h>
+#include <Jolt/Physics/Body/BodyID.h>
+#include <Jolt/Physics/Collision/ObjectLayer.h>
+#include <Jolt/Physics/Collision/Shape/Shape.h>
+
+#include "utils/mathutils.h"
+
+struct PhysicsScene;
+
+// queries are queued by any system during the frame and run together on the job system in flushPhysicsQueries,
+// results stay valid until the next flush so a system reads the answer to last frame's request
+typedef uint32_t QueryHandle;
+constexpr QueryHandle INVALID_QUERY = 0xFFFFFFFF;
+constexpr uint32_t cQueriesPerJob = 32;
+
+enum class QueryType {
+    Ray,
+    ShapeCast
+};
+
+struct QueryRequest {
+    QueryType type;
+    vec3 origin;
+    vec3 direction;  // full cast length, not normalized
+    JPH::ShapeRefC shape;
+    JPH::ObjectLayer layer;
+    JPH::BodyID ignoreBody;
+};
+
+struct QueryResult {
+    bool hit = false;
+    float fraction = 1.0f;
+    vec3 point = vec3(0.0f, 0.0f, 0.0f);
+    vec3 normal = vec3(0.0f, 0.0f, 0.0f);
+    JPH::BodyID bodyID;
+    uint32_t entityID = 0xFFFFFFFF;
+};
+
+struct PhysicsQueries {
+    std::vector<QueryRequest> pending;
+    std::vector<QueryRequest> executing;
+    std::vector<QueryResult> results;
+    uint32_t lastFlushCount = 0;
+    double lastFlushMs = 0.0;
+};
+
+QueryHandle queueRaycast(PhysicsQueries* queries, vec3 origin, vec3 direction, JPH::ObjectLayer layer, JPH::BodyID ignoreBody = JPH::BodyID());
+QueryHandle queueSphereCast(PhysicsQueries* queries, vec3 origin, vec3 direction, float radius, JPH::ObjectLayer layer, JPH::BodyID ignoreBody = JPH::BodyID());
+void flushPhysicsQueries(PhysicsScene* physicsScene);
+const QueryResult* getQueryResult(PhysicsQueries* queries, QueryHandle handle);
@@ -0,0 +1,64 @@
+#include "picking.h"
+
+void createPicker(GpuPicker* picker) {
+    glCreateBuffers(1, &picker->pbo);
+    glNamedBufferStorage(picker->pbo, 4, nullptr, GL_CLIENT_STORAGE_BIT);
+}
+
+void destroyPicker(GpuPicker* picker) {
+    if (picker->fence != nullptr) {
+        glDeleteSync(picker->fence);
+    }
+
+    glDeleteBuffers(1, &picker->pbo);
+    *picker = GpuPicker();
+}
+
+// a new click replaces a readback that hasn't come back yet
+void requestPick(GpuPicker* picker, GLint x, GLint y) {
+    if (picker->fence != nullptr) {
+        glDeleteSync(picker->fence);
+        picker->fence = nullptr;
+    }
+
+    picker->x = x;
+    picker->y = y;
+    picker->requested = true;
+}
+
+// through the center of the picked pixel, the far plane point is the same for either depth range
+void getPickRay(const GpuPicker* picker, const mat4& viewProjection, vec3 cameraPosition, GLsizei width, GLsizei height, vec3* direction) {
+    const float ndcX = (picker->x + 0.5f) / width * 2.0f - 1.0f;
+    const float ndcY = (picker->y + 0.5f) / height * 2.0f - 1.0f;
+    vec4 farPoint = viewProjection.Inversed() * vec4(ndcX, ndcY, 1.0f, 1.0f);
+    *direction = vec3(farPoint) / farPoint.GetW() - cameraPosition;
+}
+
+// runs right after the picking pass with the picking target bound, the copy lands in the pbo asynchronously
+void readPickPixel(GpuPicker* picker) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, picker->pbo);
+    glReadPixels(picker->x, picker->y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    picker->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    picker->requested = false;
+}
+
+bool pollPick(GpuPicker* picker, uint32_t* entityID) {
+    if (picker->fence == nullptr) {
+        return false;
+    }
+
+    const GLenum status = glClientWaitSync(picker->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return false;
+    }
+
+    glDeleteSync(picker->fence);
+    picker->fence = nullptr;
+
+    unsigned char pixel[4];
+    glGetNamedBufferSubData(picker->pbo, 0, 4, pixel);
+    *entityID = pixel[0] + (pixel[1] << 8) + (pixel[2] << 16);
+    return true;
+}
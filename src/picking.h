@@ -0,0 +1,24 @@
+#pragma once
+#include "utils/mathutils.h"
+
+// side of the scissor square drawn around the cursor, only its center pixel is read back
+constexpr GLsizei cPickRegionSize = 8;
+
+// click driven gpu picking. a request draws the objects under the cursor into a scissored square around the pixel
+// and reads that pixel into a pbo behind a fence, pollPick collects it on a later frame without stalling
+struct GpuPicker {
+    GLuint pbo = 0;
+    GLsync fence = nullptr;
+    // pixel in the picking target, origin bottom left
+    GLint x = 0;
+    GLint y = 0;
+    // set by requestPick, cleared once the picking pass has drawn it
+    bool requested = false;
+};
+
+void createPicker(GpuPicker* picker);
+void destroyPicker(GpuPicker* picker);
+void requestPick(GpuPicker* picker, GLint x, GLint y);
+void getPickRay(const GpuPicker* picker, const mat4& viewProjection, vec3 cameraPosition, GLsizei width, GLsizei height, vec3* direction);
+void readPickPixel(GpuPicker* picker);
+bool pollPick(GpuPicker* picker, uint32_t* entityID);
@@ -109,6 +109,24 @@ void updatePlayer(Scene* scene, Resources* resources, RenderState* renderer) {
 
     finalMove.SetY(bodyInterface->GetLinearVelocity(rb->joltBody).GetY());
 
+    // answer to last frame's ground check, flushed after updatePlayer
+    PhysicsQueries* queries = &scene->physicsScene.queries;
+    const QueryResult* groundResult = getQueryResult(queries, player->groundQuery);
+    player->isGrounded = groundResult != nullptr && groundResult->hit;
+
+    float bottomOffset = rb->halfExtents.GetY();
+    if (rb->shape == JPH::EShapeSubType::Capsule) {
+        bottomOffset = rb->halfHeight + rb->radius;
+    } else if (rb->shape == JPH::EShapeSubType::Cylinder) {
+        bottomOffset = rb->halfHeight;
+    } else if (rb->shape == JPH::EShapeSubType::Sphere) {
+        bottomOffset = rb->radius;
+    }
+
+    vec3 rayOrigin = bodyInterface->GetPosition(rb->joltBody);
+    vec3 rayDirection = vec3(0.0f, -(bottomOffset + player->groundCheckDistance), 0.0f);
+    player->groundQuery = queueRaycast(queries, rayOrigin, rayDirection, rb->layer, rb->joltBody);
+
     if (input->jump) {
         if (player->isGrounded && player->canJump) {
             finalMove.SetY(player->jumpHeight);
@@ -118,7 +136,6 @@ void updatePlayer(Scene* scene, Resources* resources, RenderState* renderer) {
         player->canJump = true;
     }
 
-    player->isGrounded = true;
     bodyInterface->SetLinearVelocity(rb->joltBody, finalMove);
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 #include "forward.h"
+#include "physicsqueries.h"
 
 struct CameraController {
     uint32_t entityID;
@@ -22,6 +23,7 @@ struct Player {
     float jumpHeight = 10.0f;
     float moveSpeed = 10.0f;
     float groundCheckDistance = 0.2f;
+    QueryHandle groundQuery = INVALID_QUERY;
 };
 
 void updatePlayer(Scene* scene, Resources* resources, RenderState* renderer);
@@ -20,249 +20,170 @@ static void setInitialFlags() {
     glClearColor(0.0, 0.0, 0.0, 0.0);
 }
 
-void drawPickingScene(RenderState* renderer, EntityGroup* entities) {
-    Camera* camera = &entities->cameras[0];
-    MeshRenderer* meshRenderer;
-    Mesh* mesh;
-    SubMesh* subMesh;
+static void drawIndirect(RenderState* renderer, uint32_t first, uint32_t end) {
+    if (first == end) {
+        return;
+    }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, renderer->pickingFBO);
-    glViewport(0, 0, renderer->windowData.viewportWidth, renderer->windowData.viewportHeight);
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glUseProgram(renderer->pickingShader);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(first * sizeof(DrawElementsCommand)), static_cast<GLsizei>(end - first), 0);
+    renderer->stats.submits++;
+}
+
+// consecutive batches go out as one multi draw. a run breaks where the vertex layout changes, static and skinned
+// meshes live in separate pools and draw with their own program variant, so per pass uniforms have to be set on
+// both beforehand. skinned batches also break it to upload their bone palette, passes without skinning pass no bone
+// uniform and only break on the layout
+static void submitBatches(RenderState* renderer, RenderQueueRange range, GLuint staticProgram, GLuint skinnedProgram, const Uniform<mat4>* boneMatrices) {
+    RenderWorld* world = &renderer->world;
+    RenderQueue* queue = &renderer->queue;
+    const uint32_t end = range.first + range.count;
+    uint32_t runStart = range.first;
+    bool skinned = false;
+
+    for (uint32_t i = range.first; i < end; i++) {
+        RenderBatch* batch = &queue->batches[i];
+        RenderDraw* draw = &world->draws[batch->draw];
+        RenderObject* object = &world->objects[draw->object];
+        renderer->stats.draws++;
+        renderer->stats.instances += batch->instanceCount;
+
+        if (i == range.first || draw->skinned != skinned) {
+            drawIndirect(renderer, runStart, i);
+            runStart = i;
+            skinned = draw->skinned;
+            bindProgram(renderer, skinned ? skinnedProgram : staticProgram);
+            bindVertexArray(renderer, getMeshVertexArray(&renderer->meshes, skinned));
+        }
 
-    for (int i = 0; i < entities->meshRenderers.size(); i++) {
-        meshRenderer = &entities->meshRenderers[i];
-        mesh = meshRenderer->mesh;
-        if (mesh == nullptr) {
+        if (boneMatrices == nullptr || !skinned || object->boneCount == 0) {
             continue;
         }
 
-        Transform* transform = getTransform(entities, meshRenderer->entityID);
+        drawIndirect(renderer, runStart, i);
+        setUniform(*boneMatrices, &world->boneMatrices[object->firstBone], object->boneCount);
+        renderer->stats.boneUploads++;
+        drawIndirect(renderer, i, i + 1);
+        runStart = i + 1;
+    }
 
-        mat4 model = transform->worldTransform;
-        glBindVertexArray(mesh->VAO);
-        unsigned char r = meshRenderer->entityID & 0xFF;
-        unsigned char g = (meshRenderer->entityID >> 8) & 0xFF;
-        unsigned char b = (meshRenderer->entityID >> 16) & 0xFF;
-        vec3 idColor = vec3(r, g, b) / 255.0f;
-        glUniformMatrix4fv(uniform_location::kModelMatrix, 1, GL_FALSE, &model(0, 0));
-        glUniform3fv(uniform_location::kColor, 1, idColor.mF32);
+    drawIndirect(renderer, runStart, end);
+}
 
-        for (int i = 0; i < mesh->subMeshes.size(); i++) {
-            subMesh = &mesh->subMeshes[i];
-            glDrawElements(GL_TRIANGLES, subMesh->indexCount, GL_UNSIGNED_INT, (void*)(subMesh->indexOffset * sizeof(unsigned int)));
-        }
+// only runs on a pick request. the pass is scissored to a small square around the cursor and the pixel goes back
+// through the picker's pbo, nothing here waits on the gpu
+void drawPickingScene(RenderState* renderer) {
+    GpuPicker* picker = &renderer->picker;
+    RenderQueue* queue = &renderer->queue;
+    RenderQueueRange range = getRenderQueueRange(queue, cRenderViewPicking);
+
+    if (!picker->requested) {
+        return;
     }
+
+    resetGLStateCache(&renderer->glState);
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer->pickingFBO);
+    glViewport(0, 0, renderer->windowData.viewportWidth, renderer->windowData.viewportHeight);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(picker->x - cPickRegionSize / 2, picker->y - cPickRegionSize / 2, cPickRegionSize, cPickRegionSize);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    submitBatches(renderer, range, renderer->pickingShader, renderer->pickingShader, nullptr);
+    glDisable(GL_SCISSOR_TEST);
+
+    readPickPixel(picker);
 }
 
-static void drawShadowMaps(RenderState* renderer, EntityGroup* entities) {
-    vec3 position;
-    mat4 viewMatrix;
-    mat4 projectionMatrix;
-    mat4 viewProjection;
-    mat4 model;
-    GLint boneMatrixLoc = glGetUniformLocation(renderer->depthShader, "finalBoneMatrices[0]");
-    MeshRenderer* meshRenderer;
-    Mesh* mesh;
-    SubMesh* subMesh;
-
-    for (int i = 0; i < entities->spotLights.size(); i++) {
-        SpotLight* light = &entities->spotLights[i];
-        if (!light->enableShadows || !light->isActive) {
-            continue;
+// only tiles the atlas scheduled this frame. the static layer is redrawn into its cache when stale, then copied
+// into the depth atlas under the dynamic casters and filtered into the tile the lit pass samples
+static void drawShadowMaps(RenderState* renderer, const RenderGraphPass* pass) {
+    RenderWorld* world = &renderer->world;
+    RenderQueue* queue = &renderer->queue;
+    ShadowAtlas* atlas = &renderer->shadowAtlas;
+
+    resetGLStateCache(&renderer->glState);
+    glEnable(GL_SCISSOR_TEST);
+
+    for (uint32_t i = 0; i < world->shadowPasses.size(); i++) {
+        RenderShadowPass* shadowPass = &world->shadowPasses[i];
+        RenderSpotLight* light = &world->spotLights[shadowPass->light];
+        const uint32_t view = cRenderViewShadow + cRenderViewsPerShadowPass * i;
+
+        glViewport(light->atlasX, light->atlasY, light->atlasSize, light->atlasSize);
+        glScissor(light->atlasX, light->atlasY, light->atlasSize, light->atlasSize);
+        for (GLuint program : {renderer->depthShader, renderer->depthSkinnedShader}) {
+            bindProgram(renderer, program);
+            glUniformMatrix4fv(1, 1, GL_FALSE, &light->lightSpaceMatrix(0, 0));
         }
 
-        position = getPosition(entities, light->entityID);
-        viewMatrix = mat4::sLookAt(position, position + transformForward(entities, light->entityID), transformUp(entities, light->entityID));
-        projectionMatrix = mat4::sPerspective(JPH::DegreesToRadians(light->outerCutoff) * 2.0f, 1.0f, 2.1f, light->range);
-        viewProjection = projectionMatrix * viewMatrix;
-        light->lightSpaceMatrix = viewProjection;
-
-        glViewport(0, 0, light->shadowWidth, light->shadowHeight);
-        glBindFramebuffer(GL_FRAMEBUFFER, light->depthFrameBuffer);
-        glClear(GL_DEPTH_BUFFER_BIT);
-
-        glUseProgram(renderer->depthShader);
-        glUniformMatrix4fv(1, 1, GL_FALSE, &viewProjection(0, 0));
-        glUniform3fv(glGetUniformLocation(renderer->depthShader, "lightPos"), 1, position.mF32);
-        glUniform1f(glGetUniformLocation(renderer->depthShader, "farPlane"), 200.0f);
-
-        for (int i = 0; i < entities->meshRenderers.size(); i++) {
-            meshRenderer = &entities->meshRenderers[i];
-            mesh = meshRenderer->mesh;
-            if (mesh == nullptr) {
-                continue;
-            }
-
-            model = getTransform(entities, meshRenderer->entityID)->worldTransform;
-            glUniformMatrix4fv(2, 1, GL_FALSE, &model(0, 0));
-
-            if (!meshRenderer->boneMatricesSet && meshRenderer->boneMatrices.size() > 0) {
-                Transform* boneTransform;
-                uint32_t index;
-                mat4 offset;
-                meshRenderer->boneMatricesSet = true;
-
-                for (const auto& pair : meshRenderer->transformBoneMap) {
-                    boneTransform = getTransform(entities, pair.first);
-                    index = pair.second.id;
-                    offset = pair.second.offset;
-                    meshRenderer->boneMatrices[index] = (getTransform(entities, meshRenderer->rootEntity)->worldTransform).Inversed() * boneTransform->worldTransform * offset;
-                }
-
-                glUniformMatrix4fv(boneMatrixLoc, meshRenderer->boneMatrices.size(), GL_FALSE, &meshRenderer->boneMatrices[0](0, 0));
-            }
-
-            glBindVertexArray(mesh->VAO);
-
-            for (int i = 0; i < mesh->subMeshes.size(); i++) {
-                subMesh = &mesh->subMeshes[i];
-                glDrawElements(GL_TRIANGLES, subMesh->indexCount, GL_UNSIGNED_INT, (void*)(subMesh->indexOffset * sizeof(GLsizei)));
-            }
+        if (shadowPass->redrawStatic) {
+            glBindFramebuffer(GL_FRAMEBUFFER, atlas->staticFBO);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            submitBatches(renderer, getRenderQueueRange(queue, view), renderer->depthShader, renderer->depthSkinnedShader, &renderer->depthUniforms.boneMatrices);
         }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, light->blurDepthFrameBuffer);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glUseProgram(renderer->shadowBlurShader);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, light->depthTex);
-        glBindVertexArray(renderer->fullscreenVAO);
+        glCopyImageSubData(atlas->staticTex, GL_TEXTURE_2D, 0, light->atlasX, light->atlasY, 0, atlas->depthTex, GL_TEXTURE_2D, 0, light->atlasX, light->atlasY, 0, light->atlasSize, light->atlasSize, 1);
+        glBindFramebuffer(GL_FRAMEBUFFER, atlas->depthFBO);
+        submitBatches(renderer, getRenderQueueRange(queue, view + 1), renderer->depthShader, renderer->depthSkinnedShader, &renderer->depthUniforms.boneMatrices);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, atlas->blurFBO);
+        bindProgram(renderer, renderer->shadowBlurShader);
+        glUniform4f(0, static_cast<float>(light->atlasX) / cShadowAtlasSize, static_cast<float>(light->atlasY) / cShadowAtlasSize, static_cast<float>(light->atlasSize) / cShadowAtlasSize, static_cast<float>(light->atlasSize) / cShadowAtlasSize);
+        bindTexture(renderer, 0, atlas->depthTex);
+        bindVertexArray(renderer, renderer->fullscreenVAO);
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
     }
 
+    glDisable(GL_SCISSOR_TEST);
     glViewport(0, 0, renderer->windowData.viewportWidth, renderer->windowData.viewportHeight);
 }
 
-static void drawScene(RenderState* renderer, EntityGroup* entities) {
-    uint32_t offset;
-    mat4 model;
-    MeshRenderer* meshRenderer;
-    Mesh* mesh;
-    SubMesh* subMesh;
-    Material* material;
-    PointLight* pointLight;
-    SpotLight* spotLight;
-    Camera* camera = &entities->cameras[0];
+// lights and their light space matrices live in the cluster buffers, only the shadow atlas is bound here
+static void setLightingUniforms(RenderState* renderer, GLuint program, const LightingShaderUniforms* uniforms) {
+    RenderWorld* world = &renderer->world;
+    LightClusters* clusters = &renderer->clusters;
 
-    glBindFramebuffer(GL_FRAMEBUFFER, renderer->litFBO);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    glUseProgram(renderer->lightingShader);
-    glUniform3fv(8, 1, getLocalPosition(entities, camera->entityID).mF32);
+    bindProgram(renderer, program);
+    glUniform3fv(8, 1, world->cameraPosition.mF32);
     glUniform1f(9, renderer->bloomThreshold);
     glUniform1f(35, renderer->ambient);
-    glUniform1i(6, entities->spotLights.size());
-    glUniform1i(7, entities->pointLights.size());
-    glUniform1f(glGetUniformLocation(renderer->lightingShader, "fogDensity"), renderer->fogDensity);
-    glUniform1f(glGetUniformLocation(renderer->lightingShader, "minFogDistance"), renderer->minFogDistance);
-    glUniform1f(glGetUniformLocation(renderer->lightingShader, "maxFogDistance"), renderer->maxFogDistance);
-    glUniform3fv(glGetUniformLocation(renderer->lightingShader, "fogColor"), 1, renderer->fogColor.mF32);
-
-    for (uint32_t i = 0; i < entities->pointLights.size(); i++) {
-        pointLight = &entities->pointLights[i];
-        offset = i * 4;
-        glUniform3fv(36 + 0 + offset, 1, getPosition(entities, pointLight->entityID).mF32);
-        glUniform3fv(36 + 1 + offset, 1, pointLight->color.mF32);
-        glUniform1f(36 + 2 + offset, pointLight->brightness);
-    }
+    setUniform(uniforms->fogDensity, renderer->fogDensity);
+    setUniform(uniforms->minFogDistance, renderer->minFogDistance);
+    setUniform(uniforms->maxFogDistance, renderer->maxFogDistance);
+    setUniform(uniforms->fogColor, renderer->fogColor);
 
-    for (uint32_t i = 0; i < entities->spotLights.size(); i++) {
-        spotLight = &entities->spotLights[i];
-        offset = i * 8;
-        glUniform3fv(120 + 0 + offset, 1, getPosition(entities, spotLight->entityID).mF32);
-        glUniform3fv(120 + 1 + offset, 1, transformForward(entities, spotLight->entityID).mF32);
-        glUniform3fv(120 + 2 + offset, 1, spotLight->color.mF32);
-        glUniform1f(120 + 3 + offset, spotLight->brightness);
-        glUniform1f(120 + 4 + offset, JPH::Cos(JPH::DegreesToRadians(spotLight->cutoff)));
-        glUniform1f(120 + 5 + offset, JPH::Cos(JPH::DegreesToRadians(spotLight->outerCutoff)));
-        glUniform1i(120 + 6 + offset, spotLight->isActive);
-        glUniform1i(120 + 7 + offset, spotLight->enableShadows);
-        glUniformMatrix4fv(15 + i, 1, GL_FALSE, &spotLight->lightSpaceMatrix(0, 0));
-        glUniform1f(glGetUniformLocation(renderer->lightingShader, "u_LightRadiusUV"), spotLight->lightRadiusUV);
-        glUniform1f(glGetUniformLocation(renderer->lightingShader, "u_BlockerSearchUV"), spotLight->blockerSearchUV);
-        glActiveTexture(GL_TEXTURE0 + uniform_location::kTextureShadowMapUnit + i);
-        glBindTexture(GL_TEXTURE_2D, spotLight->blurDepthTex);
-    }
+    setUniform(uniforms->clusterTileSize, glm::vec2(static_cast<float>(renderer->windowData.viewportWidth) / cClusterGridX, static_cast<float>(renderer->windowData.viewportHeight) / cClusterGridY));
+    setUniform(uniforms->clusterScale, clusters->sliceScale);
+    setUniform(uniforms->clusterBias, clusters->sliceBias);
+}
 
-    for (int i = 0; i < entities->meshRenderers.size(); i++) {
-        meshRenderer = &entities->meshRenderers[i];
-        mesh = meshRenderer->mesh;
-        if (mesh == nullptr) {
-            continue;
-        }
+static void drawScene(RenderState* renderer, const RenderGraphPass* pass) {
+    RenderQueue* queue = &renderer->queue;
+    RenderQueueRange range = getRenderQueueRange(queue, cRenderViewLit);
 
-        if (meshRenderer->boneMatrices.size() > 0) {
-            if (!meshRenderer->boneMatricesSet) {
-                Transform* boneTransform;
-                uint32_t index;
-                mat4 offset;
-                meshRenderer->boneMatricesSet = true;
-
-                for (const auto& pair : meshRenderer->transformBoneMap) {
-                    boneTransform = getTransform(entities, pair.first);
-                    index = pair.second.id;
-                    offset = pair.second.offset;
-                    meshRenderer->boneMatrices[index] = (getTransform(entities, meshRenderer->rootEntity)->worldTransform).Inversed() * boneTransform->worldTransform * offset;
-                }
-            }
-            // glUniformMatrix4fv(boneMatrixLoc, meshRenderer.boneMatrices.size(), GL_FALSE, &meshRenderer.boneMatrices[0](0, 0));
-            meshRenderer->boneMatricesSet = false;
-            glUniformMatrix4fv(glGetUniformLocation(renderer->lightingShader, "finalBoneMatrices[0]"), meshRenderer->boneMatrices.size(), GL_FALSE, &meshRenderer->boneMatrices[0](0, 0));
-        }
+    resetGLStateCache(&renderer->glState);
 
-        model = getTransform(entities, meshRenderer->entityID)->worldTransform;
-        glUniformMatrix4fv(4, 1, GL_FALSE, &model(0, 0));
-        glBindVertexArray(mesh->VAO);
-
-        for (int i = 0; i < mesh->subMeshes.size(); i++) {
-            subMesh = &mesh->subMeshes[i];
-            material = subMesh->material;
-            const std::vector<Texture*>& textures = material->textures;
-
-            glUniform1f(10, material->metalness);
-            glUniform1f(11, material->roughness);
-            glUniform1f(12, material->aoStrength);
-            glUniform1f(13, material->normalStrength);
-
-#ifdef PETES_EDITOR
-            // vec4 baseColor = scene->pickedEntity == meshRenderer->entityID ? vec4(0.0f, 1.0f, 0.0f, 1.0f) : material->baseColor;
-            vec4 baseColor = material->baseColor;
-            glUniform3fv(14, 1, baseColor.mF32);
-#else
-            glUniform3fv(14, 1, material->baseColor.mF32);
-#endif
-            glUniform2fv(glGetUniformLocation(renderer->lightingShader, "textureTiling"), 1, glm::value_ptr(material->textureTiling));
-
-            glActiveTexture(GL_TEXTURE0 + uniform_location::kTextureAlbedoUnit);
-            glBindTexture(GL_TEXTURE_2D, textures[0]->id);
-            glActiveTexture(GL_TEXTURE0 + uniform_location::kTextureRoughnessUnit);
-            glBindTexture(GL_TEXTURE_2D, textures[1]->id);
-            glActiveTexture(GL_TEXTURE0 + uniform_location::kTextureMetallicUnit);
-            glBindTexture(GL_TEXTURE_2D, textures[2]->id);
-            glActiveTexture(GL_TEXTURE0 + uniform_location::kTextureAOUnit);
-            glBindTexture(GL_TEXTURE_2D, textures[3]->id);
-            glActiveTexture(GL_TEXTURE0 + uniform_location::kTextureNormalUnit);
-            glBindTexture(GL_TEXTURE_2D, textures[4]->id);
-
-            glDrawElements(GL_TRIANGLES, subMesh->indexCount, GL_UNSIGNED_INT, (void*)(subMesh->indexOffset * sizeof(unsigned int)));
-        }
-    }
+    setLightingUniforms(renderer, renderer->lightingShader, &renderer->lightingUniforms);
+    setLightingUniforms(renderer, renderer->lightingSkinnedShader, &renderer->lightingSkinnedUniforms);
+
+    bindTexture(renderer, uniform_location::kTextureShadowAtlasUnit, renderer->shadowAtlas.blurTex);
+
+    // materials come from the table through the instance's material index, nothing is bound per draw
+    bindMaterialTextures(renderer);
+
+    submitBatches(renderer, range, renderer->lightingShader, renderer->lightingSkinnedShader, &renderer->lightingSkinnedUniforms.boneMatrices);
 }
 
-static void drawSSAO(RenderState* renderer) {
-    glBindFramebuffer(GL_FRAMEBUFFER, renderer->ssaoFBO);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+// reads view position and view normal
+static void drawSSAO(RenderState* renderer, const RenderGraphPass* pass) {
+    RenderGraph* graph = &renderer->graph;
+
     glUseProgram(renderer->ssaoShader);
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, renderer->ssaoPosTex);
+    glBindTexture(GL_TEXTURE_2D, getRenderGraphTexture(graph, pass->reads[0]));
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, renderer->ssaoNormalTex);
+    glBindTexture(GL_TEXTURE_2D, getRenderGraphTexture(graph, pass->reads[1]));
     glActiveTexture(GL_TEXTURE2);
     glBindTexture(GL_TEXTURE_2D, renderer->ssaoNoiseTex);
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, renderer->bloomSSAOTex);
 
     glUniform1f(6, renderer->AORadius);
     glUniform1f(7, renderer->AOBias);
@@ -272,117 +193,107 @@ static void drawSSAO(RenderState* renderer) {
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 }
 
-static void drawBlurPass(RenderState* renderer) {
-    bool horizontalBlur = false;
-    const uint32_t amount = 10;
-    glUseProgram(renderer->blurShader);
+// a box the size of the noise tile, which is all the noise the ssao kernel rotation leaves behind
+static void drawAOBlur(RenderState* renderer, const RenderGraphPass* pass) {
+    glUseProgram(renderer->simpleBlurShader);
     glActiveTexture(GL_TEXTURE0);
-    glBindFramebuffer(GL_FRAMEBUFFER, renderer->blurFBO[1]);
-    glUniform1i(uniform_location::kBHorizontal, true);
-    glBindTexture(GL_TEXTURE_2D, renderer->blurTex);
+    glBindTexture(GL_TEXTURE_2D, getRenderGraphTexture(&renderer->graph, pass->reads[0]));
+    glBindVertexArray(renderer->fullscreenVAO);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+// narrows sampling to one level so a level can be read while the next one is drawn
+static void setSourceLevel(GLuint texture, GLint level) {
+    glTextureParameteri(texture, GL_TEXTURE_BASE_LEVEL, level);
+    glTextureParameteri(texture, GL_TEXTURE_MAX_LEVEL, level);
+}
+
+// the bright pass is filtered down the mip chain and added back up it, level 0 ends up holding every level summed.
+// each level only costs a quarter of the one above it
+static void drawBloom(RenderState* renderer, const RenderGraphPass* pass) {
+    RenderGraph* graph = &renderer->graph;
+    const RenderGraphResource chain = pass->writes[0];
+    const GLuint chainTex = getRenderGraphTexture(graph, chain);
+    const GLint levels = graph->resources[chain].levels;
+
     glBindVertexArray(renderer->fullscreenVAO);
+    glUseProgram(renderer->bloomDownsampleShader);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(uniform_location::kBFirstLevel, true);
+    glBindTexture(GL_TEXTURE_2D, getRenderGraphTexture(graph, pass->reads[0]));
+    bindRenderGraphTarget(graph, chain, 0);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-    for (uint32_t i = 0; i < amount - 1; i++) {
-        glBindFramebuffer(GL_FRAMEBUFFER, renderer->blurFBO[horizontalBlur]);
-        glUniform1i(uniform_location::kBHorizontal, horizontalBlur);
-        glBindTexture(GL_TEXTURE_2D, renderer->blurSwapTex[!horizontalBlur]);
+    glUniform1i(uniform_location::kBFirstLevel, false);
+    glBindTexture(GL_TEXTURE_2D, chainTex);
+    for (GLint level = 1; level < levels; level++) {
+        setSourceLevel(chainTex, level - 1);
+        bindRenderGraphTarget(graph, chain, level);
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-        horizontalBlur = !horizontalBlur;
     }
+
+    glUseProgram(renderer->bloomUpsampleShader);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    for (GLint level = levels - 2; level >= 0; level--) {
+        setSourceLevel(chainTex, level + 1);
+        bindRenderGraphTarget(graph, chain, level);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+    glDisable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glTextureParameteri(chainTex, GL_TEXTURE_BASE_LEVEL, 0);
+    glTextureParameteri(chainTex, GL_TEXTURE_MAX_LEVEL, levels - 1);
 }
 
 void MyDebugRenderer::DrawLine(JPH::RVec3Arg inFrom, JPH::RVec3Arg inTo, JPH::ColorArg inColor) {
-    lines.push_back({inFrom, inTo, inColor});
+    pushDebugLine(&buffer, inFrom, inTo, inColor);
 }
 
 void MyDebugRenderer::DrawTriangle(JPH::RVec3Arg inV1, const JPH::RVec3Arg inV2, const JPH::RVec3Arg inV3, JPH::ColorArg inColor, ECastShadow inCastShadow) {
-    triangles.push_back({inV1, inV2, inV3, inColor});
+    pushDebugTriangle(&buffer, inV1, inV2, inV3, inColor);
 }
 
 void MyDebugRenderer::DrawText3D(JPH::RVec3Arg inPosition, const std::string_view& inString, JPH::ColorArg inColor, float inHeight) {
     // Implement
 }
 
-void MyDebugRenderer::Clear() {
-    lines.clear();
-    triangles.clear();
-}
-
 void renderDebug(RenderState* renderer) {
-    glDisable(GL_DEPTH_TEST);
-    glUseProgram(renderer->debugShader);
     MyDebugRenderer* debug = static_cast<MyDebugRenderer*>(renderer->debugRenderer);
-    std::vector<DebugVertex> lineVerts;
 
-    for (DebugLine& line : debug->lines) {
-        lineVerts.push_back({line.start, line.color.ToVec4()});
-        lineVerts.push_back({line.end, line.color.ToVec4()});
-    }
-
-    GLuint lineVBO, lineVAO;
-    glGenVertexArrays(1, &lineVAO);
-    glGenBuffers(1, &lineVBO);
-    glBindVertexArray(lineVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, lineVBO);
-    glBufferData(GL_ARRAY_BUFFER, lineVerts.size() * sizeof(DebugVertex), lineVerts.data(), GL_DYNAMIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), (void*)offsetof(DebugVertex, color));
-    glEnableVertexAttribArray(1);
-
-    glDrawArrays(GL_LINES, 0, lineVerts.size());
-
-    glDeleteBuffers(1, &lineVBO);
-    glDeleteVertexArrays(1, &lineVAO);
-
-    // Triangles
-    std::vector<DebugVertex> triVerts;
-    for (DebugTri& tri : debug->triangles) {
-        triVerts.push_back({tri.v0, tri.color.ToVec4()});
-        triVerts.push_back({tri.v1, tri.color.ToVec4()});
-        triVerts.push_back({tri.v2, tri.color.ToVec4()});
-    }
-
-    GLuint triVBO, triVAO;
-    glGenVertexArrays(1, &triVAO);
-    glGenBuffers(1, &triVBO);
-    glBindVertexArray(triVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, triVBO);
-    glBufferData(GL_ARRAY_BUFFER, triVerts.size() * sizeof(DebugVertex), triVerts.data(), GL_DYNAMIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), (void*)offsetof(DebugVertex, color));
-    glEnableVertexAttribArray(1);
-
-    glDrawArrays(GL_TRIANGLES, 0, triVerts.size());
-
-    glDeleteBuffers(1, &triVBO);
-    glDeleteVertexArrays(1, &triVAO);
-
-    debug->Clear();
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(renderer->debugShader);
+    drawDebugBuffer(&debug->buffer);
+    endDebugFrame(&debug->buffer);
     glEnable(GL_DEPTH_TEST);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-static void drawFullScreenQuad(RenderState* renderer) {
+// writes every pixel of the final target, so it neither clears nor depth tests it
+static void drawFullScreenQuad(RenderState* renderer, const RenderGraphPass* pass) {
+    RenderGraph* graph = &renderer->graph;
+
     glViewport(0, 0, renderer->windowData.viewportWidth, renderer->windowData.viewportHeight);
     glBindFramebuffer(GL_FRAMEBUFFER, renderer->finalBuffer);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glDisable(GL_DEPTH_TEST);
 
+    // the bloom chain sums its levels, dividing by the count keeps bloomAmount what it was for a single blur
+    const GLint bloomLevels = graph->resources[pass->reads[1]].levels;
     glUseProgram(renderer->postProcessShader);
     glUniform1f(uniform_location::kPExposure, renderer->exposure);
-    glUniform1f(uniform_location::kPBloomAmount, renderer->bloomAmount);
+    glUniform1f(uniform_location::kPBloomAmount, renderer->bloomAmount / bloomLevels);
     glUniform1f(uniform_location::kAOAmount, renderer->AOAmount);
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, renderer->litColorTex);
+    glBindTexture(GL_TEXTURE_2D, getRenderGraphTexture(graph, pass->reads[0]));
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, renderer->blurSwapTex[1]);
+    glBindTexture(GL_TEXTURE_2D, getRenderGraphTexture(graph, pass->reads[1]));
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, getRenderGraphTexture(graph, pass->reads[2]));
     glBindVertexArray(renderer->fullscreenVAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glEnable(GL_DEPTH_TEST);
 }
 
 static void createPickingFBO(RenderState* renderer) {
@@ -411,154 +322,6 @@ static void createPickingFBO(RenderState* renderer) {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void createSpotLightShadowMap(SpotLight* light) {
-    light->shadowWidth = 1024.0f;
-    light->shadowHeight = 1024.0f;
-    glGenFramebuffers(1, &light->depthFrameBuffer);
-    glGenTextures(1, &light->depthTex);
-    glBindTexture(GL_TEXTURE_2D, light->depthTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, light->shadowWidth, light->shadowHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    float borderColor[] = {1.0, 1.0, 1.0, 1.0};
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-    glBindFramebuffer(GL_FRAMEBUFFER, light->depthFrameBuffer);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, light->depthTex, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "ERROR::FRAMEBUFFER:: Depth framebuffer is not complete!" << std::endl;
-    }
-
-    glGenFramebuffers(1, &light->blurDepthFrameBuffer);
-    glGenTextures(1, &light->blurDepthTex);
-    glBindFramebuffer(GL_FRAMEBUFFER, light->blurDepthFrameBuffer);
-    glBindTexture(GL_TEXTURE_2D, light->blurDepthTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, light->shadowWidth, light->shadowHeight, 0, GL_RED, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, light->blurDepthTex, 0);
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "ERROR::FRAMEBUFFER:: Depth framebuffer is not complete!" << std::endl;
-    }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
-
-void deleteSpotLightShadowMap(SpotLight* light) {
-    // this may break if the textures/framebuffers haven't been created in the case of a prefab. we'll see.
-    GLuint textures[2] = {light->depthTex, light->blurDepthTex};
-    GLuint frameBuffers[2] = {light->depthFrameBuffer, light->blurDepthFrameBuffer};
-    glDeleteTextures(2, textures);
-    glDeleteFramebuffers(2, frameBuffers);
-}
-
-static void createShadowMapDepthBuffers(EntityGroup* entities) {  // this needs to just be callable per light, not looping over every light.
-    for (SpotLight& light : entities->spotLights) {
-        light.shadowWidth = 512.0f;
-        light.shadowHeight = 512.0f;
-        glGenFramebuffers(1, &light.depthFrameBuffer);
-        glGenTextures(1, &light.depthTex);
-        glBindTexture(GL_TEXTURE_2D, light.depthTex);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, light.shadowWidth, light.shadowHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-        float borderColor[] = {1.0, 1.0, 1.0, 1.0};
-        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-        glBindFramebuffer(GL_FRAMEBUFFER, light.depthFrameBuffer);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, light.depthTex, 0);
-        glDrawBuffer(GL_NONE);
-        glReadBuffer(GL_NONE);
-
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-            std::cerr << "ERROR::FRAMEBUFFER:: Depth framebuffer is not complete!" << std::endl;
-        }
-
-        glGenFramebuffers(1, &light.blurDepthFrameBuffer);
-        glGenTextures(1, &light.blurDepthTex);
-        glBindFramebuffer(GL_FRAMEBUFFER, light.blurDepthFrameBuffer);
-        glBindTexture(GL_TEXTURE_2D, light.blurDepthTex);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, light.shadowWidth, light.shadowHeight, 0, GL_RED, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, light.blurDepthTex, 0);
-
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-            std::cerr << "ERROR::FRAMEBUFFER:: Depth framebuffer is not complete!" << std::endl;
-        }
-
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    }
-}
-
-static void createForwardBuffer(RenderState* renderer) {
-    GLsizei width = renderer->windowData.viewportWidth;
-    GLsizei height = renderer->windowData.viewportHeight;
-    GLenum attachments[4] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3};
-
-    glGenFramebuffers(1, &renderer->litFBO);
-    glGenTextures(1, &renderer->litColorTex);
-    glGenTextures(1, &renderer->bloomSSAOTex);
-    glGenTextures(1, &renderer->ssaoNormalTex);
-    glGenTextures(1, &renderer->ssaoPosTex);
-    glGenRenderbuffers(1, &renderer->litRBO);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, renderer->litFBO);
-
-    glBindTexture(GL_TEXTURE_2D, renderer->litColorTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    glBindTexture(GL_TEXTURE_2D, renderer->bloomSSAOTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    glBindTexture(GL_TEXTURE_2D, renderer->ssaoPosTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    // normal color buffer
-    glBindTexture(GL_TEXTURE_2D, renderer->ssaoNormalTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    glBindRenderbuffer(GL_RENDERBUFFER, renderer->litRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->litColorTex, 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, renderer->bloomSSAOTex, 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, renderer->ssaoPosTex, 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, renderer->ssaoNormalTex, 0);
-    glDrawBuffers(4, attachments);
-
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderer->litRBO);
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "ERROR::FRAMEBUFFER:: GBuffer framebuffer is not complete!" << std::endl;
-    }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
-
 static void createEditorBuffer(RenderState* renderer) {
     GLint width = renderer->windowData.viewportWidth;
     GLint height = renderer->windowData.viewportHeight;
@@ -583,87 +346,10 @@ static void createEditorBuffer(RenderState* renderer) {
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
-static void createSSAOBuffer(RenderState* renderer) {
-    glGenFramebuffers(1, &renderer->ssaoFBO);
-    glGenTextures(1, &renderer->blurTex);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, renderer->ssaoFBO);
-    glBindTexture(GL_TEXTURE_2D, renderer->blurTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, renderer->windowData.viewportWidth, renderer->windowData.viewportHeight, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->blurTex, 0);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "ERROR::FRAMEBUFFER:: SSAO Color framebuffer is not complete!" << std::endl;
-    }
-}
-
-static void createBlurBuffers(RenderState* renderer) {
-    GLsizei width = renderer->windowData.viewportWidth;
-    GLsizei height = renderer->windowData.viewportHeight;
-
-    glGenFramebuffers(2, renderer->blurFBO);
-    glGenTextures(2, renderer->blurSwapTex);
-
-    for (unsigned int i = 0; i < 2; i++) {
-        glBindFramebuffer(GL_FRAMEBUFFER, renderer->blurFBO[i]);
-        glBindTexture(GL_TEXTURE_2D, renderer->blurSwapTex[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->blurSwapTex[i], 0);
-
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-            std::cerr << "ERROR::FRAMEBUFFER:: Blur framebuffer is not complete!" << std::endl;
-        }
-    }
-}
-
+// only the targets that outlive a frame, everything between passes belongs to the render graph
 static void resizeBuffers(RenderState* renderer) {
     uint32_t width = renderer->windowData.viewportWidth;
     uint32_t height = renderer->windowData.viewportHeight;
-    GLenum attachments[4] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3};
-
-    glBindFramebuffer(GL_FRAMEBUFFER, renderer->litFBO);
-    glBindTexture(GL_TEXTURE_2D, renderer->litColorTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glBindTexture(GL_TEXTURE_2D, renderer->bloomSSAOTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glBindTexture(GL_TEXTURE_2D, renderer->ssaoPosTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glBindTexture(GL_TEXTURE_2D, renderer->ssaoNormalTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glBindRenderbuffer(GL_RENDERBUFFER, renderer->litRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->litColorTex, 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, renderer->bloomSSAOTex, 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, renderer->ssaoPosTex, 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, renderer->ssaoNormalTex, 0);
-
-    glDrawBuffers(4, attachments);
-
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderer->litRBO);
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "ERROR::FRAMEBUFFER:: GBuffer framebuffer is not complete!" << std::endl;
-    }
-
-    for (unsigned int i = 0; i < 2; i++) {
-        glBindFramebuffer(GL_FRAMEBUFFER, renderer->blurFBO[i]);
-        glBindTexture(GL_TEXTURE_2D, renderer->blurSwapTex[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->blurSwapTex[i], 0);
-
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-            std::cerr << "ERROR::FRAMEBUFFER:: Blur framebuffer is not complete!" << std::endl;
-        }
-    }
 
     glBindFramebuffer(GL_FRAMEBUFFER, renderer->pickingFBO);
     glBindTexture(GL_TEXTURE_2D, renderer->pickingTex);
@@ -678,15 +364,6 @@ static void resizeBuffers(RenderState* renderer) {
         std::cerr << "ERROR::FRAMEBUFFER:: Depth framebuffer is not complete!" << std::endl;
     }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, renderer->ssaoFBO);
-    glBindTexture(GL_TEXTURE_2D, renderer->blurTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16, renderer->windowData.viewportWidth, renderer->windowData.viewportHeight, 0, GL_RGBA, GL_FLOAT, NULL);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->blurTex, 0);
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "ERROR::FRAMEBUFFER:: SSAO Color framebuffer is not complete!" << std::endl;
-    }
-
     glBindFramebuffer(GL_FRAMEBUFFER, renderer->editorFBO);
     glBindTexture(GL_TEXTURE_2D, renderer->editorTex);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
@@ -772,36 +449,46 @@ static void generateSSAOKernel(RenderState* renderer) {
 
     glUseProgram(renderer->ssaoShader);
     for (unsigned int i = 0; i < 8; i++) {
-        glUniform3fv(glGetUniformLocation(renderer->ssaoShader, ("samples[" + std::to_string(i) + "]").c_str()), 1, renderer->ssaoKernel[i].mF32);
+        setUniform(uniformElement(renderer->ssaoUniforms.samples, i), renderer->ssaoKernel[i]);
     }
 }
 
 void deleteBuffers(RenderState* renderer, Resources* resources) {
-    unsigned int textures[5] = {renderer->pickingTex, renderer->litColorTex, renderer->bloomSSAOTex, renderer->blurTex, renderer->ssaoNoiseTex};
-    unsigned int rbo[2] = {renderer->pickingRBO, renderer->litRBO};
-    unsigned int frameBuffers[3] = {renderer->pickingFBO, renderer->ssaoFBO, renderer->litFBO};
+    unsigned int textures[2] = {renderer->pickingTex, renderer->ssaoNoiseTex};
 
-    glDeleteTextures(5, textures);
-    glDeleteRenderbuffers(2, rbo);
-    glDeleteFramebuffers(3, frameBuffers);
+    glDeleteTextures(2, textures);
+    glDeleteRenderbuffers(1, &renderer->pickingRBO);
+    glDeleteFramebuffers(1, &renderer->pickingFBO);
+    destroyRenderGraph(&renderer->graph);
     glDeleteShader(renderer->lightingShader);
     glDeleteShader(renderer->pickingShader);
     glDeleteShader(renderer->postProcessShader);
-    glDeleteShader(renderer->blurShader);
+    glDeleteShader(renderer->bloomDownsampleShader);
+    glDeleteShader(renderer->bloomUpsampleShader);
     glDeleteShader(renderer->depthShader);
+    glDeleteShader(renderer->lightingSkinnedShader);
+    glDeleteShader(renderer->depthSkinnedShader);
     glDeleteShader(renderer->ssaoShader);
 
+    destroyInstanceBuffer(&renderer->instances);
+    destroyMaterialTable(&renderer->materials);
+    destroyLightClusters(&renderer->clusters);
+    destroyShadowAtlas(&renderer->shadowAtlas);
+    destroyRenderQueue(&renderer->queue);
     glDeleteBuffers(1, &renderer->fullscreenVBO);
     glDeleteVertexArrays(1, &renderer->fullscreenVAO);
     for (auto& pair : resources->textureMap) {
         glDeleteTextures(1, &pair.second->id);
     }
 
-    for (auto pair : resources->meshMap) {
-        Mesh* mesh = pair.second;
-        glDeleteBuffers(1, &mesh->EBO);
-        glDeleteBuffers(1, &mesh->VBO);
-        glDeleteVertexArrays(1, &mesh->VAO);
+    destroyMeshBuffer(&renderer->meshes);
+
+    if (renderer->picker.pbo != 0) {
+        destroyPicker(&renderer->picker);
+    }
+
+    if (renderer->debugRenderer != nullptr) {
+        destroyDebugBuffer(&static_cast<MyDebugRenderer*>(renderer->debugRenderer)->buffer);
     }
 }
 
@@ -866,12 +553,83 @@ void updateBufferData(RenderState* renderer, Scene* scene) {
     glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(GlobalUBO), &renderer->matricesUBOData);
 }
 
-void renderScene(RenderState* renderer, EntityGroup* entities) {
-    drawShadowMaps(renderer, entities);
-    drawScene(renderer, entities);
-    drawSSAO(renderer);
-    drawBlurPass(renderer);
-    drawFullScreenQuad(renderer);
+void renderScene(RenderState* renderer) {
+    syncMaterialTable(renderer);
+    executeRenderGraph(&renderer->graph, renderer);
+    endInstanceFrame(&renderer->instances);
+}
+
+// every pass of a frame and the targets between them. shadows and post write outside the graph, the rest only runs
+// while something after it reads what it writes
+static void setupRenderGraph(RenderState* renderer) {
+    RenderGraph* graph = &renderer->graph;
+    RenderGraphTextureDesc color;
+    RenderGraphTextureDesc filtered;
+    filtered.filter = GL_LINEAR;
+    RenderGraphTextureDesc depth;
+    depth.format = GL_DEPTH_COMPONENT24;
+    RenderGraphTextureDesc occlusion;
+    occlusion.format = GL_R8;
+    // starts at half resolution and goes down as far as the viewport allows
+    RenderGraphTextureDesc bloomChain;
+    bloomChain.format = GL_R11F_G11F_B10F;
+    bloomChain.scale = 0.5f;
+    bloomChain.levels = 0;
+    bloomChain.filter = GL_LINEAR;
+
+    const RenderGraphResource litColor = createRenderGraphTarget(graph, "Lit Color", color);
+    const RenderGraphResource brightColor = createRenderGraphTarget(graph, "Bright Color", filtered);
+    const RenderGraphResource viewPosition = createRenderGraphTarget(graph, "View Position", color);
+    const RenderGraphResource viewNormal = createRenderGraphTarget(graph, "View Normal", color);
+    const RenderGraphResource sceneDepth = createRenderGraphTarget(graph, "Scene Depth", depth);
+    const RenderGraphResource ssao = createRenderGraphTarget(graph, "SSAO", occlusion);
+    const RenderGraphResource ao = createRenderGraphTarget(graph, "AO", occlusion);
+    const RenderGraphResource bloom = createRenderGraphTarget(graph, "Bloom", bloomChain);
+
+    RenderGraphPass shadows;
+    shadows.name = "Shadow Maps";
+    shadows.execute = drawShadowMaps;
+    shadows.sideEffect = true;
+    addRenderGraphPass(graph, shadows);
+
+    RenderGraphPass lit;
+    lit.name = "Lit";
+    lit.execute = drawScene;
+    lit.writes = {litColor, brightColor, viewPosition, viewNormal};
+    lit.depth = sceneDepth;
+    addRenderGraphPass(graph, lit);
+
+    RenderGraphPass ssaoPass;
+    ssaoPass.name = "SSAO";
+    ssaoPass.execute = drawSSAO;
+    ssaoPass.reads = {viewPosition, viewNormal};
+    ssaoPass.writes = {ssao};
+    ssaoPass.fullscreen = true;
+    addRenderGraphPass(graph, ssaoPass);
+
+    RenderGraphPass aoBlur;
+    aoBlur.name = "AO Blur";
+    aoBlur.execute = drawAOBlur;
+    aoBlur.reads = {ssao};
+    aoBlur.writes = {ao};
+    aoBlur.fullscreen = true;
+    addRenderGraphPass(graph, aoBlur);
+
+    RenderGraphPass bloomPass;
+    bloomPass.name = "Bloom";
+    bloomPass.execute = drawBloom;
+    bloomPass.reads = {brightColor, bloom};
+    bloomPass.writes = {bloom};
+    bloomPass.fullscreen = true;
+    addRenderGraphPass(graph, bloomPass);
+
+    RenderGraphPass post;
+    post.name = "Post Process";
+    post.execute = drawFullScreenQuad;
+    post.reads = {litColor, bloom, ao};
+    post.fullscreen = true;
+    post.sideEffect = true;
+    addRenderGraphPass(graph, post);
 }
 
 void createCameraUBO(RenderState* renderer) {
@@ -884,12 +642,16 @@ void createCameraUBO(RenderState* renderer) {
 
 void initRenderer(RenderState* renderer, Scene* scene) {
     setInitialFlags();
-    createSSAOBuffer(renderer);
-    createForwardBuffer(renderer);
-    createBlurBuffers(renderer);
+    setupRenderGraph(renderer);
+    compileRenderGraph(&renderer->graph, renderer->windowData.viewportWidth, renderer->windowData.viewportHeight);
     createFullScreenQuad(renderer);
     generateSSAOKernel(renderer);
     createCameraUBO(renderer);
+    createInstanceBuffer(&renderer->instances, cDefaultInstanceCapacity);
+    createMaterialTable(&renderer->materials, cDefaultMaterialCapacity);
+    createLightClusters(&renderer->clusters);
+    createShadowAtlas(&renderer->shadowAtlas);
+    createRenderQueue(&renderer->queue);
     initializeEnvironment(renderer, scene, renderer->lightingShader);
 }
 
@@ -897,7 +659,10 @@ void initRendererEditor(RenderState* renderer) {
     createPickingFBO(renderer);
     createEditorBuffer(renderer);
     renderer->finalBuffer = renderer->editorFBO;
-    renderer->debugRenderer = new MyDebugRenderer();
+    createPicker(&renderer->picker);
+    MyDebugRenderer* debug = new MyDebugRenderer();
+    createDebugBuffer(&debug->buffer, cDefaultDebugVertexCapacity);
+    renderer->debugRenderer = debug;
     JPH::DebugRenderer::sInstance = renderer->debugRenderer;
 }
 
@@ -913,6 +678,7 @@ void onScreenChanged(GLFWwindow* window, int width, int height) {
     test[1] = renderer->windowData.viewportHeight / 4.0f;
     glUniform2fv(8, 1, test);
 
+    compileRenderGraph(&renderer->graph, renderer->windowData.viewportWidth, renderer->windowData.viewportHeight);
     resizeBuffers(renderer);
 }
 
@@ -4,30 +4,28 @@
 #include "utils/mathutils.h"
 #include "physics.h"
 #include "meshrenderer.h"
+#include "renderworld.h"
+#include "renderqueue.h"
+#include "instancebuffer.h"
+#include "meshbuffer.h"
+#include "debugbuffer.h"
+#include "picking.h"
+#include "materialtable.h"
+#include "lightclusters.h"
+#include "shadowatlas.h"
+#include "rendergraph.h"
+#include "shader.h"
 
 struct EntityGroup;
 struct MeshRenderer;
 
-struct DebugVertex {
-    vec3 pos;
-    vec4 color;
-};
-
-struct DebugLine {
-    vec3 start;
-    vec3 end;
-    JPH::Color color;
-};
-
-struct DebugTri {
-    vec3 v0, v1, v2;
-    JPH::Color color;
-};
-
+// load format, kept on the cpu for colliders. the mesh buffer packs it into PackedVertex and SkinVertex
 struct Vertex {
     vec4 position;
     vec3 normal;
     vec3 tangent;
+    // handedness of the bitangent
+    float tangentSign;
     vec2 texCoord;
     GLint boneIDs[4];
     float weights[4];
@@ -54,6 +52,9 @@ struct Material {
     float metalness = 1.0f;
     float aoStrength = 1.0f;
     float normalStrength = 1.0f;
+    uint32_t sortID = nextMaterialSortID();
+    // set whenever anything above changes so the material table rewrites this material's slot
+    bool dirty = true;
 };
 
 struct SubMesh {
@@ -69,9 +70,12 @@ struct BoneInfo {
 
 struct Mesh {
     std::string name;
-    GLuint VAO;
-    GLuint VBO;
-    GLuint EBO;
+    // where the mesh lives in the shared MeshBuffer, submesh index offsets are relative to firstIndex
+    GLint baseVertex = 0;
+    uint32_t firstIndex = 0;
+    uint32_t sortID = nextMeshSortID();
+    // has bone weights, lives in the skinned pool and draws with the skinned shader variants
+    bool skinned = false;
     mat4 globalInverseTransform;
     vec3 center;
     vec3 extent;
@@ -109,9 +113,9 @@ struct PointLight {
 
 struct SpotLight {
     uint32_t entityID;
-    GLuint depthFrameBuffer, blurDepthFrameBuffer, depthTex, blurDepthTex;
-    GLsizei shadowWidth = 800;
-    GLsizei shadowHeight = 600;
+    // upper bound on the light's shadow atlas tile, rounded up to the next tile size
+    GLsizei shadowWidth = 1024;
+    GLsizei shadowHeight = 1024;
     mat4 lightSpaceMatrix = mat4::sIdentity();
     vec3 color;
     float brightness;
@@ -140,23 +144,38 @@ struct GlobalUBO {
 struct RenderState {
     GLFWwindow* window;
     WindowData windowData;
-    GLuint litFBO, litRBO, ssaoFBO;
-    GLuint litColorTex, bloomSSAOTex, blurTex, ssaoNoiseTex, ssaoPosTex, ssaoNormalTex;
-    GLuint blurFBO[2], blurSwapTex[2];
+    GLuint ssaoNoiseTex;
     GLuint fullscreenVAO, fullscreenVBO;
-    GLuint lightingShader, postProcessShader, blurShader, simpleBlurShader, depthShader, ssaoShader, shadowBlurShader, debugShader;
+    GLuint lightingShader, postProcessShader, bloomDownsampleShader, bloomUpsampleShader, simpleBlurShader, depthShader, ssaoShader, shadowBlurShader, debugShader;
+    GLuint lightingSkinnedShader, depthSkinnedShader;
     GLuint finalBuffer = 0;
+    LightingShaderUniforms lightingUniforms;
+    LightingShaderUniforms lightingSkinnedUniforms;
+    DepthShaderUniforms depthUniforms;
+    SSAOShaderUniforms ssaoUniforms;
 
     GLuint pickingFBO;
     GLuint pickingRBO;
     GLuint pickingShader;
     GLuint pickingTex;
+    GpuPicker picker;
     GLuint editorFBO, editorRBO, editorTex;
 
     GLuint matricesUBO;
     GlobalUBO matricesUBOData;
 
-    JPH::DebugRendererSimple* debugRenderer;
+    RenderWorld world;
+    RenderQueue queue;
+    GLStateCache glState;
+    RenderStats stats;
+    InstanceBuffer instances;
+    MeshBuffer meshes;
+    MaterialTable materials;
+    LightClusters clusters;
+    ShadowAtlas shadowAtlas;
+    RenderGraph graph;
+
+    JPH::DebugRendererSimple* debugRenderer = nullptr;
 
     float exposure = 1.0f;
     float bloomThreshold = 0.39f;
@@ -176,25 +195,22 @@ struct RenderState {
     std::vector<vec3> ssaoNoise;
 };
 
-void deleteSpotLightShadowMap(SpotLight* light);
 void createContext(RenderState* renderer);
 void initRenderer(RenderState* renderer, Scene* scene);
 void mapBones(Scene* scene, MeshRenderer* renderer);
 void deleteBuffers(RenderState* scene, Resources* resources);
-void createSpotLightShadowMap(SpotLight* light);
-void renderScene(RenderState* renderer, EntityGroup* entities);
+void renderScene(RenderState* renderer);
 void initRendererEditor(RenderState* renderer);
 void updateBufferData(RenderState* renderer, Scene* scene);
-void drawPickingScene(RenderState* renderer, EntityGroup* scene);
+void drawPickingScene(RenderState* renderer);
 void renderDebug(RenderState* scene);
 
+// jolt's draw calls write straight into the mapped ring, nothing is collected on the side
 class MyDebugRenderer : public JPH::DebugRendererSimple {
    public:
-    std::vector<DebugLine> lines;
-    std::vector<DebugTri> triangles;
+    DebugBuffer buffer;
 
     void DrawLine(JPH::RVec3Arg inFrom, JPH::RVec3Arg inTo, JPH::ColorArg inColor) override;
     void DrawTriangle(JPH::RVec3Arg inV1, const JPH::RVec3Arg inV2, const JPH::RVec3Arg inV3, JPH::ColorArg inColor, ECastShadow inCastShadow) override;
     void DrawText3D(JPH::RVec3Arg inPosition, const std::string_view& inString, JPH::ColorArg inColor, float inHeight) override;
-    void Clear();
 };
@@ -0,0 +1,397 @@
+#include <algorithm>
+#include <iostream>
+
+#include "rendergraph.h"
+
+static size_t getFormatBytes(GLenum format) {
+    switch (format) {
+        case GL_RGBA32F:
+            return 16;
+        case GL_RGBA16F:
+            return 8;
+        case GL_R16F:
+        case GL_RG8:
+            return 2;
+        case GL_R8:
+            return 1;
+        default:
+            return 4;
+    }
+}
+
+static size_t getTextureBytes(GLenum format, GLsizei width, GLsizei height, GLint levels) {
+    size_t bytes = 0;
+    for (GLint level = 0; level < levels; level++) {
+        bytes += static_cast<size_t>(JPH::max(width >> level, 1)) * JPH::max(height >> level, 1) * getFormatBytes(format);
+    }
+
+    return bytes;
+}
+
+RenderGraphResource createRenderGraphTarget(RenderGraph* graph, const char* name, const RenderGraphTextureDesc& desc) {
+    RenderGraphTarget target;
+    target.name = name;
+    target.desc = desc;
+    graph->resources.push_back(target);
+    return static_cast<RenderGraphResource>(graph->resources.size() - 1);
+}
+
+void addRenderGraphPass(RenderGraph* graph, const RenderGraphPass& pass) {
+    if (pass.writes.size() > cMaxRenderGraphAttachments) {
+        std::cerr << "ERROR::RENDERER::RENDER_GRAPH::Pass " << pass.name << " writes more than " << cMaxRenderGraphAttachments << " targets" << std::endl;
+        return;
+    }
+
+    graph->passes.push_back(pass);
+}
+
+static GLuint getFramebuffer(RenderGraph* graph, const GLuint* colors, uint32_t colorCount, GLuint depth, GLint level) {
+    for (const RenderGraphFramebuffer& framebuffer : graph->framebuffers) {
+        if (framebuffer.colorCount == colorCount && framebuffer.depth == depth && framebuffer.level == level && std::equal(colors, colors + colorCount, framebuffer.colors)) {
+            return framebuffer.fbo;
+        }
+    }
+
+    RenderGraphFramebuffer framebuffer;
+    GLenum drawBuffers[cMaxRenderGraphAttachments];
+    glCreateFramebuffers(1, &framebuffer.fbo);
+
+    for (uint32_t i = 0; i < colorCount; i++) {
+        framebuffer.colors[i] = colors[i];
+        drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+        glNamedFramebufferTexture(framebuffer.fbo, GL_COLOR_ATTACHMENT0 + i, colors[i], level);
+    }
+
+    if (colorCount > 0) {
+        glNamedFramebufferDrawBuffers(framebuffer.fbo, colorCount, drawBuffers);
+    } else {
+        glNamedFramebufferDrawBuffer(framebuffer.fbo, GL_NONE);
+    }
+
+    if (depth != 0) {
+        glNamedFramebufferTexture(framebuffer.fbo, GL_DEPTH_ATTACHMENT, depth, level);
+    }
+
+    if (glCheckNamedFramebufferStatus(framebuffer.fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "ERROR::RENDERER::RENDER_GRAPH::Framebuffer is not complete" << std::endl;
+    }
+
+    framebuffer.colorCount = colorCount;
+    framebuffer.depth = depth;
+    framebuffer.level = level;
+    graph->framebuffers.push_back(framebuffer);
+    return framebuffer.fbo;
+}
+
+static void releaseFramebuffers(RenderGraph* graph) {
+    for (RenderGraphFramebuffer& framebuffer : graph->framebuffers) {
+        glDeleteFramebuffers(1, &framebuffer.fbo);
+    }
+
+    graph->framebuffers.clear();
+}
+
+// walks back from the side effect passes. a pass lives if a later live pass reads what it writes, a fullscreen write
+// hides everything written before it so earlier writers of that resource are only kept by earlier readers
+static void cullPasses(RenderGraph* graph) {
+    std::vector<bool> needed(graph->resources.size(), false);
+
+    for (uint32_t i = static_cast<uint32_t>(graph->passes.size()); i-- > 0;) {
+        RenderGraphPass* pass = &graph->passes[i];
+        bool live = pass->sideEffect;
+        for (RenderGraphResource resource : pass->writes) {
+            live = live || needed[resource];
+        }
+        if (pass->depth != cInvalidRenderGraphResource) {
+            live = live || needed[pass->depth];
+        }
+
+        pass->culled = !live;
+        if (!live) {
+            continue;
+        }
+
+        for (RenderGraphResource resource : pass->writes) {
+            needed[resource] = !pass->fullscreen;
+        }
+        if (pass->depth != cInvalidRenderGraphResource) {
+            needed[pass->depth] = true;
+        }
+        for (RenderGraphResource resource : pass->reads) {
+            needed[resource] = true;
+        }
+    }
+}
+
+static GLint getMipLevels(GLsizei width, GLsizei height) {
+    GLint levels = 1;
+    for (GLsizei size = JPH::min(width, height); size / 2 >= cRenderGraphMinMipSize; size /= 2) {
+        levels++;
+    }
+
+    return levels;
+}
+
+static void touchResource(RenderGraph* graph, RenderGraphResource resource, uint32_t pass) {
+    RenderGraphTarget* target = &graph->resources[resource];
+    if (target->firstPass == cInvalidRenderGraphResource) {
+        target->firstPass = pass;
+    }
+    target->lastPass = pass;
+}
+
+static void computeLifetimes(RenderGraph* graph) {
+    for (RenderGraphTarget& target : graph->resources) {
+        target.width = JPH::max(static_cast<GLsizei>(graph->width * target.desc.scale), 1);
+        target.height = JPH::max(static_cast<GLsizei>(graph->height * target.desc.scale), 1);
+        target.levels = target.desc.levels > 0 ? target.desc.levels : getMipLevels(target.width, target.height);
+        target.texture = cInvalidRenderGraphResource;
+        target.firstPass = cInvalidRenderGraphResource;
+        target.lastPass = 0;
+    }
+
+    for (uint32_t i = 0; i < graph->passes.size(); i++) {
+        const RenderGraphPass* pass = &graph->passes[i];
+        if (pass->culled) {
+            continue;
+        }
+
+        for (RenderGraphResource resource : pass->reads) {
+            touchResource(graph, resource, i);
+        }
+        for (RenderGraphResource resource : pass->writes) {
+            touchResource(graph, resource, i);
+        }
+        if (pass->depth != cInvalidRenderGraphResource) {
+            touchResource(graph, pass->depth, i);
+        }
+    }
+}
+
+static uint32_t createPoolTexture(RenderGraph* graph, const RenderGraphTarget* target) {
+    RenderGraphTexture texture;
+    texture.format = target->desc.format;
+    texture.width = target->width;
+    texture.height = target->height;
+    texture.levels = target->levels;
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture.id);
+    glTextureStorage2D(texture.id, texture.levels, texture.format, texture.width, texture.height);
+    glTextureParameteri(texture.id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture.id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    graph->textures.push_back(texture);
+    return static_cast<uint32_t>(graph->textures.size() - 1);
+}
+
+// resources are placed in order of their first pass, each takes the first pooled texture of its format and size that
+// is free by then. textures left without a resource (old sizes, removed passes) are deleted
+static void assignTextures(RenderGraph* graph) {
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < graph->resources.size(); i++) {
+        if (graph->resources[i].firstPass != cInvalidRenderGraphResource) {
+            order.push_back(i);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [graph](uint32_t a, uint32_t b) {
+        return graph->resources[a].firstPass < graph->resources[b].firstPass;
+    });
+
+    for (RenderGraphTexture& texture : graph->textures) {
+        texture.freeFrom = 0;
+    }
+    std::vector<bool> used(graph->textures.size(), false);
+
+    for (uint32_t index : order) {
+        RenderGraphTarget* target = &graph->resources[index];
+        for (uint32_t i = 0; i < graph->textures.size(); i++) {
+            const RenderGraphTexture* texture = &graph->textures[i];
+            if (texture->freeFrom <= target->firstPass && texture->format == target->desc.format && texture->width == target->width && texture->height == target->height && texture->levels == target->levels) {
+                target->texture = i;
+                break;
+            }
+        }
+
+        if (target->texture == cInvalidRenderGraphResource) {
+            target->texture = createPoolTexture(graph, target);
+            used.push_back(false);
+        }
+
+        graph->textures[target->texture].freeFrom = target->lastPass + 1;
+        used[target->texture] = true;
+    }
+
+    std::vector<uint32_t> remap(graph->textures.size(), cInvalidRenderGraphResource);
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < graph->textures.size(); i++) {
+        if (!used[i]) {
+            glDeleteTextures(1, &graph->textures[i].id);
+            continue;
+        }
+
+        remap[i] = kept;
+        graph->textures[kept++] = graph->textures[i];
+    }
+    graph->textures.resize(kept);
+
+    for (RenderGraphTarget& target : graph->resources) {
+        if (target.texture != cInvalidRenderGraphResource) {
+            target.texture = remap[target.texture];
+        }
+    }
+}
+
+// the first pass of a resource clears it unless it covers every pixel, later passes keep what is there
+static RenderGraphLoad getLoad(const RenderGraph* graph, const RenderGraphPass* pass, uint32_t passIndex, RenderGraphResource resource) {
+    if (graph->resources[resource].firstPass != passIndex) {
+        return LOAD_KEEP;
+    }
+
+    return pass->fullscreen ? LOAD_DONT_CARE : LOAD_CLEAR;
+}
+
+static void setupPasses(RenderGraph* graph) {
+    for (uint32_t i = 0; i < graph->passes.size(); i++) {
+        RenderGraphPass* pass = &graph->passes[i];
+        pass->fbo = 0;
+        if (pass->culled || (pass->writes.empty() && pass->depth == cInvalidRenderGraphResource)) {
+            continue;
+        }
+
+        GLuint colors[cMaxRenderGraphAttachments];
+        GLuint depth = 0;
+        for (uint32_t j = 0; j < pass->writes.size(); j++) {
+            colors[j] = getRenderGraphTexture(graph, pass->writes[j]);
+            pass->colorLoads[j] = getLoad(graph, pass, i, pass->writes[j]);
+        }
+        if (pass->depth != cInvalidRenderGraphResource) {
+            depth = getRenderGraphTexture(graph, pass->depth);
+            pass->depthLoad = getLoad(graph, pass, i, pass->depth);
+        }
+
+        pass->fbo = getFramebuffer(graph, colors, static_cast<uint32_t>(pass->writes.size()), depth, 0);
+    }
+}
+
+static void updateRenderGraphStats(RenderGraph* graph) {
+    RenderGraphStats* stats = &graph->stats;
+    *stats = RenderGraphStats();
+    stats->passes = static_cast<uint32_t>(graph->passes.size());
+    stats->textures = static_cast<uint32_t>(graph->textures.size());
+
+    for (const RenderGraphPass& pass : graph->passes) {
+        stats->culled += pass.culled ? 1 : 0;
+    }
+
+    for (const RenderGraphTarget& target : graph->resources) {
+        if (target.texture == cInvalidRenderGraphResource) {
+            continue;
+        }
+
+        stats->resources++;
+        stats->unaliasedBytes += getTextureBytes(target.desc.format, target.width, target.height, target.levels);
+    }
+
+    for (const RenderGraphTexture& texture : graph->textures) {
+        stats->bytes += getTextureBytes(texture.format, texture.width, texture.height, texture.levels);
+    }
+}
+
+void compileRenderGraph(RenderGraph* graph, GLsizei width, GLsizei height) {
+    graph->width = width;
+    graph->height = height;
+
+    releaseFramebuffers(graph);
+    cullPasses(graph);
+    computeLifetimes(graph);
+    assignTextures(graph);
+    setupPasses(graph);
+    updateRenderGraphStats(graph);
+}
+
+static void setReadFilter(RenderGraph* graph, RenderGraphResource resource) {
+    const RenderGraphTarget* target = &graph->resources[resource];
+    RenderGraphTexture* texture = &graph->textures[target->texture];
+    if (texture->filter == target->desc.filter) {
+        return;
+    }
+
+    glTextureParameteri(texture->id, GL_TEXTURE_MIN_FILTER, target->desc.filter);
+    glTextureParameteri(texture->id, GL_TEXTURE_MAG_FILTER, target->desc.filter);
+    texture->filter = target->desc.filter;
+}
+
+static void applyLoads(const RenderGraphPass* pass) {
+    const float clearColor[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    const float clearDepth = 1.0f;
+    GLenum discard[cMaxRenderGraphAttachments + 1];
+    GLsizei discardCount = 0;
+
+    for (uint32_t i = 0; i < pass->writes.size(); i++) {
+        if (pass->colorLoads[i] == LOAD_CLEAR) {
+            glClearNamedFramebufferfv(pass->fbo, GL_COLOR, i, clearColor);
+        } else if (pass->colorLoads[i] == LOAD_DONT_CARE) {
+            discard[discardCount++] = GL_COLOR_ATTACHMENT0 + i;
+        }
+    }
+
+    if (pass->depth != cInvalidRenderGraphResource) {
+        if (pass->depthLoad == LOAD_CLEAR) {
+            glClearNamedFramebufferfv(pass->fbo, GL_DEPTH, 0, &clearDepth);
+        } else if (pass->depthLoad == LOAD_DONT_CARE) {
+            discard[discardCount++] = GL_DEPTH_ATTACHMENT;
+        }
+    }
+
+    if (discardCount > 0) {
+        glInvalidateNamedFramebufferData(pass->fbo, discardCount, discard);
+    }
+}
+
+void executeRenderGraph(RenderGraph* graph, RenderState* renderer) {
+    for (const RenderGraphPass& pass : graph->passes) {
+        if (pass.culled) {
+            continue;
+        }
+
+        for (RenderGraphResource resource : pass.reads) {
+            setReadFilter(graph, resource);
+        }
+
+        if (pass.fbo != 0) {
+            const RenderGraphTarget* target = &graph->resources[pass.writes.empty() ? pass.depth : pass.writes[0]];
+            glBindFramebuffer(GL_FRAMEBUFFER, pass.fbo);
+            glViewport(0, 0, target->width, target->height);
+            applyLoads(&pass);
+        }
+
+        pass.execute(renderer, &pass);
+    }
+}
+
+void destroyRenderGraph(RenderGraph* graph) {
+    releaseFramebuffers(graph);
+    for (RenderGraphTexture& texture : graph->textures) {
+        glDeleteTextures(1, &texture.id);
+    }
+
+    *graph = RenderGraph();
+}
+
+GLuint getRenderGraphTexture(const RenderGraph* graph, RenderGraphResource resource) {
+    const RenderGraphTarget* target = &graph->resources[resource];
+    if (target->texture == cInvalidRenderGraphResource) {
+        return 0;
+    }
+
+    return graph->textures[target->texture].id;
+}
+
+// for passes that draw into their targets one at a time (ping pong, mip chains) instead of all at once
+void bindRenderGraphTarget(RenderGraph* graph, RenderGraphResource resource, GLint level) {
+    const RenderGraphTarget* target = &graph->resources[resource];
+    const GLuint texture = getRenderGraphTexture(graph, resource);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, getFramebuffer(graph, &texture, 1, 0, level));
+    glViewport(0, 0, JPH::max(target->width >> level, 1), JPH::max(target->height >> level, 1));
+}
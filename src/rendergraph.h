@@ -0,0 +1,111 @@
+#pragma once
+#include <vector>
+#include "forward.h"
+#include "utils/mathutils.h"
+
+struct RenderGraphPass;
+
+constexpr uint32_t cMaxRenderGraphAttachments = 4;
+constexpr uint32_t cInvalidRenderGraphResource = ~0u;
+// a target with 0 levels gets a mip chain that stops once the short side would drop below this
+constexpr GLsizei cRenderGraphMinMipSize = 8;
+
+using RenderGraphResource = uint32_t;
+using RenderGraphExecute = void (*)(RenderState* renderer, const RenderGraphPass* pass);
+
+// what a pass does with an attachment before it draws, derived from where the pass sits in the resource's lifetime
+enum RenderGraphLoad : uint8_t {
+    LOAD_KEEP = 0,
+    LOAD_CLEAR = 1,
+    LOAD_DONT_CARE = 2
+};
+
+// size is a fraction of the viewport. more than one level gives a mip chain that passes draw into level by level,
+// 0 sizes the chain to the viewport
+struct RenderGraphTextureDesc {
+    GLenum format = GL_RGBA16F;
+    float scale = 1.0f;
+    GLint levels = 1;
+    GLenum filter = GL_NEAREST;
+};
+
+// a transient target, only valid between its first and last pass. resources whose lifetimes don't overlap share a
+// physical texture
+struct RenderGraphTarget {
+    const char* name = nullptr;
+    RenderGraphTextureDesc desc;
+    GLsizei width = 0;
+    GLsizei height = 0;
+    GLint levels = 1;
+    uint32_t texture = cInvalidRenderGraphResource;
+    uint32_t firstPass = 0;
+    uint32_t lastPass = 0;
+};
+
+// writes are the color attachments in draw buffer order. fullscreen passes cover every pixel they write so nothing
+// is cleared for them, side effect passes write outside the graph (shadow atlas, final target) and are never culled
+struct RenderGraphPass {
+    const char* name = nullptr;
+    RenderGraphExecute execute = nullptr;
+    std::vector<RenderGraphResource> reads;
+    std::vector<RenderGraphResource> writes;
+    RenderGraphResource depth = cInvalidRenderGraphResource;
+    bool fullscreen = false;
+    bool sideEffect = false;
+
+    // filled by compileRenderGraph
+    bool culled = false;
+    GLuint fbo = 0;
+    RenderGraphLoad colorLoads[cMaxRenderGraphAttachments] = {};
+    RenderGraphLoad depthLoad = LOAD_KEEP;
+};
+
+struct RenderGraphTexture {
+    GLuint id = 0;
+    GLenum format = 0;
+    GLsizei width = 0;
+    GLsizei height = 0;
+    GLint levels = 1;
+    // sampling state follows whichever resource reads the texture, only set when it changes
+    GLenum filter = 0;
+    // first pass the texture is free again, only used while compiling
+    uint32_t freeFrom = 0;
+};
+
+struct RenderGraphFramebuffer {
+    GLuint fbo = 0;
+    GLuint colors[cMaxRenderGraphAttachments] = {};
+    uint32_t colorCount = 0;
+    GLuint depth = 0;
+    GLint level = 0;
+};
+
+// bytes are for the compiled textures, unaliased is what the same resources would take with a texture each
+struct RenderGraphStats {
+    uint32_t passes = 0;
+    uint32_t culled = 0;
+    uint32_t resources = 0;
+    uint32_t textures = 0;
+    size_t bytes = 0;
+    size_t unaliasedBytes = 0;
+};
+
+// passes run in the order they are added. compiling culls passes nothing consumes, assigns textures from the pool and
+// works out the loads, it only has to run again when the passes or the viewport change
+struct RenderGraph {
+    GLsizei width = 0;
+    GLsizei height = 0;
+    std::vector<RenderGraphTarget> resources;
+    std::vector<RenderGraphPass> passes;
+    std::vector<RenderGraphTexture> textures;
+    std::vector<RenderGraphFramebuffer> framebuffers;
+    RenderGraphStats stats;
+};
+
+RenderGraphResource createRenderGraphTarget(RenderGraph* graph, const char* name, const RenderGraphTextureDesc& desc);
+void addRenderGraphPass(RenderGraph* graph, const RenderGraphPass& pass);
+void compileRenderGraph(RenderGraph* graph, GLsizei width, GLsizei height);
+void executeRenderGraph(RenderGraph* graph, RenderState* renderer);
+void destroyRenderGraph(RenderGraph* graph);
+GLuint getRenderGraphTexture(const RenderGraph* graph, RenderGraphResource resource);
+void bindRenderGraphTarget(RenderGraph* graph, RenderGraphResource resource, GLint level);
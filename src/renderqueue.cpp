@@ -0,0 +1,270 @@
+#include <chrono>
+#include <utility>
+
+#include "renderqueue.h"
+#include "renderer.h"
+#include "culling.h"
+
+static uint32_t materialSortIDs = 0;
+static uint32_t meshSortIDs = 0;
+
+uint32_t nextMaterialSortID() {
+    return materialSortIDs++;
+}
+
+uint32_t nextMeshSortID() {
+    return meshSortIDs++;
+}
+
+// view 8 | shader 6 | material 14 | mesh 14 | submesh 6 | depth 16, ascending so opaque draws go front to back within
+// a state bucket. everything above depth is what instancing groups on
+uint64_t makeSortKey(uint32_t view, uint32_t shader, uint32_t material, uint32_t mesh, uint32_t subMesh, float depth) {
+    const uint64_t depthBits = static_cast<uint64_t>(JPH::Clamp(depth * cSortDepthScale, 0.0f, 65535.0f));
+    return (static_cast<uint64_t>(view & 0xFF) << 56) |
+           (static_cast<uint64_t>(shader & 0x3F) << 50) |
+           (static_cast<uint64_t>(material & 0x3FFF) << 36) |
+           (static_cast<uint64_t>(mesh & 0x3FFF) << 22) |
+           (static_cast<uint64_t>(subMesh & 0x3F) << 16) |
+           depthBits;
+}
+
+// lsd radix sort on 8 bit digits, digits every key shares (unused fields, single view) are skipped
+void sortRenderQueue(RenderQueue* queue) {
+    if (queue->items.size() < 2) {
+        return;
+    }
+
+    std::vector<RenderQueueItem>* source = &queue->items;
+    std::vector<RenderQueueItem>* destination = &queue->scratch;
+    destination->resize(source->size());
+
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        uint32_t offsets[256] = {};
+        for (const RenderQueueItem& item : *source) {
+            offsets[(item.key >> shift) & 0xFF]++;
+        }
+
+        if (offsets[(source->front().key >> shift) & 0xFF] == source->size()) {
+            continue;
+        }
+
+        uint32_t total = 0;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t count = offsets[i];
+            offsets[i] = total;
+            total += count;
+        }
+
+        for (const RenderQueueItem& item : *source) {
+            (*destination)[offsets[(item.key >> shift) & 0xFF]++] = item;
+        }
+
+        std::swap(source, destination);
+    }
+
+    if (source != &queue->items) {
+        queue->items.swap(queue->scratch);
+    }
+}
+
+static float distanceToBounds(const RenderBounds* bounds, uint32_t object, vec3 position) {
+    vec3 center(bounds->centerX[object], bounds->centerY[object], bounds->centerZ[object]);
+    return (center - position).Length();
+}
+
+// only the lit view binds materials, picking and shadow views put 0 in the key and instance across materials
+static bool viewUsesMaterials(uint32_t view) {
+    return view == cRenderViewLit;
+}
+
+// the low shader bit is the vertex layout, static and skinned draws of a view sort into separate runs
+static void pushView(RenderQueue* queue, const RenderWorld* world, uint32_t view, uint32_t shader, const uint32_t* visible, uint32_t visibleCount, vec3 viewPosition) {
+    const bool useMaterial = viewUsesMaterials(view);
+    for (uint32_t i = 0; i < visibleCount; i++) {
+        const RenderObject* object = &world->objects[visible[i]];
+        const float depth = distanceToBounds(&world->bounds, visible[i], viewPosition);
+
+        for (uint32_t j = object->firstDraw; j < object->firstDraw + object->drawCount; j++) {
+            const RenderDraw* draw = &world->draws[j];
+            const uint32_t material = useMaterial ? draw->material->sortID : 0;
+            queue->items.push_back({makeSortKey(view, (shader << 1) | draw->skinned, material, draw->mesh, j - object->firstDraw, depth), j});
+        }
+    }
+}
+
+static bool canInstance(const RenderWorld* world, uint32_t view, const RenderDraw* a, const RenderDraw* b) {
+    return a->firstIndex == b->firstIndex && a->baseVertex == b->baseVertex && a->indexCount == b->indexCount && (!viewUsesMaterials(view) || a->material == b->material) &&
+           world->objects[a->object].boneCount == 0 && world->objects[b->object].boneCount == 0;
+}
+
+// walks the sorted items once, writing one instance per item into this frame's region of the instance buffer
+static void buildBatches(RenderState* renderer) {
+    RenderQueue* queue = &renderer->queue;
+    RenderWorld* world = &renderer->world;
+    const uint32_t baseInstance = beginInstanceFrame(&renderer->instances, static_cast<uint32_t>(queue->items.size()));
+    InstanceData* instances = renderer->instances.mapped + baseInstance;
+    const uint32_t numViews = cRenderViewShadow + cRenderViewsPerShadowPass * static_cast<uint32_t>(world->shadowPasses.size());
+
+    queue->batches.clear();
+    queue->views.assign(numViews, RenderQueueRange());
+
+    for (uint32_t i = 0; i < queue->items.size(); i++) {
+        const RenderQueueItem* item = &queue->items[i];
+        const RenderDraw* draw = &world->draws[item->draw];
+        const uint32_t view = static_cast<uint32_t>(item->key >> 56);
+
+        instances[i].model = world->worldMatrices[draw->object];
+        instances[i].entityID = world->objects[draw->object].entityID;
+        instances[i].materialIndex = draw->material->sortID;
+
+        if (i > 0) {
+            const RenderQueueItem* previous = &queue->items[i - 1];
+            RenderBatch* batch = &queue->batches.back();
+            if ((previous->key >> 16) == (item->key >> 16) && canInstance(world, view, &world->draws[batch->draw], draw)) {
+                batch->instanceCount++;
+                continue;
+            }
+        }
+
+        RenderQueueRange* range = &queue->views[view];
+        if (range->count == 0) {
+            range->first = static_cast<uint32_t>(queue->batches.size());
+        }
+
+        range->count++;
+        queue->batches.push_back({item->draw, baseInstance + i, 1});
+    }
+}
+
+// orphans last frame's commands, same as the cluster buffers
+static void uploadCommands(RenderQueue* queue, const RenderWorld* world) {
+    queue->commands.resize(queue->batches.size());
+    for (uint32_t i = 0; i < queue->batches.size(); i++) {
+        const RenderBatch* batch = &queue->batches[i];
+        const RenderDraw* draw = &world->draws[batch->draw];
+        queue->commands[i] = {draw->indexCount, batch->instanceCount, draw->firstIndex, draw->baseVertex, batch->firstInstance};
+    }
+
+    const size_t size = queue->commands.size() * sizeof(DrawElementsCommand);
+    glNamedBufferData(queue->commandBuffer, JPH::max(size, sizeof(DrawElementsCommand)), nullptr, GL_STREAM_DRAW);
+    if (size > 0) {
+        glNamedBufferSubData(queue->commandBuffer, 0, size, queue->commands.data());
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, queue->commandBuffer);
+}
+
+void createRenderQueue(RenderQueue* queue) {
+    glCreateBuffers(1, &queue->commandBuffer);
+}
+
+void destroyRenderQueue(RenderQueue* queue) {
+    glDeleteBuffers(1, &queue->commandBuffer);
+    queue->commandBuffer = 0;
+}
+
+// runs after culling, one queue holds every view for the frame and is sorted once
+void buildRenderQueue(RenderState* renderer, bool picking) {
+    RenderQueue* queue = &renderer->queue;
+    RenderWorld* world = &renderer->world;
+    RenderStats* stats = &renderer->stats;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    *stats = RenderStats();
+    queue->items.clear();
+
+    pushView(queue, world, cRenderViewLit, renderer->lightingShader, world->cameraVisible.data(), world->cameraVisible.size(), world->cameraPosition);
+
+    // only on frames with a pick request, and only what the cursor ray touches
+    if (picking) {
+        vec3 direction;
+        getPickRay(&renderer->picker, renderer->matricesUBOData.projection * renderer->matricesUBOData.view, world->cameraPosition, renderer->windowData.viewportWidth, renderer->windowData.viewportHeight, &direction);
+        cullPickRay(world, world->cameraPosition, direction);
+        pushView(queue, world, cRenderViewPicking, 0, world->pickVisible.data(), world->pickVisible.size(), world->cameraPosition);
+    }
+
+    // only tiles the shadow atlas scheduled this frame, static casters are skipped unless their cached layer is stale
+    for (uint32_t i = 0; i < world->shadowPasses.size(); i++) {
+        const RenderShadowPass* pass = &world->shadowPasses[i];
+        const RenderSpotLight* light = &world->spotLights[pass->light];
+        const uint32_t* casters = world->shadowVisible.data() + light->firstVisible;
+        const uint32_t view = cRenderViewShadow + cRenderViewsPerShadowPass * i;
+
+        if (pass->redrawStatic) {
+            pushView(queue, world, view, 0, casters, pass->staticCount, light->position);
+        }
+        pushView(queue, world, view + 1, 0, casters + pass->staticCount, light->visibleCount - pass->staticCount, light->position);
+    }
+
+    sortRenderQueue(queue);
+    buildBatches(renderer);
+    uploadCommands(queue, world);
+
+    stats->queueItems = static_cast<uint32_t>(queue->items.size());
+    stats->sortMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+RenderQueueRange getRenderQueueRange(const RenderQueue* queue, uint32_t view) {
+    if (view >= queue->views.size()) {
+        return RenderQueueRange();
+    }
+
+    return queue->views[view];
+}
+
+// passes in between (post process, imgui) bind behind the cache's back, so every queued pass starts from unknown
+void resetGLStateCache(GLStateCache* cache) {
+    cache->program = ~0u;
+    cache->vao = ~0u;
+    for (uint32_t i = 0; i < cMaxTextureUnits; i++) {
+        cache->textures[i] = ~0u;
+    }
+}
+
+void bindProgram(RenderState* renderer, GLuint program) {
+    if (renderer->glState.program == program) {
+        return;
+    }
+
+    glUseProgram(program);
+    renderer->glState.program = program;
+    renderer->stats.programBinds++;
+}
+
+void bindVertexArray(RenderState* renderer, GLuint vao) {
+    if (renderer->glState.vao == vao) {
+        return;
+    }
+
+    glBindVertexArray(vao);
+    renderer->glState.vao = vao;
+    renderer->stats.vaoBinds++;
+}
+
+void bindTexture(RenderState* renderer, GLuint unit, GLuint texture) {
+    GLStateCache* cache = &renderer->glState;
+    if (unit < cMaxTextureUnits && cache->textures[unit] == texture) {
+        return;
+    }
+
+    // takes the target from the texture, so 2d arrays go through the same cache
+    glBindTextureUnit(unit, texture);
+    if (unit < cMaxTextureUnits) {
+        cache->textures[unit] = texture;
+    }
+    renderer->stats.textureBinds++;
+}
+
+void writeRenderStats(const RenderStats* stats, std::ostream& stream) {
+    stream << "{";
+    stream << "\"queueItems\": " << stats->queueItems << ", ";
+    stream << "\"draws\": " << stats->draws << ", ";
+    stream << "\"instances\": " << stats->instances << ", ";
+    stream << "\"submits\": " << stats->submits << ", ";
+    stream << "\"programBinds\": " << stats->programBinds << ", ";
+    stream << "\"textureBinds\": " << stats->textureBinds << ", ";
+    stream << "\"vaoBinds\": " << stats->vaoBinds << ", ";
+    stream << "\"materialUploads\": " << stats->materialUploads << ", ";
+    stream << "\"boneUploads\": " << stats->boneUploads << ", ";
+    stream << "\"sortMs\": " << stats->sortMs;
+    stream << "}";
+}
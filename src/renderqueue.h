@@ -0,0 +1,91 @@
+#pragma once
+#include <vector>
+#include <ostream>
+#include "utils/mathutils.h"
+
+struct RenderState;
+
+// views are the top byte of the sort key so every pass reads one contiguous range after the sort
+constexpr uint32_t cRenderViewLit = 0;
+constexpr uint32_t cRenderViewPicking = 1;
+// each shadow pass takes two views, its static casters then its dynamic ones
+constexpr uint32_t cRenderViewShadow = 2;
+constexpr uint32_t cRenderViewsPerShadowPass = 2;
+constexpr uint32_t cMaxShadowPasses = (256 - cRenderViewShadow) / cRenderViewsPerShadowPass;
+constexpr uint32_t cMaxTextureUnits = 32;
+// depth is stored in 1/64 units, anything past 1024 shares the last bucket
+constexpr float cSortDepthScale = 64.0f;
+
+struct RenderQueueItem {
+    uint64_t key;
+    uint32_t draw;
+};
+
+// consecutive items that share view, material, mesh and submesh, drawn with one instanced call. skinned objects
+// carry their own bone palette and always get a batch of one
+struct RenderBatch {
+    uint32_t draw;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+};
+
+// laid out the way glMultiDrawElementsIndirect reads it, one per batch
+struct DrawElementsCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    GLint baseVertex;
+    uint32_t baseInstance;
+};
+
+// a range of batches
+struct RenderQueueRange {
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+struct RenderQueue {
+    std::vector<RenderQueueItem> items;
+    std::vector<RenderQueueItem> scratch;
+    std::vector<RenderBatch> batches;
+    std::vector<RenderQueueRange> views;
+    // commands[i] draws batches[i], uploaded once per frame and shared by every pass
+    std::vector<DrawElementsCommand> commands;
+    GLuint commandBuffer = 0;
+};
+
+// last bound gl state so submission only emits what changed, ~0 means unknown
+struct GLStateCache {
+    GLuint program = ~0u;
+    GLuint vao = ~0u;
+    GLuint textures[cMaxTextureUnits];
+};
+
+// geometry pass counters for the last frame, reset when the queue is built
+struct RenderStats {
+    uint32_t queueItems = 0;
+    uint32_t draws = 0;
+    uint32_t instances = 0;
+    uint32_t submits = 0;
+    uint32_t programBinds = 0;
+    uint32_t textureBinds = 0;
+    uint32_t vaoBinds = 0;
+    uint32_t materialUploads = 0;
+    uint32_t boneUploads = 0;
+    double sortMs = 0.0;
+};
+
+uint32_t nextMaterialSortID();
+uint32_t nextMeshSortID();
+uint64_t makeSortKey(uint32_t view, uint32_t shader, uint32_t material, uint32_t mesh, uint32_t subMesh, float depth);
+void createRenderQueue(RenderQueue* queue);
+void destroyRenderQueue(RenderQueue* queue);
+void sortRenderQueue(RenderQueue* queue);
+void buildRenderQueue(RenderState* renderer, bool picking);
+RenderQueueRange getRenderQueueRange(const RenderQueue* queue, uint32_t view);
+
+void resetGLStateCache(GLStateCache* cache);
+void bindProgram(RenderState* renderer, GLuint program);
+void bindVertexArray(RenderState* renderer, GLuint vao);
+void bindTexture(RenderState* renderer, GLuint unit, GLuint texture);
+void writeRenderStats(const RenderStats* stats, std::ostream& stream);
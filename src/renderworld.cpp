@@ -0,0 +1,174 @@
+#include <cfloat>
+#include <chrono>
+
+#include "renderworld.h"
+#include "renderer.h"
+#include "transform.h"
+#include "ecs.h"
+
+static void extractBoneMatrices(RenderWorld* world, EntityGroup* entities, MeshRenderer* meshRenderer, RenderObject* object) {
+    object->firstBone = static_cast<uint32_t>(world->boneMatrices.size());
+    object->boneCount = static_cast<uint32_t>(meshRenderer->boneMatrices.size());
+    if (object->boneCount == 0) {
+        return;
+    }
+
+    world->boneMatrices.resize(world->boneMatrices.size() + object->boneCount, mat4::sIdentity());
+    mat4* bones = &world->boneMatrices[object->firstBone];
+    mat4 inverseRoot = getTransform(entities, meshRenderer->rootEntity)->worldTransform.Inversed();
+
+    for (const auto& pair : meshRenderer->transformBoneMap) {
+        bones[pair.second.id] = inverseRoot * getTransform(entities, pair.first)->worldTransform * pair.second.offset;
+    }
+}
+
+// a skinned vertex is a weighted blend of its bone transforms, so it stays inside the union of the bind box moved by
+// every bone in the palette
+static void getSkinnedBounds(const RenderWorld* world, const RenderObject* object, vec3* center, vec3* extent) {
+    const mat4* bones = &world->boneMatrices[object->firstBone];
+    vec3 boundsMin = vec3::sReplicate(FLT_MAX);
+    vec3 boundsMax = vec3::sReplicate(-FLT_MAX);
+
+    for (uint32_t i = 0; i < object->boneCount; i++) {
+        const mat4& bone = bones[i];
+        vec3 boneCenter = bone * *center;
+        vec3 boneExtent = bone.GetAxisX().Abs() * extent->GetX() + bone.GetAxisY().Abs() * extent->GetY() + bone.GetAxisZ().Abs() * extent->GetZ();
+        boundsMin = vec3::sMin(boundsMin, boneCenter - boneExtent);
+        boundsMax = vec3::sMax(boundsMax, boneCenter + boneExtent);
+    }
+
+    *center = (boundsMin + boundsMax) * 0.5f;
+    *extent = (boundsMax - boundsMin) * 0.5f;
+}
+
+static void extractMeshRenderers(RenderWorld* world, EntityGroup* entities) {
+    for (int i = 0; i < entities->meshRenderers.size(); i++) {
+        MeshRenderer* meshRenderer = &entities->meshRenderers[i];
+        Mesh* mesh = meshRenderer->mesh;
+        if (mesh == nullptr) {
+            continue;
+        }
+
+        const mat4& model = getTransform(entities, meshRenderer->entityID)->worldTransform;
+        const uint32_t objectIndex = static_cast<uint32_t>(world->objects.size());
+
+        RenderObject object;
+        object.entityID = meshRenderer->entityID;
+        object.mesh = mesh;
+        object.firstDraw = static_cast<uint32_t>(world->draws.size());
+        object.drawCount = static_cast<uint32_t>(mesh->subMeshes.size());
+        extractBoneMatrices(world, entities, meshRenderer, &object);
+
+        RigidBody* rigidbody = getRigidbody(entities, meshRenderer->entityID);
+        object.isStatic = object.boneCount == 0 && (rigidbody == nullptr || rigidbody->motionType == JPH::EMotionType::Static);
+
+        for (int j = 0; j < mesh->subMeshes.size(); j++) {
+            SubMesh* subMesh = &mesh->subMeshes[j];
+            world->draws.push_back({objectIndex, mesh->sortID, mesh->firstIndex + subMesh->indexOffset, static_cast<uint32_t>(subMesh->indexCount), mesh->baseVertex, subMesh->material, mesh->skinned});
+        }
+
+        // local box to a world aabb, extent picks up the absolute rotation and scale
+        vec3 center = mesh->center;
+        vec3 extent = mesh->extent;
+        if (object.boneCount > 0) {
+            getSkinnedBounds(world, &object, &center, &extent);
+        }
+
+        vec3 worldExtent = model.GetAxisX().Abs() * extent.GetX() + model.GetAxisY().Abs() * extent.GetY() + model.GetAxisZ().Abs() * extent.GetZ();
+
+        vec3 worldCenter = model * center;
+
+        world->objects.push_back(object);
+        world->worldMatrices.push_back(model);
+        world->bounds.centerX.push_back(worldCenter.GetX());
+        world->bounds.centerY.push_back(worldCenter.GetY());
+        world->bounds.centerZ.push_back(worldCenter.GetZ());
+        world->bounds.extentX.push_back(worldExtent.GetX());
+        world->bounds.extentY.push_back(worldExtent.GetY());
+        world->bounds.extentZ.push_back(worldExtent.GetZ());
+    }
+}
+
+static void padBounds(RenderBounds* bounds) {
+    const size_t size = (bounds->centerX.size() + 3) & ~size_t(3);
+    bounds->centerX.resize(size, 0.0f);
+    bounds->centerY.resize(size, 0.0f);
+    bounds->centerZ.resize(size, 0.0f);
+    bounds->extentX.resize(size, 0.0f);
+    bounds->extentY.resize(size, 0.0f);
+    bounds->extentZ.resize(size, 0.0f);
+}
+
+static void clearBounds(RenderBounds* bounds) {
+    bounds->centerX.clear();
+    bounds->centerY.clear();
+    bounds->centerZ.clear();
+    bounds->extentX.clear();
+    bounds->extentY.clear();
+    bounds->extentZ.clear();
+}
+
+static void extractLights(RenderWorld* world, EntityGroup* entities) {
+    for (int i = 0; i < entities->pointLights.size(); i++) {
+        PointLight* light = &entities->pointLights[i];
+        world->pointLights.push_back({getPosition(entities, light->entityID), light->color, light->brightness});
+    }
+
+    for (int i = 0; i < entities->spotLights.size(); i++) {
+        SpotLight* light = &entities->spotLights[i];
+        RenderSpotLight spotLight;
+        spotLight.entityID = light->entityID;
+        spotLight.position = getPosition(entities, light->entityID);
+        spotLight.direction = transformForward(entities, light->entityID);
+        spotLight.color = light->color;
+        spotLight.brightness = light->brightness;
+        spotLight.cosCutoff = JPH::Cos(JPH::DegreesToRadians(light->cutoff));
+        spotLight.cosOuterCutoff = JPH::Cos(JPH::DegreesToRadians(light->outerCutoff));
+        spotLight.lightRadiusUV = light->lightRadiusUV;
+        spotLight.blockerSearchUV = light->blockerSearchUV;
+        spotLight.range = light->range;
+        spotLight.shadowResolution = JPH::max(light->shadowWidth, light->shadowHeight);
+        spotLight.shadowImportance = 0.0f;
+        spotLight.atlasX = 0;
+        spotLight.atlasY = 0;
+        spotLight.atlasSize = 0;
+        spotLight.shadowIndex = -1;
+        spotLight.firstVisible = 0;
+        spotLight.visibleCount = 0;
+        spotLight.isActive = light->isActive;
+        spotLight.enableShadows = light->enableShadows;
+
+        mat4 viewMatrix = mat4::sLookAt(spotLight.position, spotLight.position + spotLight.direction, transformUp(entities, light->entityID));
+        mat4 projectionMatrix = mat4::sPerspective(JPH::DegreesToRadians(light->outerCutoff) * 2.0f, 1.0f, 2.1f, light->range);
+        spotLight.lightSpaceMatrix = projectionMatrix * viewMatrix;
+        light->lightSpaceMatrix = spotLight.lightSpaceMatrix;
+
+        world->spotLights.push_back(spotLight);
+    }
+}
+
+// clears instead of reallocating, the arrays settle at the scene's size after the first frame
+void extractRenderWorld(RenderWorld* world, EntityGroup* entities) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    world->objects.clear();
+    world->worldMatrices.clear();
+    clearBounds(&world->bounds);
+    world->draws.clear();
+    world->boneMatrices.clear();
+    world->pointLights.clear();
+    world->spotLights.clear();
+    world->shadowMaps = 0;
+
+    extractMeshRenderers(world, entities);
+    padBounds(&world->bounds);
+    extractLights(world, entities);
+
+    if (entities->cameras.size() > 0) {
+        world->cameraPosition = getLocalPosition(entities, entities->cameras[0].entityID);
+        world->cameraNear = entities->cameras[0].nearPlane;
+        world->cameraFar = entities->cameras[0].farPlane;
+    }
+
+    world->extractMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <vector>
+#include "forward.h"
+#include "utils/mathutils.h"
+
+struct EntityGroup;
+
+// one per mesh renderer, draws and bones index into the flat arrays on RenderWorld
+struct RenderObject {
+    uint32_t entityID;
+    Mesh* mesh;
+    uint32_t firstDraw;
+    uint32_t drawCount;
+    uint32_t firstBone;
+    uint32_t boneCount;
+    // no skinning and no moving rigidbody, shadow atlas tiles cache these separately
+    bool isStatic;
+};
+
+// one per submesh, indices are absolute in the shared mesh buffer
+struct RenderDraw {
+    uint32_t object;
+    uint32_t mesh;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    GLint baseVertex;
+    Material* material;
+    // vertex layout of the mesh, picks the pool's vao and the shader variant
+    bool skinned;
+};
+
+struct RenderPointLight {
+    vec3 position;
+    vec3 color;
+    float brightness;
+};
+
+struct RenderSpotLight {
+    uint32_t entityID;
+    vec3 position;
+    vec3 direction;
+    vec3 color;
+    mat4 lightSpaceMatrix;
+    // matrix the light's atlas tile was last drawn with, set by scheduling and uploaded instead of lightSpaceMatrix
+    mat4 shadowMatrix;
+    float brightness;
+    float cosCutoff;
+    float cosOuterCutoff;
+    float lightRadiusUV;
+    float blockerSearchUV;
+    float range;
+    // largest atlas tile the light asks for
+    GLsizei shadowResolution;
+    // range over the distance to the camera, picks the tile size and whether the update budget applies
+    float shadowImportance;
+    // tile in the shadow atlas, only meaningful with a shadow index
+    GLint atlasX;
+    GLint atlasY;
+    GLsizei atlasSize;
+    // slot in the shadow buffer, -1 without an atlas tile
+    int32_t shadowIndex;
+    // range of RenderWorld::shadowVisible filled by culling
+    uint32_t firstVisible;
+    uint32_t visibleCount;
+    bool isActive;
+    bool enableShadows;
+};
+
+// a spot light whose atlas tile is redrawn this frame, the first staticCount of its visible casters are static
+struct RenderShadowPass {
+    uint32_t light;
+    uint32_t staticCount;
+    bool redrawStatic;
+};
+
+// world aabbs as a structure of arrays so culling can load four boxes at once, padded to a multiple of four
+struct RenderBounds {
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> extentX;
+    std::vector<float> extentY;
+    std::vector<float> extentZ;
+};
+
+struct CullStats {
+    uint32_t objects = 0;
+    uint32_t cameraVisible = 0;
+    uint32_t shadowViews = 0;
+    uint32_t shadowTested = 0;
+    uint32_t shadowVisible = 0;
+    double cullMs = 0.0;
+};
+
+// everything the passes read, copied out of the ecs once per frame after simulation so drawing never touches
+// components. worldMatrices and bounds are indexed by object, the visible lists hold object indices
+struct RenderWorld {
+    std::vector<RenderObject> objects;
+    std::vector<mat4> worldMatrices;
+    RenderBounds bounds;
+    std::vector<RenderDraw> draws;
+    std::vector<mat4> boneMatrices;
+    std::vector<RenderPointLight> pointLights;
+    std::vector<RenderSpotLight> spotLights;
+    std::vector<uint32_t> cameraVisible;
+    std::vector<uint32_t> shadowVisible;
+    // camera visible objects the pick ray touches, only filled on frames with a pick request
+    std::vector<uint32_t> pickVisible;
+    std::vector<RenderShadowPass> shadowPasses;
+    vec3 cameraPosition = vec3::sZero();
+    float cameraNear = 0.1f;
+    float cameraFar = 100.0f;
+    uint32_t shadowMaps = 0;
+    double extractMs = 0.0;
+    bool cullingEnabled = true;
+    CullStats cullStats;
+};
+
+void extractRenderWorld(RenderWorld* world, EntityGroup* entities);
@@ -1,3 +1,4 @@
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 
@@ -412,9 +413,29 @@ void createMaterial(Resources* resources, RenderState* renderer, ComponentBlock
     material->metalness = metalness;
     material->aoStrength = aoStrength;
     material->normalStrength = normalStrength;
+    material->dirty = true;
 }
 
-void createRigidbody(EntityGroup* scene, ComponentBlock block) {
+// layers are saved by name so renaming or reordering them keeps bodies where they were. older scenes stored the index
+static JPH::ObjectLayer parseObjectLayer(const PhysicsLayers* layers, const std::string& value) {
+    JPH::ObjectLayer layer = findPhysicsLayer(layers, value);
+    if (layer == JPH::cObjectLayerInvalid && !value.empty()) {
+        char* end = nullptr;
+        const long index = std::strtol(value.c_str(), &end, 10);
+        if (*end == '\0' && index >= 0 && index < static_cast<long>(layers->numLayers)) {
+            layer = static_cast<JPH::ObjectLayer>(index);
+        }
+    }
+
+    if (layer == JPH::cObjectLayerInvalid) {
+        std::cerr << "ERROR::SCENE_LOAD::Rigidbody has an unknown physics layer: " << value << ", using NON_MOVING" << std::endl;
+        return Layers::NON_MOVING;
+    }
+
+    return layer;
+}
+
+void createRigidbody(EntityGroup* scene, const PhysicsLayers* layers, ComponentBlock block) {
     uint32_t entityID = INVALID_ID;
     std::string memberString = "";
     JPH::ObjectLayer objectLayer = Layers::NON_MOVING;
@@ -429,6 +450,7 @@ void createRigidbody(EntityGroup* scene, ComponentBlock block) {
     float mass = 1.0f;
     float floatComps[3];
     bool rotationLocked = false;
+    uint64_t cookedShape = 0;
 
     if (block.memberValueMap.count("entityID")) {
         entityID = std::stoi(block.memberValueMap["entityID"]);
@@ -466,12 +488,7 @@ void createRigidbody(EntityGroup* scene, ComponentBlock block) {
     }
 
     if (block.memberValueMap.count("layer")) {
-        memberString = block.memberValueMap["layer"];
-        if (memberString == "MOVING") {
-            objectLayer = Layers::MOVING;
-        } else if (memberString == "NON_MOVING") {
-            objectLayer = Layers::NON_MOVING;
-        }
+        objectLayer = parseObjectLayer(layers, block.memberValueMap["layer"]);
     }
 
     if (block.memberValueMap.count("center")) {
@@ -501,9 +518,19 @@ void createRigidbody(EntityGroup* scene, ComponentBlock block) {
             shapeType = JPH::EShapeSubType::Capsule;
         } else if (memberString == "cylinder") {
             shapeType = JPH::EShapeSubType::Cylinder;
+        } else if (memberString == "convexhull") {
+            shapeType = JPH::EShapeSubType::ConvexHull;
+        } else if (memberString == "mesh") {
+            shapeType = JPH::EShapeSubType::Mesh;
+        } else if (memberString == "compound") {
+            shapeType = JPH::EShapeSubType::StaticCompound;
         }
     }
 
+    if (block.memberValueMap.count("cookedShape")) {
+        cookedShape = shapeHashFromString(block.memberValueMap["cookedShape"]);
+    }
+
     RigidBody* rb = addRigidbody(scene, entityID);
     rb->rotationLocked = rotationLocked;
     rb->shape = shapeType;
@@ -514,6 +541,7 @@ void createRigidbody(EntityGroup* scene, ComponentBlock block) {
     rb->halfExtents = halfExtents;
     rb->motionType = motionType;
     rb->layer = objectLayer;
+    rb->cookedShape = cookedShape;
 }
 
 void createAnimator(EntityGroup* scene, Resources* resources, ComponentBlock block) {
@@ -623,8 +651,8 @@ void createSpotLights(EntityGroup* scene, ComponentBlock block) {
     float outerCutoff = 60.0f;
     vec3 color = vec3(1.0f, 1.0f, 1.0f);
     bool shadowsEnabled = false;
-    unsigned int shadowWidth = 800;
-    unsigned int shadowHeight = 600;
+    unsigned int shadowWidth = 1024;
+    unsigned int shadowHeight = 1024;
 
     std::string memberString;
     float floatComps[3];
@@ -678,10 +706,6 @@ void createSpotLights(EntityGroup* scene, ComponentBlock block) {
     light->enableShadows = shadowsEnabled;
     light->shadowWidth = shadowWidth;
     light->shadowHeight = shadowHeight;
-
-    if (light->enableShadows) {
-        createSpotLightShadowMap(light);
-    }
 }
 
 void createPlayer(EntityGroup* scene, ComponentBlock block) {
@@ -755,6 +779,15 @@ void createModelSettings(Resources* resources, ComponentBlock block) {
 
     ModelSettings settings;
     settings.path = path;
+
+    if (block.memberValueMap.count("colliders")) {
+        settings.colliders = getColliderType(block.memberValueMap["colliders"]);
+    }
+
+    if (block.memberValueMap.count("mergeStaticColliders")) {
+        settings.mergeStaticColliders = block.memberValueMap["mergeStaticColliders"] == "true";
+    }
+
     resources->modelImportMap[path] = settings;
 }
 
@@ -801,7 +834,66 @@ void createImportSettings(Resources* resources, std::vector<ComponentBlock>* com
     }
 }
 
-void createComponents(EntityGroup* scene, Resources* resources, std::vector<ComponentBlock>* components) {
+// scenes saved before layers were configurable have no block and keep the defaults
+void createPhysicsLayers(PhysicsLayers* layers, std::vector<ComponentBlock>* components) {
+    setDefaultPhysicsLayers(layers);
+
+    for (int i = 0; i < components->size(); i++) {
+        ComponentBlock block = components->at(i);
+        if (block.type != "PhysicsLayers") {
+            continue;
+        }
+
+        uint32_t numLayers = 0;
+        if (block.memberValueMap.count("numLayers")) {
+            numLayers = std::stoi(block.memberValueMap["numLayers"]);
+        }
+
+        if (numLayers == 0 || numLayers > cMaxObjectLayers) {
+            std::cerr << "ERROR::SCENE_LOAD::PhysicsLayers has an invalid layer count: " << numLayers << std::endl;
+            return;
+        }
+
+        layers->numLayers = numLayers;
+        for (uint32_t j = 0; j < numLayers; j++) {
+            std::string key = "layer" + std::to_string(j);
+            std::string name = key;
+            uint32_t broadPhaseLayer = 0;
+            uint32_t collisionMask = 0;
+            bool contactEvents = false;
+
+            // name, broadphase, collision mask and an optional contact event flag
+            if (block.memberValueMap.count(key)) {
+                std::string memberString = block.memberValueMap[key];
+                size_t first = memberString.find(',');
+                size_t second = memberString.find(',', first + 1);
+                if (first != std::string::npos && second != std::string::npos) {
+                    size_t third = memberString.find(',', second + 1);
+                    name = memberString.substr(0, first);
+                    broadPhaseLayer = std::stoi(memberString.substr(first + 1, second - first - 1));
+                    collisionMask = std::stoul(memberString.substr(second + 1, third - second - 1));
+                    if (third != std::string::npos) {
+                        contactEvents = std::stoi(memberString.substr(third + 1)) != 0;
+                    }
+                }
+            }
+
+            if (broadPhaseLayer >= BroadPhaseLayers::NUM_LAYERS) {
+                broadPhaseLayer = 0;
+            }
+
+            layers->names[j] = name;
+            layers->broadPhaseLayers[j] = JPH::BroadPhaseLayer(static_cast<JPH::BroadPhaseLayer::Type>(broadPhaseLayer));
+            layers->collisionMasks[j] = collisionMask;
+            layers->contactEvents[j] = contactEvents;
+        }
+
+        updateBroadPhaseMasks(layers);
+        return;
+    }
+}
+
+void createComponents(EntityGroup* scene, Resources* resources, const PhysicsLayers* layers, std::vector<ComponentBlock>* components) {
     for (int i = 0; i < components->size(); i++) {
         ComponentBlock block = components->at(i);
 
@@ -812,7 +904,7 @@ void createComponents(EntityGroup* scene, Resources* resources, std::vector<Comp
         } else if (block.type == "MeshRenderer") {
             createMeshRenderer(scene, resources, block);
         } else if (block.type == "Rigidbody") {
-            createRigidbody(scene, block);
+            createRigidbody(scene, layers, block);
         } else if (block.type == "Animator") {
             createAnimator(scene, resources, block);
         } else if (block.type == "Camera") {
@@ -859,7 +951,6 @@ void loadResourceSettings(Resources* resources, std::unordered_set<std::string>&
 
 void initializeScene(Scene* scene) {
     EntityGroup* entities = &scene->entities;
-    JPH::BodyInterface* bodyInterface = scene->physicsScene.bodyInterface;
 
     for (int i = 0; i < entities->transforms.size(); i++) {
         Transform* transform = getTransform(entities, entities->transforms[i].entityID);
@@ -873,14 +964,14 @@ void initializeScene(Scene* scene) {
         updateTransformMatrices(entities, &entities->transforms[i]);
     }
 
+    std::vector<uint32_t> rigidbodyIDs;
+    rigidbodyIDs.reserve(entities->rigidbodies.size());
     for (int i = 0; i < entities->rigidbodies.size(); i++) {
-        RigidBody* rb = &entities->rigidbodies[i];
-        initializeRigidbody(rb, &scene->physicsScene, &scene->entities);
-        bodyInterface->SetPositionAndRotation(rb->joltBody, getPosition(entities, rb->entityID), getRotation(entities, rb->entityID), JPH::EActivation::DontActivate);
-        rb->lastPosition = getPosition(entities, rb->entityID);
-        rb->lastRotation = getRotation(entities, rb->entityID);
+        rigidbodyIDs.push_back(entities->rigidbodies[i].entityID);
     }
 
+    addRigidbodies(&scene->physicsScene, entities, rigidbodyIDs, JPH::EActivation::DontActivate);
+
     for (MeshRenderer& renderer : entities->meshRenderers) {
         initializeMeshRenderer(&scene->entities, &renderer);
     }
@@ -990,11 +1081,15 @@ void loadPrefab(Resources* resources, std::filesystem::path path) {
     getTokens(&stream, &tokens);
     parseTokens(&tokens, &components);
     uint32_t rootID = transposeIDs(&resources->prefabGroup, &components);
-    createComponents(&resources->prefabGroup, resources, &components);
+    // prefabs load before any scene, so their layer names resolve against the default layers
+    PhysicsLayers layers;
+    setDefaultPhysicsLayers(&layers);
+    createComponents(&resources->prefabGroup, resources, &layers, &components);
     resources->prefabMap[path.filename().string()] = rootID;
 }
 
 void loadTempScene(Resources* resources, Scene* scene) {
+    beginPhysicsLoad(&scene->physicsScene);
     std::string fileName = scene->scenePath.substr(scene->scenePath.find_last_of('/') + 1);
     scene->name = fileName.substr(0, fileName.find('.'));
     std::ifstream stream("..\\data\\scenes\\temp.tempscene");
@@ -1002,11 +1097,13 @@ void loadTempScene(Resources* resources, Scene* scene) {
     std::vector<ComponentBlock> components;
     getTokens(&stream, &tokens);
     parseTokens(&tokens, &components);
-    createComponents(&scene->entities, resources, &components);
+    createPhysicsLayers(&scene->physicsScene.layers, &components);
+    createComponents(&scene->entities, resources, &scene->physicsScene.layers, &components);
     initializeScene(scene);
 }
 
 void loadScene(Resources* resources, Scene* scene) {
+    beginPhysicsLoad(&scene->physicsScene);
     std::string fileName = scene->scenePath.substr(scene->scenePath.find_last_of('/') + 1);
     scene->name = fileName.substr(0, fileName.find('.'));
     std::ifstream stream(scene->scenePath);
@@ -1015,7 +1112,8 @@ void loadScene(Resources* resources, Scene* scene) {
     getTokens(&stream, &tokens);
     parseTokens(&tokens, &components);
     EntityGroup* entities = &scene->entities;
-    createComponents(entities, resources, &components);
+    createPhysicsLayers(&scene->physicsScene.layers, &components);
+    createComponents(entities, resources, &scene->physicsScene.layers, &components);
     initializeScene(scene);
     writeTempScene(scene);
 }
@@ -1026,6 +1124,7 @@ void loadFirstFoundScene(Scene* scene, Resources* resources) {
         return;
     }
 
+    beginPhysicsLoad(&scene->physicsScene);
     std::string fileName = scene->scenePath.substr(scene->scenePath.find_last_of('/') + 1);
     scene->name = fileName.substr(0, fileName.find('.'));
     std::ifstream stream(scene->scenePath);
@@ -1034,7 +1133,8 @@ void loadFirstFoundScene(Scene* scene, Resources* resources) {
     getTokens(&stream, &tokens);
     parseTokens(&tokens, &components);
     EntityGroup* entities = &scene->entities;
-    createComponents(entities, resources, &components);
+    createPhysicsLayers(&scene->physicsScene.layers, &components);
+    createComponents(entities, resources, &scene->physicsScene.layers, &components);
     initializeScene(scene);
     writeTempScene(scene);
 }
@@ -1183,7 +1283,7 @@ void writeMeshRenderers(MeshRenderer* renderer, std::ofstream* stream) {
             << std::endl;
 }
 
-void writeRigidbodies(RigidBody* rb, std::ofstream* stream) {
+void writeRigidbodies(RigidBody* rb, const PhysicsLayers* layers, std::ofstream* stream) {
     if (rb == nullptr) {
         return;
     }
@@ -1207,13 +1307,10 @@ void writeRigidbodies(RigidBody* rb, std::ofstream* stream) {
     halfExtentString = std::to_string(rb->halfExtents.GetX()) + ", " + std::to_string(rb->halfExtents.GetY()) + ", " + std::to_string(rb->halfExtents.GetZ());
     halfHeightString = std::to_string(rb->halfHeight);
 
-    switch (rb->layer) {
-        case Layers::MOVING:
-            objectLayerString = "MOVING";
-            break;
-        case Layers::NON_MOVING:
-            objectLayerString = "NON_MOVING";
-            break;
+    if (rb->layer < layers->numLayers) {
+        objectLayerString = layers->names[rb->layer];
+    } else {
+        objectLayerString = layers->names[Layers::NON_MOVING];
     }
 
     switch (rb->motionType) {
@@ -1241,6 +1338,15 @@ void writeRigidbodies(RigidBody* rb, std::ofstream* stream) {
         case JPH::EShapeSubType::Cylinder:
             shapeString = "cylinder";
             break;
+        case JPH::EShapeSubType::ConvexHull:
+            shapeString = "convexhull";
+            break;
+        case JPH::EShapeSubType::Mesh:
+            shapeString = "mesh";
+            break;
+        case JPH::EShapeSubType::StaticCompound:
+            shapeString = "compound";
+            break;
     }
 
     *stream << "Rigidbody {" << std::endl;
@@ -1254,6 +1360,9 @@ void writeRigidbodies(RigidBody* rb, std::ofstream* stream) {
     *stream << "halfExtents: " << halfExtentString << std::endl;
     *stream << "halfHeight: " << halfHeightString << std::endl;
     *stream << "radius: " << radiusString << std::endl;
+    if (rb->cookedShape != 0) {
+        *stream << "cookedShape: " << shapeHashToString(rb->cookedShape) << std::endl;
+    }
     *stream << "}" << std::endl
             << std::endl;
 }
@@ -1377,7 +1486,17 @@ void writeCameras(Camera* camera, std::ofstream* stream) {
             << std::endl;
 }
 
-void writeEntityGroup(EntityGroup* entities, std::ofstream* stream) {
+void writePhysicsLayers(PhysicsLayers* layers, std::ofstream* stream) {
+    *stream << "PhysicsLayers {" << std::endl;
+    *stream << "numLayers: " << layers->numLayers << std::endl;
+    for (uint32_t i = 0; i < layers->numLayers; i++) {
+        *stream << "layer" << i << ": " << layers->names[i] << ", " << static_cast<uint32_t>(static_cast<JPH::BroadPhaseLayer::Type>(layers->broadPhaseLayers[i])) << ", " << layers->collisionMasks[i] << ", " << layers->contactEvents[i] << std::endl;
+    }
+    *stream << "}" << std::endl
+            << std::endl;
+}
+
+void writeEntityGroup(EntityGroup* entities, const PhysicsLayers* layers, std::ofstream* stream) {
     for (int i = 0; i < entities->entities.size(); i++) {
         writeEntities(&entities->entities[i], stream);
     }
@@ -1391,7 +1510,7 @@ void writeEntityGroup(EntityGroup* entities, std::ofstream* stream) {
         writeAnimators(&entities->animators[i], stream);
     }
     for (int i = 0; i < entities->rigidbodies.size(); i++) {
-        writeRigidbodies(&entities->rigidbodies[i], stream);
+        writeRigidbodies(&entities->rigidbodies[i], layers, stream);
     }
     for (int i = 0; i < entities->pointLights.size(); i++) {
         writePointLights(&entities->pointLights[i], stream);
@@ -1411,14 +1530,16 @@ void saveScene(Scene* scene, Resources* resources) {
     EntityGroup* entities = &scene->entities;
     writeTempScene(scene);
     std::ofstream stream(scene->scenePath);
-    writeEntityGroup(entities, &stream);
+    writePhysicsLayers(&scene->physicsScene.layers, &stream);
+    writeEntityGroup(entities, &scene->physicsScene.layers, &stream);
     writeMaterials(resources);
 }
 
 void writeTempScene(Scene* scene) {
     EntityGroup* entities = &scene->entities;
     std::ofstream stream("..\\data\\scenes\\temp.tempscene");
-    writeEntityGroup(entities, &stream);
+    writePhysicsLayers(&scene->physicsScene.layers, &stream);
+    writeEntityGroup(entities, &scene->physicsScene.layers, &stream);
 }
 
 static bool checkFilenameUnique(std::string path, std::string filename) {
@@ -1434,7 +1555,7 @@ static bool checkFilenameUnique(std::string path, std::string filename) {
     return true;
 }
 
-void writeEntityHierarchy(EntityGroup* entities, uint32_t entityID, std::ofstream* stream) {
+void writeEntityHierarchy(EntityGroup* entities, const PhysicsLayers* layers, uint32_t entityID, std::ofstream* stream) {
     Entity* entity = getEntity(entities, entityID);
     Transform* transform = getTransform(entities, entityID);
     MeshRenderer* meshRenderer = getMeshRenderer(entities, entityID);
@@ -1449,14 +1570,14 @@ void writeEntityHierarchy(EntityGroup* entities, uint32_t entityID, std::ofstrea
     writeTransforms(transform, stream);
     writeMeshRenderers(meshRenderer, stream);
     writeAnimators(animator, stream);
-    writeRigidbodies(rb, stream);
+    writeRigidbodies(rb, layers, stream);
     writePointLights(pointLight, stream);
     writeSpotLights(spotLight, stream);
     writeCameras(camera, stream);
     writePlayer(player, stream);
 
     for (int i = 0; i < transform->childEntityIds.size(); i++) {
-        writeEntityHierarchy(entities, transform->childEntityIds[i], stream);
+        writeEntityHierarchy(entities, layers, transform->childEntityIds[i], stream);
     }
 }
 
@@ -1477,6 +1598,6 @@ std::string writeNewPrefab(Scene* scene, uint32_t entityID) {
 
     std::string path = "..\\resources\\" + fileName;
     std::ofstream stream(path);
-    writeEntityHierarchy(entities, entityID, &stream);
+    writeEntityHierarchy(entities, &scene->physicsScene.layers, entityID, &stream);
     return path;
 }
@@ -3,6 +3,9 @@
 #include <iostream>
 #include "shader.h"
 #include "scene.h"
+#include "lightclusters.h"
+
+static std::unordered_map<GLuint, ShaderReflection> shaderReflections;
 
 void checkShaderCompilation(unsigned int shader, std::string path) {
     int success;
@@ -32,7 +35,91 @@ void checkProgramLink(unsigned int program, std::string vertexPath, std::string
     }
 }
 
-unsigned int loadShader(std::string vertexFile, std::string fragmentFile) {
+static std::string getResourceName(GLuint program, GLenum interface, GLuint index, GLint length) {
+    std::string name(length, '\0');
+    glGetProgramResourceName(program, interface, index, length, nullptr, &name[0]);
+    name.resize(length > 0 ? length - 1 : 0);
+    return name;
+}
+
+static void reflectBlocks(GLuint program, GLenum interface, ShaderReflection* reflection) {
+    GLint numBlocks = 0;
+    glGetProgramInterfaceiv(program, interface, GL_ACTIVE_RESOURCES, &numBlocks);
+    const GLenum properties[3] = {GL_NAME_LENGTH, GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE};
+
+    for (GLint i = 0; i < numBlocks; i++) {
+        GLint values[3];
+        glGetProgramResourceiv(program, interface, i, 3, properties, 3, nullptr, values);
+        reflection->blocks[getResourceName(program, interface, i, values[0])] = {interface, values[1], values[2]};
+    }
+}
+
+// uniforms that live in a block have no location and are only reachable through the block
+static void reflectProgram(GLuint program, const std::string& name) {
+    ShaderReflection* reflection = &shaderReflections[program];
+    reflection->name = name;
+    reflection->uniforms.clear();
+    reflection->blocks.clear();
+
+    GLint numUniforms = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &numUniforms);
+    const GLenum properties[4] = {GL_NAME_LENGTH, GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION};
+
+    for (GLint i = 0; i < numUniforms; i++) {
+        GLint values[4];
+        glGetProgramResourceiv(program, GL_UNIFORM, i, 4, properties, 4, nullptr, values);
+        if (values[3] < 0) {
+            continue;
+        }
+
+        std::string uniformName = getResourceName(program, GL_UNIFORM, i, values[0]);
+        ShaderUniform uniform = {values[3], static_cast<GLenum>(values[1]), values[2]};
+        reflection->uniforms[uniformName] = uniform;
+
+        const size_t arraySuffix = uniformName.rfind("[0]");
+        if (arraySuffix != std::string::npos && arraySuffix + 3 == uniformName.size()) {
+            reflection->uniforms[uniformName.substr(0, arraySuffix)] = uniform;
+        }
+    }
+
+    reflectBlocks(program, GL_UNIFORM_BLOCK, reflection);
+    reflectBlocks(program, GL_SHADER_STORAGE_BLOCK, reflection);
+}
+
+const ShaderReflection* getShaderReflection(GLuint program) {
+    auto it = shaderReflections.find(program);
+    return it != shaderReflections.end() ? &it->second : nullptr;
+}
+
+// handles are looked up right after loading, so a renamed or optimized out uniform shows up at startup
+const ShaderUniform* findUniform(GLuint program, const std::string& name, GLenum type) {
+    const ShaderReflection* reflection = getShaderReflection(program);
+    if (reflection == nullptr) {
+        std::cerr << "ERROR::SHADER::NOT_REFLECTED::Program " << program << " wasn't loaded through loadShader" << std::endl;
+        return nullptr;
+    }
+
+    auto it = reflection->uniforms.find(name);
+    if (it == reflection->uniforms.end()) {
+        std::cerr << "ERROR::SHADER::MISSING_UNIFORM::" << name << " is not an active uniform in " << reflection->name << std::endl;
+        return nullptr;
+    }
+
+    if (it->second.type != type) {
+        std::cerr << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH::" << name << " in " << reflection->name << " is 0x" << std::hex << it->second.type << ", expected 0x" << type << std::dec << std::endl;
+        return nullptr;
+    }
+
+    return &it->second;
+}
+
+// defines go right after the #version line, variants of one file differ only in those
+static void insertDefines(std::string* source, const std::string& defines) {
+    const size_t versionEnd = source->find('\n');
+    source->insert(versionEnd == std::string::npos ? source->size() : versionEnd + 1, defines);
+}
+
+GLuint loadShader(std::string vertexFile, std::string fragmentFile, std::string vertexDefines, std::string fragmentDefines) {
     std::ifstream vertexFileStream;
     std::ifstream fragmentFileStream;
 
@@ -65,6 +152,8 @@ unsigned int loadShader(std::string vertexFile, std::string fragmentFile) {
         std::cerr << "ERROR::SHADER::COULD_NOT_OPEN_OR_READ_FILE: " << e.what() << std::endl;
     }
 
+    insertDefines(&vertexString, vertexDefines);
+    insertDefines(&fragmentString, fragmentDefines);
     vertexCode = vertexString.c_str();
     fragmentCode = fragmentString.c_str();
 
@@ -90,28 +179,29 @@ unsigned int loadShader(std::string vertexFile, std::string fragmentFile) {
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 
+    reflectProgram(shaderProgram, vertexFile + (vertexDefines.empty() ? "" : " (" + vertexDefines.substr(0, vertexDefines.size() - 1) + ")") + " <<>> " + fragmentFile);
     return shaderProgram;
 }
 
 void PrintActiveUniforms(GLuint program) {
-    GLint numUniforms = 0;
-    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &numUniforms);
-
-    std::cout << "Active Uniforms in Program " << program << ":\n";
+    const ShaderReflection* reflection = getShaderReflection(program);
+    if (reflection == nullptr) {
+        return;
+    }
 
-    char nameBuffer[256];
-    for (GLint i = 0; i < numUniforms; ++i) {
-        GLsizei length = 0;
-        GLint size = 0;
-        GLenum type = 0;
+    std::cout << "Active Uniforms in Program " << program << " (" << reflection->name << "):\n";
 
-        glGetActiveUniform(program, i, sizeof(nameBuffer), &length, &size, &type, nameBuffer);
-        GLint location = glGetUniformLocation(program, nameBuffer);
+    for (const auto& pair : reflection->uniforms) {
+        std::cout << "  " << pair.first
+                  << " | Type: 0x" << std::hex << pair.second.type
+                  << " | Size: " << std::dec << pair.second.arraySize
+                  << " | Location: " << pair.second.location << '\n';
+    }
 
-        std::cout << "  #" << i << ": " << nameBuffer
-                  << " | Type: 0x" << std::hex << type
-                  << " | Size: " << std::dec << size
-                  << " | Location: " << location << '\n';
+    for (const auto& pair : reflection->blocks) {
+        std::cout << "  block " << pair.first
+                  << " | Binding: " << pair.second.binding
+                  << " | Size: " << pair.second.dataSize << '\n';
     }
 }
 
@@ -120,12 +210,41 @@ void loadEditorShaders(RenderState *renderer) {
     renderer->debugShader = loadShader("debugShader.vs", "debugShader.fs");
 }
 
+static void getLightingUniforms(GLuint program, LightingShaderUniforms* lighting) {
+    lighting->fogDensity = getUniform<float>(program, "fogDensity");
+    lighting->minFogDistance = getUniform<float>(program, "minFogDistance");
+    lighting->maxFogDistance = getUniform<float>(program, "maxFogDistance");
+    lighting->fogColor = getUniform<vec3>(program, "fogColor");
+    lighting->clusterTileSize = getUniform<glm::vec2>(program, "clusterTileSize");
+    lighting->clusterScale = getUniform<float>(program, "clusterScale");
+    lighting->clusterBias = getUniform<float>(program, "clusterBias");
+}
+
+// the lit fragment stage indexes the light clusters, its grid has to match the one lightclusters.cpp builds
+static std::string getClusterShaderDefines() {
+    return "#define CLUSTER_GRID_X " + std::to_string(cClusterGridX) + "u\n" +
+           "#define CLUSTER_GRID_Y " + std::to_string(cClusterGridY) + "u\n" +
+           "#define CLUSTER_GRID_Z " + std::to_string(cClusterGridZ) + "u\n";
+}
+
+// mesh passes get a static and a skinned variant, only the skinned one reads the skin stream and bone palette
 void loadShaders(RenderState *scene) {
+    const std::string clusterDefines = getClusterShaderDefines();
     scene->depthShader = loadShader("depthprepassshader.vs", "depthprepassshader.fs");
-    scene->lightingShader = loadShader("pbrlitshader.vs", "pbrlitshader.fs");
+    scene->depthSkinnedShader = loadShader("depthprepassshader.vs", "depthprepassshader.fs", cSkinnedShaderDefines);
+    scene->lightingShader = loadShader("pbrlitshader.vs", "pbrlitshader.fs", "", clusterDefines);
+    scene->lightingSkinnedShader = loadShader("pbrlitshader.vs", "pbrlitshader.fs", cSkinnedShaderDefines, clusterDefines);
     scene->ssaoShader = loadShader("SSAOshader.vs", "SSAOshader.fs");
     scene->shadowBlurShader = loadShader("SSAOshader.vs", "shadowmapblurshader.fs");
     scene->simpleBlurShader = loadShader("SSAOshader.vs", "SSAOblurshader.fs");
-    scene->blurShader = loadShader("gaussianblurshader.vs", "gaussianblurshader.fs");
+    scene->bloomDownsampleShader = loadShader("postprocessshader.vs", "bloomdownsampleshader.fs");
+    scene->bloomUpsampleShader = loadShader("postprocessshader.vs", "bloomupsampleshader.fs");
     scene->postProcessShader = loadShader("postprocessshader.vs", "postprocessshader.fs");
+
+    getLightingUniforms(scene->lightingShader, &scene->lightingUniforms);
+    getLightingUniforms(scene->lightingSkinnedShader, &scene->lightingSkinnedUniforms);
+    scene->lightingSkinnedUniforms.boneMatrices = getUniform<mat4>(scene->lightingSkinnedShader, "finalBoneMatrices");
+
+    scene->depthUniforms.boneMatrices = getUniform<mat4>(scene->depthSkinnedShader, "finalBoneMatrices");
+    scene->ssaoUniforms.samples = getUniform<vec3>(scene->ssaoShader, "samples");
 }
\ No newline at end of file
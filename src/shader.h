@@ -1,15 +1,124 @@
 #pragma once
 #include <glad/glad.h>
 #include <glfw/glfw3.h>
+#include <string>
+#include <unordered_map>
+#include "utils/mathutils.h"
 
 constexpr char* shaderPath = "../src/shaders/";
+constexpr char* cSkinnedShaderDefines = "#define SKINNED\n";
 
 struct Scene;
 struct EditorState;
 struct RenderState;
 
+struct ShaderUniform {
+    GLint location = -1;
+    GLenum type = GL_NONE;
+    GLint arraySize = 0;
+};
+
+struct ShaderBlock {
+    GLenum interface;
+    GLint binding;
+    GLint dataSize;
+};
+
+// filled once when the program links, arrays are stored both as "name[0]" and "name"
+struct ShaderReflection {
+    std::string name;
+    std::unordered_map<std::string, ShaderUniform> uniforms;
+    std::unordered_map<std::string, ShaderBlock> blocks;
+};
+
+// typed location, the type is checked against the reflected one when the handle is looked up
+template <typename T>
+struct Uniform {
+    GLint location = -1;
+};
+
+template <typename T>
+constexpr GLenum uniformType();
+template <>
+constexpr GLenum uniformType<float>() { return GL_FLOAT; }
+template <>
+constexpr GLenum uniformType<int>() { return GL_INT; }
+template <>
+constexpr GLenum uniformType<glm::vec2>() { return GL_FLOAT_VEC2; }
+template <>
+constexpr GLenum uniformType<vec3>() { return GL_FLOAT_VEC3; }
+template <>
+constexpr GLenum uniformType<vec4>() { return GL_FLOAT_VEC4; }
+template <>
+constexpr GLenum uniformType<mat4>() { return GL_FLOAT_MAT4; }
+
+struct LightingShaderUniforms {
+    Uniform<float> fogDensity;
+    Uniform<float> minFogDistance;
+    Uniform<float> maxFogDistance;
+    Uniform<vec3> fogColor;
+    Uniform<glm::vec2> clusterTileSize;
+    Uniform<float> clusterScale;
+    Uniform<float> clusterBias;
+    // skinned variant only
+    Uniform<mat4> boneMatrices;
+};
+
+struct DepthShaderUniforms {
+    // skinned variant only
+    Uniform<mat4> boneMatrices;
+};
+
+struct SSAOShaderUniforms {
+    Uniform<vec3> samples;
+};
+
+GLuint loadShader(std::string vertexFile, std::string fragmentFile, std::string vertexDefines = "", std::string fragmentDefines = "");
 void loadEditorShaders(RenderState* renderer);
 void loadShaders(RenderState* scene);
+const ShaderReflection* getShaderReflection(GLuint program);
+const ShaderUniform* findUniform(GLuint program, const std::string& name, GLenum type);
+void PrintActiveUniforms(GLuint program);
+
+template <typename T>
+Uniform<T> getUniform(GLuint program, const std::string& name) {
+    Uniform<T> uniform;
+    const ShaderUniform* reflected = findUniform(program, name, uniformType<T>());
+    uniform.location = reflected != nullptr ? reflected->location : -1;
+    return uniform;
+}
+
+inline void setUniform(Uniform<float> uniform, float value) {
+    glUniform1f(uniform.location, value);
+}
+
+inline void setUniform(Uniform<int> uniform, int value) {
+    glUniform1i(uniform.location, value);
+}
+
+inline void setUniform(Uniform<glm::vec2> uniform, const glm::vec2& value) {
+    glUniform2fv(uniform.location, 1, glm::value_ptr(value));
+}
+
+inline void setUniform(Uniform<vec3> uniform, const vec3& value) {
+    glUniform3fv(uniform.location, 1, value.mF32);
+}
+
+inline void setUniform(Uniform<vec4> uniform, const vec4& value) {
+    glUniform4fv(uniform.location, 1, value.mF32);
+}
+
+inline void setUniform(Uniform<mat4> uniform, const mat4* values, GLsizei count) {
+    glUniformMatrix4fv(uniform.location, count, GL_FALSE, reinterpret_cast<const GLfloat*>(values));
+}
+
+// array elements of a basic type get consecutive locations
+template <typename T>
+Uniform<T> uniformElement(Uniform<T> uniform, GLint index) {
+    Uniform<T> element;
+    element.location = uniform.location < 0 ? -1 : uniform.location + index;
+    return element;
+}
 
 namespace vertex_attribute_location {
 constexpr unsigned int kVertexPosition = 0;
@@ -48,17 +157,14 @@ constexpr unsigned int kInvProjectionMatrix = 5;
 // post-process uniforms
 constexpr unsigned int kPExposure = 3;
 constexpr unsigned int kPBloomAmount = 4;
-// blur uniforms
-constexpr unsigned int kBHorizontal = 3;
+// bloom uniforms
+constexpr unsigned int kBFirstLevel = 3;
 // texture units
-constexpr unsigned int kTextureAlbedoUnit = 0;
-constexpr unsigned int kTextureRoughnessUnit = 1;
-constexpr unsigned int kTextureMetallicUnit = 2;
-constexpr unsigned int kTextureAOUnit = 3;
-constexpr unsigned int kTextureNormalUnit = 4;
+// material texture arrays, one unit per array up to cMaxTextureArrays
+constexpr unsigned int kTextureMaterialUnit = 0;
 constexpr unsigned int kTextureSSAOUnit = 5;
 constexpr unsigned int kTextureNoiseUnit = 6;
-constexpr unsigned int kTextureShadowMapUnit = 5;
+constexpr unsigned int kTextureShadowAtlasUnit = 16;
 
 constexpr unsigned int kTextureSSAONoiseUnit = 0;
 constexpr unsigned int kTextureDepthUnit = 1;
@@ -7,7 +7,6 @@ in vec2 TexCoords;
 layout (binding = 0) uniform sampler2D gPosition;
 layout (binding = 1) uniform sampler2D gNormal;
 layout (binding = 2) uniform sampler2D texNoise;
-layout (binding = 3) uniform sampler2D bloomTex;
 
 uniform vec3 samples[8];
 
@@ -25,7 +24,6 @@ layout (location = 9) uniform float power;
 
 void main()
 {
-    vec4 color = texture(bloomTex, TexCoords);
     vec3 fragPos = texture(gPosition, TexCoords).xyz;
     vec3 normal = normalize(texture(gNormal, TexCoords).rgb);
     vec3 randomVec = normalize(texture(texNoise, TexCoords * noiseScale).xyz);
@@ -65,6 +63,5 @@ void main()
 
     occlusion = 1.0 - (occlusion / kernelSize);
 
-    color.a = pow(occlusion, power);
-    FragColor = color;
+    FragColor = vec4(pow(occlusion, power));
 }
\ No newline at end of file
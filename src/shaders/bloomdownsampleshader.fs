@@ -0,0 +1,57 @@
+#version 460 core
+out vec4 FragColor;
+
+layout (location = 2) in vec2 texCoord;
+
+// the level above the one being written, the texture's base level is moved to it so lod 0 reads it
+layout (binding = 0) uniform sampler2D source;
+
+// reading the bright pass, single very bright pixels are averaged down so they don't flicker as they move
+layout (location = 3) uniform bool firstLevel;
+
+float karisWeight(vec3 c){
+    return 1.0 / (1.0 + dot(c, vec3(0.2126, 0.7152, 0.0722)));
+}
+
+vec3 karisAverage(vec3 a, vec3 b, vec3 c, vec3 d){
+    float wa = karisWeight(a);
+    float wb = karisWeight(b);
+    float wc = karisWeight(c);
+    float wd = karisWeight(d);
+    return (a * wa + b * wb + c * wc + d * wd) / (wa + wb + wc + wd);
+}
+
+// 13 bilinear taps covering a 6x6 texel footprint, weighted as five overlapping 2x2 boxes
+void main(){
+    vec2 texel = 1.0 / textureSize(source, 0);
+
+    vec3 a = texture(source, texCoord + texel * vec2(-2.0, 2.0)).rgb;
+    vec3 b = texture(source, texCoord + texel * vec2(0.0, 2.0)).rgb;
+    vec3 c = texture(source, texCoord + texel * vec2(2.0, 2.0)).rgb;
+    vec3 d = texture(source, texCoord + texel * vec2(-2.0, 0.0)).rgb;
+    vec3 e = texture(source, texCoord).rgb;
+    vec3 f = texture(source, texCoord + texel * vec2(2.0, 0.0)).rgb;
+    vec3 g = texture(source, texCoord + texel * vec2(-2.0, -2.0)).rgb;
+    vec3 h = texture(source, texCoord + texel * vec2(0.0, -2.0)).rgb;
+    vec3 i = texture(source, texCoord + texel * vec2(2.0, -2.0)).rgb;
+    vec3 j = texture(source, texCoord + texel * vec2(-1.0, 1.0)).rgb;
+    vec3 k = texture(source, texCoord + texel * vec2(1.0, 1.0)).rgb;
+    vec3 l = texture(source, texCoord + texel * vec2(-1.0, -1.0)).rgb;
+    vec3 m = texture(source, texCoord + texel * vec2(1.0, -1.0)).rgb;
+
+    vec3 result;
+    if(firstLevel){
+        result = karisAverage(j, k, l, m) * 0.5;
+        result += karisAverage(a, b, d, e) * 0.125;
+        result += karisAverage(b, c, e, f) * 0.125;
+        result += karisAverage(d, e, g, h) * 0.125;
+        result += karisAverage(e, f, h, i) * 0.125;
+    } else {
+        result = e * 0.125;
+        result += (a + c + g + i) * 0.03125;
+        result += (b + d + f + h) * 0.0625;
+        result += (j + k + l + m) * 0.125;
+    }
+
+    FragColor = vec4(result, 1.0);
+}
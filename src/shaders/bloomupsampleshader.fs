@@ -0,0 +1,24 @@
+#version 460 core
+out vec4 FragColor;
+
+layout (location = 2) in vec2 texCoord;
+
+// the level below the one being written, added on top of what the downsample left there
+layout (binding = 0) uniform sampler2D source;
+
+// 3x3 tent
+void main(){
+    vec2 texel = 1.0 / textureSize(source, 0);
+
+    vec3 result = texture(source, texCoord).rgb * 4.0;
+    result += texture(source, texCoord + texel * vec2(0.0, 1.0)).rgb * 2.0;
+    result += texture(source, texCoord + texel * vec2(-1.0, 0.0)).rgb * 2.0;
+    result += texture(source, texCoord + texel * vec2(1.0, 0.0)).rgb * 2.0;
+    result += texture(source, texCoord + texel * vec2(0.0, -1.0)).rgb * 2.0;
+    result += texture(source, texCoord + texel * vec2(-1.0, 1.0)).rgb;
+    result += texture(source, texCoord + texel * vec2(1.0, 1.0)).rgb;
+    result += texture(source, texCoord + texel * vec2(-1.0, -1.0)).rgb;
+    result += texture(source, texCoord + texel * vec2(1.0, -1.0)).rgb;
+
+    FragColor = vec4(result / 16.0, 1.0);
+}
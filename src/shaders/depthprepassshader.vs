@@ -1,33 +1,42 @@
 #version 460 core
 layout (location = 0) in vec3 aPos;
-layout (location = 4) in ivec4 boneIds;
-layout (location = 5) in vec4 weights;
 
 layout (location = 1) uniform mat4 viewProjection;
-layout (location = 2) uniform mat4 model;
+
+#ifdef SKINNED
+layout (location = 4) in uvec4 boneIds;
+layout (location = 5) in vec4 weights;
 
 uniform mat4 finalBoneMatrices[100];
 
+// weights are unorm8 and sum to one, a vertex without influences stays in its bind pose
+mat4 skinMatrix(){
+    if(weights == vec4(0.0))
+        return mat4(1.0);
 
-void main()
-{
-    vec4 totalPosition = vec4(0.0);
+    return finalBoneMatrices[boneIds.x] * weights.x + finalBoneMatrices[boneIds.y] * weights.y +
+           finalBoneMatrices[boneIds.z] * weights.z + finalBoneMatrices[boneIds.w] * weights.w;
+}
+#endif
+
+struct InstanceData {
+    mat4 model;
+    uvec4 params;
+};
 
-    for(int i = 0; i < 4; i++){
-        if(boneIds[i] == -1) 
-            continue;
+layout (std430, binding = 1) readonly buffer instanceBuffer {
+    InstanceData instances[];
+};
 
-         if(boneIds[i] >= 100) 
-        {
-            totalPosition = vec4(aPos, 1.0);
-            break;
-        }  
+void main()
+{
+    mat4 model = instances[gl_BaseInstance + gl_InstanceID].model;
+    vec4 totalPosition = vec4(aPos, 1.0);
 
-        vec4 localPosition = finalBoneMatrices[boneIds[i]] * vec4(aPos,1.0);
-        totalPosition += localPosition * weights[i];
-    }
+#ifdef SKINNED
+    totalPosition = skinMatrix() * totalPosition;
+#endif
 
     vec4 modelPos = model * totalPosition;
-    // gl_Position = viewProjection * model * vec4(aPos, 1.0);
     gl_Position = viewProjection * modelPos;
 }
\ No newline at end of file
@@ -9,22 +9,17 @@ struct DirectionalLight {
     bool enabled;
 };
 
-struct PointLight {
-    vec3 position;
-    vec3 color;
-    float brightness;
-    int isEnabled;
-};
-
-struct SpotLight{
-    vec3 position;//0
-    vec3 direction;//1
-    vec3 color;//2
-    float brightness;//3
-    float cutOff;//4
-    float outerCutOff;//5
-    int isEnabled;//6
-    int shadows; //7
+const int LIGHT_POINT = 0;
+const int LIGHT_SPOT = 1;
+
+struct LightData {
+    vec4 positionRange;
+    vec4 colorBrightness;
+    vec4 directionCosOuter;
+    float cosCutoff;
+    int type;
+    int shadowIndex;
+    float padding;
 };
 
 const float PI = 3.14159265359;
@@ -37,30 +32,63 @@ in VertToFrag{
     mat3 TBN;
     vec3 gPosition;
     vec3 gNormal;
-    vec4 fragPosLightSpace[16];
-    flat int numSpotLights;
-    flat int numPointLights;
+    flat uint materialIndex;
 } fromVert;
 
-layout (binding = 0) uniform sampler2D albedoMap;
-layout (binding = 1) uniform sampler2D roughnessMap;
-layout (binding = 2) uniform sampler2D metallicMap;
-layout (binding = 3) uniform sampler2D aoMap;
-layout (binding = 4) uniform sampler2D normalMap;
-layout (binding = 5) uniform sampler2D spotLightShadowMaps[16];
+// textures are array << 16 | layer
+struct MaterialData {
+    vec4 baseColor;
+    vec2 textureTiling;
+    float roughness;
+    float metalness;
+    float aoStrength;
+    float normalStrength;
+    uint textures[5];
+    uint padding;
+};
+
+layout (std430, binding = 2) readonly buffer materialBuffer {
+    MaterialData materials[];
+};
+
+// every instance in a draw shares its material, so the array index is dynamically uniform
+layout (binding = 0) uniform sampler2DArray materialTextures[16];
+// every shadowed spot light has a tile in here, ShadowData.atlasRect says where
+layout (binding = 16) uniform sampler2D shadowAtlas;
 
 layout (location = 8) uniform vec3 camPos;
 layout (location = 9) uniform float bloomThreshold;
-layout (location = 10) uniform float metallicStrength; 
-layout (location = 11) uniform float roughnessStrength; 
-layout (location = 12) uniform float aoStrength; 
-layout (location = 13) uniform float normalStrength; 
-layout (location = 14) uniform vec3 baseColor; 
 layout (location = 35) uniform float ambientBrightness; 
-uniform vec2 textureTiling;
 
-layout (location = 36) uniform PointLight pointLights[16];
-layout (location = 120) uniform SpotLight spotLights[16];
+layout (std430, binding = 3) readonly buffer lightBuffer {
+    LightData lights[];
+};
+
+// offset, count into lightIndices per cluster
+layout (std430, binding = 4) readonly buffer clusterBuffer {
+    uvec2 clusters[];
+};
+
+layout (std430, binding = 5) readonly buffer lightIndexBuffer {
+    uint lightIndices[];
+};
+
+struct ShadowData {
+    mat4 lightSpaceMatrix;
+    vec4 atlasRect;
+    float lightRadiusUV;
+    float blockerSearchUV;
+    vec2 padding;
+};
+
+// indexed by LightData.shadowIndex, light space positions are only computed for shadowed lights in the cluster
+layout (std430, binding = 6) readonly buffer shadowBuffer {
+    ShadowData shadows[];
+};
+
+uniform vec2 clusterTileSize;
+uniform float clusterScale;
+uniform float clusterBias;
 
 layout (location = 0) out vec4 FragColor;
 layout (location = 1) out vec4 BloomColor;
@@ -80,8 +108,6 @@ const vec2 poissonDisk[POISSON_SAMPLES] = vec2[](
     vec2(0.19984126,  0.78641367),   vec2(0.14383161, -0.14100790)
 );
 
-uniform float u_LightRadiusUV    = 0.005;
-uniform float u_BlockerSearchUV  = 0.0025;
 uniform vec3 fogColor = vec3(1.0, 1.0, 1.0);
 uniform float maxFogDistance = 65.0;
 uniform float minFogDistance = 1.0;
@@ -92,31 +118,55 @@ float gradientNoise(in vec2 uv)
 	return fract(52.9829189 * fract(dot(uv, vec2(0.06711056, 0.00583715))));
 }
 
+// CLUSTER_GRID_* are injected from lightclusters.h when the program loads, slices are exponential in view depth
+uint getCluster() {
+    float depth = -fromVert.gPosition.z;
+    uint slice = uint(clamp(floor(log(depth) * clusterScale + clusterBias), 0.0, float(CLUSTER_GRID_Z - 1u)));
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterTileSize), uvec2(CLUSTER_GRID_X - 1u, CLUSTER_GRID_Y - 1u));
+    return (slice * CLUSTER_GRID_Y + tile.y) * CLUSTER_GRID_X + tile.x;
+}
+
+// inverse square falloff faded to zero at the range the light was clustered with
+float getAttenuation(float distance, float range) {
+    float ratio = distance / range;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window / (distance * distance);
+}
+
+vec4 sampleMaterial(uint textureRef, vec2 uv) {
+    return texture(materialTextures[textureRef >> 16], vec3(uv, float(textureRef & 0xFFFFu)));
+}
+
 highp float remap(highp float value, highp float inputMin, highp float inputMax, highp float outputMin, highp float outputMax) {
   highp float normalizedValue = (value - inputMin) / (inputMax - inputMin);
   return normalizedValue * (outputMax - outputMin) + outputMin;
 }
 
-  float ShadowPCSS(int index, vec3 N)
+// uv is in the light's tile, clamped half a texel inside so filter taps never read a neighbouring tile
+float sampleShadowAtlas(vec4 atlasRect, vec2 uv) {
+    vec2 halfTexel = 0.5 / (atlasRect.zw * vec2(textureSize(shadowAtlas, 0)));
+    return texture(shadowAtlas, atlasRect.xy + clamp(uv, halfTexel, 1.0 - halfTexel) * atlasRect.zw).r;
+}
+
+  float ShadowPCSS(int index, vec3 direction, vec3 N)
 {
-    vec3 proj = fromVert.fragPosLightSpace[index].xyz /
-                fromVert.fragPosLightSpace[index].w;
+    ShadowData shadowData = shadows[index];
+    vec4 fragPosLightSpace = shadowData.lightSpaceMatrix * vec4(fromVert.fragPos, 1.0);
+    vec3 proj = fragPosLightSpace.xyz / fragPosLightSpace.w;
     proj = proj * 0.5 + 0.5;
 
-    if (proj.z > 1.0) return 0.0;
+    if (proj.z > 1.0 || any(lessThan(proj.xy, vec2(0.0))) || any(greaterThan(proj.xy, vec2(1.0)))) return 0.0;
 
-    vec3  L       = normalize(-spotLights[index].direction);
+    vec3  L       = normalize(-direction);
     float bias    = max(0.05 * (1.0 - dot(normalize(fromVert.normal), L)), 0.005);
 
-    vec2 texelSize      = 1.0 / textureSize(spotLightShadowMaps[index], 0);
-
     float avgBlockerDepth = 0.0;
     int   blockerCount    = 0;
 
     for (int i = 0; i < POISSON_SAMPLES; ++i)
     {
-        vec2 offset = poissonDisk[i] * u_BlockerSearchUV;
-        float sampleDepth = texture(spotLightShadowMaps[index], proj.xy + offset).r;
+        vec2 offset = poissonDisk[i] * shadowData.blockerSearchUV;
+        float sampleDepth = sampleShadowAtlas(shadowData.atlasRect, proj.xy + offset);
 
         if (sampleDepth < proj.z - bias)
         {
@@ -130,13 +180,13 @@ highp float remap(highp float value, highp float inputMin, highp float inputMax,
 
     avgBlockerDepth /= float(blockerCount);
 
-    float filterRadiusUV = ((proj.z - avgBlockerDepth) *  u_LightRadiusUV) / avgBlockerDepth;
+    float filterRadiusUV = ((proj.z - avgBlockerDepth) *  shadowData.lightRadiusUV) / avgBlockerDepth;
 
     float shadow = 0.0;
     for (int i = 0; i < POISSON_SAMPLES; ++i)
     {
         vec2 offset = poissonDisk[i] * filterRadiusUV;
-        float sampleDepth = texture(spotLightShadowMaps[index], proj.xy + offset).r;
+        float sampleDepth = sampleShadowAtlas(shadowData.atlasRect, proj.xy + offset);
         shadow += (proj.z - bias > sampleDepth) ? 1.0 : 0.0;
     }
 
@@ -182,12 +232,14 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0) {
 }  
 
 void main() {		
-    vec2 tiledTexCoord = fromVert.texCoord * textureTiling;
-    vec3 albedo = texture(albedoMap, tiledTexCoord).rgb * baseColor;
-    vec3 normal = texture(normalMap, tiledTexCoord).rgb;
-    float roughness = texture(roughnessMap, tiledTexCoord).r * roughnessStrength;
-    float metallic = texture(metallicMap, tiledTexCoord).r * metallicStrength;
-    float ao = texture(aoMap, tiledTexCoord).r * aoStrength;
+    MaterialData material = materials[fromVert.materialIndex];
+    vec3 baseColor = material.baseColor.rgb;
+    vec2 tiledTexCoord = fromVert.texCoord * material.textureTiling;
+    vec3 albedo = sampleMaterial(material.textures[0], tiledTexCoord).rgb * baseColor;
+    vec3 normal = sampleMaterial(material.textures[4], tiledTexCoord).rgb;
+    float roughness = sampleMaterial(material.textures[1], tiledTexCoord).r * material.roughness;
+    float metallic = sampleMaterial(material.textures[2], tiledTexCoord).r * material.metalness;
+    float ao = sampleMaterial(material.textures[3], tiledTexCoord).r * material.aoStrength;
 
     ViewPosition = fromVert.gPosition;
     ViewNormal = fromVert.gNormal;
@@ -195,7 +247,7 @@ void main() {
     // ao = 1.0;
 
     vec3 N = normal * 2.0 - 1.0;
-    N.xy *= normalStrength;
+    N.xy *= material.normalStrength;
     N = normalize(N);
     N = normalize(fromVert.TBN * N);
 
@@ -205,29 +257,30 @@ void main() {
     F0 = mix(F0, albedo, metallic);
 	           
     vec3 Lo = vec3(0.0);
-    
-    float shadowCalc = 0.0;
-
-for(int i = 0; i < fromVert.numSpotLights; ++i) {
-         if(spotLights[i].brightness == 0 || spotLights[i].isEnabled == 0){
-            continue;
-        } 
 
-        vec3 L = normalize(spotLights[i].position - fromVert.fragPos);
-        vec3 H = normalize(V + L);
-        float distance    = length(spotLights[i].position - fromVert.fragPos);
-        float attenuation = (1.0 / (distance * distance));
-        vec3 radiance     = spotLights[i].color * attenuation * spotLights[i].brightness;        
-
-        float theta = dot(L, normalize(-spotLights[i].direction));
-        float epsilon = spotLights[i].cutOff - spotLights[i].outerCutOff;
-        float intensityRadiance = smoothstep(spotLights[i].outerCutOff, spotLights[i].cutOff, theta) * spotLights[i].brightness;
+    // only the lights whose range touches this fragment's cluster
+    uvec2 cluster = clusters[getCluster()];
 
-        radiance *= intensityRadiance;
+    for(uint i = 0; i < cluster.y; ++i) {
+        LightData light = lights[lightIndices[cluster.x + i]];
+        vec3 lightPosition = light.positionRange.xyz;
+        float brightness = light.colorBrightness.w;
 
-        // shadowCalc = ShadowCalculation(i, N);
-        if(spotLights[i].shadows != 0){
-            shadowCalc = ShadowPCSS(i, N);
+        vec3 L = normalize(lightPosition - fromVert.fragPos);
+        vec3 H = normalize(V + L);
+        float distance    = length(lightPosition - fromVert.fragPos);
+        float attenuation = getAttenuation(distance, light.positionRange.w);
+        vec3 radiance     = light.colorBrightness.rgb * attenuation * brightness;
+        float shadowCalc = 0.0;
+
+        if(light.type == LIGHT_SPOT){
+            float theta = dot(L, normalize(-light.directionCosOuter.xyz));
+            float intensityRadiance = smoothstep(light.directionCosOuter.w, light.cosCutoff, theta) * brightness;
+            radiance *= intensityRadiance;
+
+            if(light.shadowIndex >= 0){
+                shadowCalc = ShadowPCSS(light.shadowIndex, light.directionCosOuter.xyz, N);
+            }
         }
 
         float NDF = DistributionGGX(N, H, roughness);        
@@ -244,34 +297,6 @@ for(int i = 0; i < fromVert.numSpotLights; ++i) {
         float NdotL = max(dot(N, L), 0.0);                
         Lo += (kD * albedo / PI + specular) * radiance * NdotL * (1.0 - shadowCalc); 
     }
-
-
-      for(int i = 0; i < fromVert.numPointLights; ++i) {
-        if(pointLights[i].brightness == 0){
-            continue;
-        }
-
-        vec3 L = normalize(pointLights[i].position - fromVert.fragPos);
-        vec3 H = normalize(V + L);
-        float distance    = length(pointLights[i].position - fromVert.fragPos);
-        float attenuation = 1.0 / (distance * distance);
-        vec3 radiance     = pointLights[i].color * attenuation * pointLights[i].brightness;        
-        
-        float NDF = DistributionGGX(N, H, roughness);        
-        float G   = GeometrySmith(N, V, L, roughness);      
-        vec3 F    = fresnelSchlick(max(dot(H, V), 0.0), F0);       
-        
-        vec3 kS = F;
-        vec3 kD = vec3(1.0) - kS;
-        kD *= 1.0 - metallic;	  
-        
-        vec3 numerator    = NDF * G * F;
-        float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
-        vec3 specular     = numerator / denominator;  
-            
-        float NdotL = max(dot(N, L), 0.0);                
-        Lo += (kD * albedo / PI + specular) * radiance * NdotL; 
-    }     
   
     float fragDistance = length(fromVert.fragPos - camPos);
     float fogFactor = remap(fragDistance, minFogDistance, maxFogDistance, 0, 1); 
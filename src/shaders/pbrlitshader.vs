@@ -5,24 +5,48 @@ const int MAX_BONE_INFLUENCE = 4;
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
-layout (location = 2) in vec3 aNormal;
-layout (location = 3) in vec3 aTangent;
-layout (location = 4) in ivec4 boneIds;
+// octahedral, the tangent's w is the bitangent sign
+layout (location = 2) in vec2 aNormal;
+layout (location = 3) in vec4 aTangent;
+
+#ifdef SKINNED
+layout (location = 4) in uvec4 boneIds;
 layout (location = 5) in vec4 weights;
 
-layout (location = 4) uniform mat4 model;
-// layout (location = 5) uniform mat4 normalMatrix;
-layout (location = 6) uniform int numSpotLights;
-layout (location = 7) uniform int numPointLights;
-layout (location = 15) uniform mat4 lightSpaceMatrix[16];
-// layout (location = 32) uniform mat3 gNormalMatrix;
 uniform mat4 finalBoneMatrices[MAX_BONES];
 
+// weights are unorm8 and sum to one, a vertex without influences stays in its bind pose
+mat4 skinMatrix(){
+    if(weights == vec4(0.0))
+        return mat4(1.0);
+
+    return finalBoneMatrices[boneIds.x] * weights.x + finalBoneMatrices[boneIds.y] * weights.y +
+           finalBoneMatrices[boneIds.z] * weights.z + finalBoneMatrices[boneIds.w] * weights.w;
+}
+#endif
+
+vec3 octDecode(vec2 e){
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 layout (std140, binding = 0) uniform global{
     mat4 view;
     mat4 projection;
 };
 
+struct InstanceData {
+    mat4 model;
+    uvec4 params;
+};
+
+layout (std430, binding = 1) readonly buffer instanceBuffer {
+    InstanceData instances[];
+};
+
 out VertToFrag{
     vec2 texCoord;
     highp vec3 fragPos;
@@ -30,34 +54,26 @@ out VertToFrag{
     mat3 TBN;
     vec3 gPosition;
     vec3 gNormal;
-    vec4 fragPosLightSpace[16];
-    flat int numSpotLights;
-    flat int numPointLights;
+    flat uint materialIndex;
 } toFrag;
 
 void main(){
+    InstanceData instance = instances[gl_BaseInstance + gl_InstanceID];
+    mat4 model = instance.model;
     mat3 normalMatrix = transpose(inverse(mat3(model)));
     
         
-    highp vec4 totalPosition = vec4(0.0); 
-    vec3 totalNormal = vec3(0.0);
- 
-    for(int i = 0; i < MAX_BONE_INFLUENCE; i++){
-        if(boneIds[i] == -1) 
-            continue;
-
-         if(boneIds[i] >= MAX_BONES) 
-        {
-            totalPosition = vec4(aPos, 1.0);
-            totalNormal = aNormal;
-            break;
-        }  
-
-        vec4 localPosition = finalBoneMatrices[boneIds[i]] * vec4(aPos,1.0);
-        totalPosition += localPosition * weights[i];
-        vec3 localNormal = mat3(finalBoneMatrices[boneIds[i]]) * aNormal;   
-        totalNormal += localNormal * weights[i];
-    }
+    vec3 normal = octDecode(aNormal);
+    vec3 tangent = octDecode(aTangent.xy);
+
+#ifdef SKINNED
+    mat4 skin = skinMatrix();
+    highp vec4 totalPosition = skin * vec4(aPos, 1.0);
+    vec3 totalNormal = mat3(skin) * normal;
+#else
+    highp vec4 totalPosition = vec4(aPos, 1.0);
+    vec3 totalNormal = normal;
+#endif
 
     // vec4 modelPos = totalPosition;
 
@@ -72,21 +88,15 @@ void main(){
     // toFrag.normal = normalMatrix * aNormal; 
     toFrag.normal = normalMatrix * totalNormal; 
     toFrag.gNormal = mat3(view) * toFrag.normal;
-    toFrag.numSpotLights = numSpotLights; 
-    toFrag.numPointLights = numPointLights;
+    toFrag.materialIndex = instance.params.y;
     toFrag.gPosition = viewFrag.xyz;
 
     gl_Position = projection * viewFrag;
- 
-    
-    for(int i = 0; i < numSpotLights; i++){
-        toFrag.fragPosLightSpace[i] = lightSpaceMatrix[i] * modelPos;
-    }
 
-    vec3 T = normalize(normalMatrix * aTangent);
+    vec3 T = normalize(normalMatrix * tangent);
     vec3 N = normalize(toFrag.normal);
     T = normalize(T - N * dot(N, T));
-    vec3 B = cross(N, T); 
+    vec3 B = cross(N, T) * aTangent.w; 
     
     if(dot(cross(T, N), B) < 0.0f){
         T = T * -1.0f;
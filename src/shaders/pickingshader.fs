@@ -1,9 +1,10 @@
 #version 460 core
-layout (location = 9) uniform vec3 baseColor;
+flat in uint entityID;
 
 out vec4 FragColor;
 
 void main(){
-    FragColor = vec4(baseColor, 1.0f);
+    vec3 idColor = vec3(entityID & 0xFFu, (entityID >> 8) & 0xFFu, (entityID >> 16) & 0xFFu) / 255.0f;
+    FragColor = vec4(idColor, 1.0f);
     // FragColor = vec4(0.0, 1.0, 0.0, 1.0);
 }
\ No newline at end of file
@@ -4,7 +4,6 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
 
-layout (location = 4) uniform mat4 model;
 // layout (location = 5) uniform mat4 view;
 // layout (location = 6) uniform mat4 projection;
 
@@ -13,7 +12,21 @@ layout (std140, binding = 0) uniform matrices{
     mat4 projection;
 };
 
+struct InstanceData {
+    mat4 model;
+    uvec4 params;
+};
+
+layout (std430, binding = 1) readonly buffer instanceBuffer {
+    InstanceData instances[];
+};
+
+flat out uint entityID;
+
 void main(){
+    InstanceData instance = instances[gl_BaseInstance + gl_InstanceID];
+    mat4 model = instance.model;
+    entityID = instance.params.x;
     vec3 fragPos = vec3(model * vec4(aPos, 1.0));
     gl_Position = projection * view * vec4(fragPos, 1.0);
 }
\ No newline at end of file
@@ -6,6 +6,7 @@ layout (location = 2) in vec2 texCoord;
 
 layout (binding = 0) uniform sampler2D colorTex;
 layout (binding = 1) uniform sampler2D bloomTex;
+layout (binding = 2) uniform sampler2D aoTex;
 
 layout (location = 3) uniform float exposure;
 layout (location = 4) uniform float bloomAmount;
@@ -14,12 +15,11 @@ layout (location = 5) uniform float aoAmount;
 void main(){
     vec3 forwardColor = texture(colorTex, texCoord).rgb;
     
-    vec4 bloomColor = texture(bloomTex, texCoord);
+    vec3 bloomColor = texture(bloomTex, texCoord).rgb;
 
-    // bloomColor = vec4(0.0, 0.0, 0.0, 1.0);
-    forwardColor += bloomColor.rgb * bloomAmount; 
+    forwardColor += bloomColor * bloomAmount; 
     vec3 mapped = vec3(1.0) - exp(-forwardColor * exposure);
     mapped = pow(mapped , vec3(1.0 / 2.2));
-    mapped *= bloomColor.a;
+    mapped *= texture(aoTex, texCoord).r;
     FragColor = vec4(mapped , 1.0);
 }
\ No newline at end of file
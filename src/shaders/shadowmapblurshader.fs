@@ -28,6 +28,8 @@ out float FragColor;
 in vec2 TexCoords;
 
 layout (binding = 0) uniform sampler2D tex;
+// offset and scale of the tile being filtered, the quad covers only that tile of the atlas
+layout (location = 0) uniform vec4 tileRect;
 
 const float kernel5[5][5] = float[5][5](
     float[](1, 4, 7, 4, 1),
@@ -46,7 +48,10 @@ const float kernel3[3][3] = float[3][3](
 void main()
 {
     vec2 texelSize = 1.0 / vec2(textureSize(tex, 0));
-    float centerDepth = texture(tex, TexCoords).r;
+    vec2 uv = tileRect.xy + TexCoords * tileRect.zw;
+    vec2 tileMin = tileRect.xy + texelSize * 0.5;
+    vec2 tileMax = tileRect.xy + tileRect.zw - texelSize * 0.5;
+    float centerDepth = texture(tex, uv).r;
     
     float sigma = 2.0;  // Controls depth sensitivity
     float result = 0.0;
@@ -57,7 +62,7 @@ void main()
         for (int y = -1; y <= 1; ++y)
         {
             vec2 offset = vec2(float(x), float(y)) * texelSize;
-            float sampleDepth = texture(tex, TexCoords + offset).r;
+            float sampleDepth = texture(tex, clamp(uv + offset, tileMin, tileMax)).r;
             
             float depthDiff = centerDepth - sampleDepth;
             float rangeWeight = exp(-(depthDiff * depthDiff) / (2.0 * sigma * sigma));
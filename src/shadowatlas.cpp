@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "shadowatlas.h"
+#include "renderworld.h"
+#include "renderqueue.h"
+
+constexpr uint64_t cFnvOffset = 14695981039346656037ull;
+constexpr uint64_t cFnvPrime = 1099511628211ull;
+
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= cFnvPrime;
+    }
+
+    return hash;
+}
+
+static GLuint createAtlasTexture(GLenum format) {
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, format, cShadowAtlasSize, cShadowAtlasSize);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+static GLuint createAtlasFramebuffer(GLuint texture, GLenum attachment) {
+    GLuint frameBuffer;
+    glCreateFramebuffers(1, &frameBuffer);
+    glNamedFramebufferTexture(frameBuffer, attachment, texture, 0);
+    if (attachment == GL_DEPTH_ATTACHMENT) {
+        glNamedFramebufferDrawBuffer(frameBuffer, GL_NONE);
+        glNamedFramebufferReadBuffer(frameBuffer, GL_NONE);
+    }
+
+    if (glCheckNamedFramebufferStatus(frameBuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "ERROR::FRAMEBUFFER::Shadow atlas framebuffer is not complete!" << std::endl;
+    }
+
+    return frameBuffer;
+}
+
+// slots are popped from the back, so they're pushed in reverse to fill each band from the top left
+static void resetFreeSlots(ShadowAtlas* atlas) {
+    for (uint32_t sizeClass = 0; sizeClass < cShadowSizeClasses; sizeClass++) {
+        const uint32_t tilesPerRow = cShadowAtlasSize / (cShadowAtlasBand >> sizeClass);
+        const uint32_t count = tilesPerRow * (1u << sizeClass);
+        atlas->freeSlots[sizeClass].clear();
+        for (uint32_t slot = count; slot > 0; slot--) {
+            atlas->freeSlots[sizeClass].push_back(slot - 1);
+        }
+    }
+}
+
+void createShadowAtlas(ShadowAtlas* atlas) {
+    atlas->depthTex = createAtlasTexture(GL_DEPTH_COMPONENT32F);
+    atlas->staticTex = createAtlasTexture(GL_DEPTH_COMPONENT32F);
+    atlas->blurTex = createAtlasTexture(GL_R32F);
+    atlas->depthFBO = createAtlasFramebuffer(atlas->depthTex, GL_DEPTH_ATTACHMENT);
+    atlas->staticFBO = createAtlasFramebuffer(atlas->staticTex, GL_DEPTH_ATTACHMENT);
+    atlas->blurFBO = createAtlasFramebuffer(atlas->blurTex, GL_COLOR_ATTACHMENT0);
+
+    // tiles that were never drawn read as fully lit
+    const float farDepth = 1.0f;
+    glClearNamedFramebufferfv(atlas->blurFBO, GL_COLOR, 0, &farDepth);
+
+    atlas->tiles.clear();
+    resetFreeSlots(atlas);
+}
+
+void destroyShadowAtlas(ShadowAtlas* atlas) {
+    GLuint textures[3] = {atlas->depthTex, atlas->staticTex, atlas->blurTex};
+    GLuint frameBuffers[3] = {atlas->depthFBO, atlas->staticFBO, atlas->blurFBO};
+    glDeleteTextures(3, textures);
+    glDeleteFramebuffers(3, frameBuffers);
+
+    atlas->depthTex = atlas->staticTex = atlas->blurTex = 0;
+    atlas->depthFBO = atlas->staticFBO = atlas->blurFBO = 0;
+    atlas->tiles.clear();
+}
+
+void getShadowTileRect(uint32_t sizeClass, uint32_t slot, GLint* x, GLint* y, GLsizei* size) {
+    *size = cShadowAtlasBand >> sizeClass;
+    const uint32_t tilesPerRow = cShadowAtlasSize / *size;
+    *x = static_cast<GLint>(slot % tilesPerRow) * *size;
+    *y = static_cast<GLint>(sizeClass) * cShadowAtlasBand + static_cast<GLint>(slot / tilesPerRow) * *size;
+}
+
+// each halving of importance drops a size class, never past the smallest tile that still covers the light's resolution
+static uint32_t getShadowSizeClass(float importance, GLsizei resolution) {
+    uint32_t sizeClass = cShadowSizeClasses - 1;
+    float threshold = cShadowAlwaysUpdateImportance;
+    for (uint32_t i = 0; i < cShadowSizeClasses; i++) {
+        if (importance >= threshold) {
+            sizeClass = i;
+            break;
+        }
+        threshold *= 0.5f;
+    }
+
+    uint32_t smallest = 0;
+    while (smallest + 1 < cShadowSizeClasses && (cShadowAtlasBand >> (smallest + 1)) >= resolution) {
+        smallest++;
+    }
+
+    return JPH::max(sizeClass, smallest);
+}
+
+static void releaseShadowTile(ShadowAtlas* atlas, const ShadowTile* tile) {
+    atlas->freeSlots[tile->sizeClass].push_back(tile->slot);
+}
+
+// runs after extraction and before culling, lights without a tile don't get shadow views culled
+void assignShadowTiles(ShadowAtlas* atlas, RenderWorld* world) {
+    atlas->frame++;
+    atlas->order.clear();
+    atlas->stats.dropped = 0;
+    world->shadowMaps = 0;
+
+    for (auto& pair : atlas->tiles) {
+        pair.second.seen = false;
+    }
+
+    for (uint32_t i = 0; i < world->spotLights.size(); i++) {
+        RenderSpotLight* light = &world->spotLights[i];
+        light->shadowIndex = -1;
+        if (!light->enableShadows || !light->isActive) {
+            continue;
+        }
+
+        const float distance = (light->position - world->cameraPosition).Length();
+        light->shadowImportance = light->range / JPH::max(distance, 0.001f);
+        atlas->order.push_back(i);
+    }
+
+    std::sort(atlas->order.begin(), atlas->order.end(), [world](uint32_t a, uint32_t b) {
+        return world->spotLights[a].shadowImportance > world->spotLights[b].shadowImportance;
+    });
+
+    // a tile survives as long as its light wants the same size, or a bigger one that isn't available anyway.
+    // everything else goes back to the pools before this frame's lights pick new ones
+    for (uint32_t index : atlas->order) {
+        const RenderSpotLight* light = &world->spotLights[index];
+        auto found = atlas->tiles.find(light->entityID);
+        if (found == atlas->tiles.end()) {
+            continue;
+        }
+
+        const uint32_t sizeClass = getShadowSizeClass(light->shadowImportance, light->shadowResolution);
+        if (found->second.sizeClass == sizeClass || (found->second.sizeClass > sizeClass && atlas->freeSlots[sizeClass].empty())) {
+            found->second.seen = true;
+        }
+    }
+
+    for (auto it = atlas->tiles.begin(); it != atlas->tiles.end();) {
+        if (!it->second.seen) {
+            releaseShadowTile(atlas, &it->second);
+            it = atlas->tiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // most important first, a full size class hands out the next smaller one
+    for (uint32_t index : atlas->order) {
+        RenderSpotLight* light = &world->spotLights[index];
+        auto found = atlas->tiles.find(light->entityID);
+
+        if (found == atlas->tiles.end()) {
+            uint32_t sizeClass = getShadowSizeClass(light->shadowImportance, light->shadowResolution);
+            while (sizeClass < cShadowSizeClasses && atlas->freeSlots[sizeClass].empty()) {
+                sizeClass++;
+            }
+
+            if (sizeClass == cShadowSizeClasses) {
+                light->enableShadows = false;
+                atlas->stats.dropped++;
+                continue;
+            }
+
+            ShadowTile tile;
+            tile.sizeClass = sizeClass;
+            tile.slot = atlas->freeSlots[sizeClass].back();
+            tile.lastUpdate = atlas->frame;
+            tile.seen = true;
+            atlas->freeSlots[sizeClass].pop_back();
+            found = atlas->tiles.emplace(light->entityID, tile).first;
+        }
+
+        getShadowTileRect(found->second.sizeClass, found->second.slot, &light->atlasX, &light->atlasY, &light->atlasSize);
+        light->shadowIndex = static_cast<int32_t>(world->shadowMaps++);
+    }
+
+    atlas->stats.tiles = static_cast<uint32_t>(atlas->tiles.size());
+}
+
+static void commitShadowUpdate(ShadowAtlas* atlas, RenderWorld* world, const ShadowUpdate* update) {
+    ShadowTile* tile = &atlas->tiles[world->spotLights[update->light].entityID];
+    tile->lightSpaceMatrix = world->spotLights[update->light].lightSpaceMatrix;
+    tile->staticSignature = update->staticSignature;
+    tile->dynamicSignature = update->dynamicSignature;
+    tile->lastUpdate = atlas->frame;
+    tile->valid = true;
+
+    world->shadowPasses.push_back({update->light, update->staticCount, update->redrawStatic});
+    atlas->stats.updates++;
+    if (update->redrawStatic) {
+        atlas->stats.staticRedraws++;
+    }
+}
+
+// runs after culling. a tile is redrawn when the signature of its casters changes, new tiles and important lights
+// go first and the rest share the budget, longest waiting first
+void scheduleShadowUpdates(ShadowAtlas* atlas, RenderWorld* world) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ShadowAtlasStats* stats = &atlas->stats;
+
+    world->shadowPasses.clear();
+    atlas->candidates.clear();
+    stats->updates = 0;
+    stats->staticRedraws = 0;
+    stats->deferred = 0;
+
+    // hashed once per frame, each light only combines the hashes of its casters
+    atlas->objectSignatures.resize(world->objects.size());
+    for (uint32_t i = 0; i < world->objects.size(); i++) {
+        uint64_t hash = hashBytes(cFnvOffset, &world->objects[i].entityID, sizeof(uint32_t));
+        atlas->objectSignatures[i] = hashBytes(hash, &world->worldMatrices[i], sizeof(mat4));
+    }
+
+    for (uint32_t i = 0; i < world->spotLights.size(); i++) {
+        const RenderSpotLight* light = &world->spotLights[i];
+        if (light->shadowIndex < 0) {
+            continue;
+        }
+
+        const ShadowTile* tile = &atlas->tiles[light->entityID];
+        uint32_t* casters = world->shadowVisible.data() + light->firstVisible;
+        uint32_t* staticEnd = std::stable_partition(casters, casters + light->visibleCount, [world](uint32_t object) {
+            return world->objects[object].isStatic;
+        });
+
+        ShadowUpdate update;
+        update.light = i;
+        update.staticCount = static_cast<uint32_t>(staticEnd - casters);
+        update.staticSignature = hashBytes(cFnvOffset, &light->lightSpaceMatrix, sizeof(mat4));
+        update.dynamicSignature = cFnvOffset;
+        bool animated = false;
+
+        for (uint32_t* caster = casters; caster != staticEnd; caster++) {
+            update.staticSignature = hashBytes(update.staticSignature, &atlas->objectSignatures[*caster], sizeof(uint64_t));
+        }
+
+        for (uint32_t* caster = staticEnd; caster != casters + light->visibleCount; caster++) {
+            update.dynamicSignature = hashBytes(update.dynamicSignature, &atlas->objectSignatures[*caster], sizeof(uint64_t));
+            animated |= world->objects[*caster].boneCount > 0;
+        }
+
+        // the dynamic layer is drawn over the static one, so it redraws whenever the static layer does
+        update.redrawStatic = !tile->valid || update.staticSignature != tile->staticSignature;
+        if (!update.redrawStatic && !animated && update.dynamicSignature == tile->dynamicSignature) {
+            continue;
+        }
+
+        if ((!tile->valid || light->shadowImportance >= cShadowAlwaysUpdateImportance) && world->shadowPasses.size() < cMaxShadowPasses) {
+            commitShadowUpdate(atlas, world, &update);
+        } else {
+            atlas->candidates.push_back(update);
+        }
+    }
+
+    std::sort(atlas->candidates.begin(), atlas->candidates.end(), [atlas, world](const ShadowUpdate& a, const ShadowUpdate& b) {
+        const uint32_t waitA = atlas->frame - atlas->tiles[world->spotLights[a.light].entityID].lastUpdate;
+        const uint32_t waitB = atlas->frame - atlas->tiles[world->spotLights[b.light].entityID].lastUpdate;
+        if (waitA != waitB) {
+            return waitA > waitB;
+        }
+        return world->spotLights[a.light].shadowImportance > world->spotLights[b.light].shadowImportance;
+    });
+
+    const uint32_t remaining = cMaxShadowPasses - static_cast<uint32_t>(world->shadowPasses.size());
+    const uint32_t budgeted = JPH::min(static_cast<uint32_t>(atlas->candidates.size()), JPH::min(atlas->updateBudget, remaining));
+    for (uint32_t i = 0; i < budgeted; i++) {
+        commitShadowUpdate(atlas, world, &atlas->candidates[i]);
+    }
+
+    for (RenderSpotLight& light : world->spotLights) {
+        if (light.shadowIndex >= 0) {
+            light.shadowMatrix = atlas->tiles[light.entityID].lightSpaceMatrix;
+        }
+    }
+
+    stats->deferred = static_cast<uint32_t>(atlas->candidates.size()) - budgeted;
+    stats->scheduleMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include "utils/mathutils.h"
+
+struct RenderWorld;
+
+// every size class owns a 4096 x 1024 band of the atlas: 4 x 1024, 16 x 512, 64 x 256 and 256 x 128 tiles
+constexpr GLsizei cShadowAtlasSize = 4096;
+constexpr GLsizei cShadowAtlasBand = 1024;
+constexpr uint32_t cShadowSizeClasses = 4;
+constexpr uint32_t cDefaultShadowUpdateBudget = 4;
+// lights at least this important skip the budget and redraw whenever their casters change
+constexpr float cShadowAlwaysUpdateImportance = 1.0f;
+
+struct ShadowTile {
+    uint32_t sizeClass;
+    uint32_t slot;
+    uint64_t staticSignature = 0;
+    uint64_t dynamicSignature = 0;
+    uint32_t lastUpdate = 0;
+    // what the tile's depth was drawn with, a deferred tile keeps projecting with it until it is redrawn
+    mat4 lightSpaceMatrix = mat4::sIdentity();
+    // false until the tile has been drawn once, an empty tile always updates
+    bool valid = false;
+    bool seen = false;
+};
+
+// a dirty tile waiting on the budget, signatures are only stored once it is actually drawn
+struct ShadowUpdate {
+    uint32_t light;
+    uint32_t staticCount;
+    uint64_t staticSignature;
+    uint64_t dynamicSignature;
+    bool redrawStatic;
+};
+
+struct ShadowAtlasStats {
+    uint32_t tiles = 0;
+    uint32_t updates = 0;
+    uint32_t staticRedraws = 0;
+    uint32_t deferred = 0;
+    uint32_t dropped = 0;
+    double scheduleMs = 0.0;
+};
+
+// depth for static casters is cached in staticTex and only redrawn when its signature changes. an update copies
+// the tile into depthTex, draws the dynamic casters on top and filters the result into blurTex for the lit pass
+struct ShadowAtlas {
+    GLuint depthTex = 0;
+    GLuint staticTex = 0;
+    GLuint blurTex = 0;
+    GLuint depthFBO = 0;
+    GLuint staticFBO = 0;
+    GLuint blurFBO = 0;
+
+    std::vector<uint32_t> freeSlots[cShadowSizeClasses];
+    // keyed by spot light entity id
+    std::unordered_map<uint32_t, ShadowTile> tiles;
+    std::vector<uint32_t> order;
+    std::vector<ShadowUpdate> candidates;
+    std::vector<uint64_t> objectSignatures;
+    uint32_t frame = 0;
+    uint32_t updateBudget = cDefaultShadowUpdateBudget;
+    ShadowAtlasStats stats;
+};
+
+void createShadowAtlas(ShadowAtlas* atlas);
+void destroyShadowAtlas(ShadowAtlas* atlas);
+void getShadowTileRect(uint32_t sizeClass, uint32_t slot, GLint* x, GLint* y, GLsizei* size);
+void assignShadowTiles(ShadowAtlas* atlas, RenderWorld* world);
+void scheduleShadowUpdates(ShadowAtlas* atlas, RenderWorld* world);
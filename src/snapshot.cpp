@@ -0,0 +1,192 @@
+#include <iostream>
+#include <algorithm>
+
+#include "snapshot.h"
+#include "scene.h"
+
+static void getSortedBodyIDs(PhysicsScene* physicsScene, std::vector<JPH::BodyID>* bodyIDs) {
+    JPH::BodyIDVector bodies;
+    physicsScene->physicsSystem->GetBodies(bodies);
+    bodyIDs->assign(bodies.begin(), bodies.end());
+    std::sort(bodyIDs->begin(), bodyIDs->end());
+}
+
+static void savePhysicsState(PhysicsScene* physicsScene, JPH::StateRecorderImpl* state, std::vector<JPH::BodyID>* bodyIDs) {
+    state->Clear();
+    physicsScene->physicsSystem->SaveState(*state);
+    getSortedBodyIDs(physicsScene, bodyIDs);
+}
+
+static bool restorePhysicsState(PhysicsScene* physicsScene, JPH::StateRecorderImpl* state) {
+    state->Rewind();
+    if (!physicsScene->physicsSystem->RestoreState(*state)) {
+        std::cerr << "ERROR::SNAPSHOT::Jolt failed to restore the physics state" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// the jolt state only holds motion, so shape, layer and motion type edits made during play are pushed back from the
+// restored rigidbodies. this runs before the state is restored so the bodies have the layout the state was saved with
+static void applyRigidbodySettings(PhysicsScene* physicsScene, std::vector<RigidBody>* rigidbodies) {
+    JPH::BodyInterface* bodyInterface = physicsScene->bodyInterface;
+    bool shapesChanged = false;
+
+    for (RigidBody& rb : *rigidbodies) {
+        if (rb.joltBody.IsInvalid()) {
+            continue;
+        }
+
+        JPH::ShapeRefC shape = getRigidbodyShape(&rb);
+        if (shape == nullptr) {
+            continue;
+        }
+
+        if (shape.GetPtr() != bodyInterface->GetShape(rb.joltBody).GetPtr()) {
+            bodyInterface->SetShape(rb.joltBody, shape, false, JPH::EActivation::DontActivate);
+            shapesChanged = true;
+        }
+
+        // mesh bodies are always created static, see createRigidbodyBody
+        const bool isMesh = shape->GetSubType() == JPH::EShapeSubType::Mesh;
+        if (!isMesh && bodyInterface->GetMotionType(rb.joltBody) != rb.motionType) {
+            bodyInterface->SetMotionType(rb.joltBody, rb.motionType, JPH::EActivation::DontActivate);
+        }
+
+        if (bodyInterface->GetObjectLayer(rb.joltBody) != rb.layer) {
+            bodyInterface->SetObjectLayer(rb.joltBody, rb.layer);
+        }
+    }
+
+    if (shapesChanged) {
+        releaseUnusedShapes();
+    }
+}
+
+void saveSceneSnapshot(Scene* scene, SceneSnapshot* snapshot) {
+    snapshot->entities = scene->entities;
+    snapshot->physicsAccum = scene->physicsAccum;
+    savePhysicsState(&scene->physicsScene, &snapshot->physicsState, &snapshot->bodyIDs);
+    snapshot->valid = true;
+}
+
+// jolt restores state per body so the body set has to match the snapshot exactly, bodies spawned after the snapshot are
+// destroyed, a body that was destroyed since can't be brought back and the caller has to reload the scene instead
+bool restoreSceneSnapshot(Scene* scene, SceneSnapshot* snapshot) {
+    if (!snapshot->valid) {
+        return false;
+    }
+
+    PhysicsScene* physicsScene = &scene->physicsScene;
+    JPH::BodyInterface* bodyInterface = physicsScene->bodyInterface;
+    EntityGroup* entities = &scene->entities;
+
+    std::vector<JPH::BodyID> currentBodyIDs;
+    getSortedBodyIDs(physicsScene, &currentBodyIDs);
+
+    if (!std::includes(currentBodyIDs.begin(), currentBodyIDs.end(), snapshot->bodyIDs.begin(), snapshot->bodyIDs.end())) {
+        std::cerr << "ERROR::SNAPSHOT::Bodies were destroyed since the snapshot was taken" << std::endl;
+        snapshot->valid = false;
+        return false;
+    }
+
+    std::vector<JPH::BodyID> addedBodyIDs;
+    std::set_difference(currentBodyIDs.begin(), currentBodyIDs.end(), snapshot->bodyIDs.begin(), snapshot->bodyIDs.end(), std::back_inserter(addedBodyIDs));
+
+    for (JPH::BodyID bodyID : addedBodyIDs) {
+        JPH::ShapeRefC shape = bodyInterface->GetShape(bodyID);
+        if (bodyInterface->IsAdded(bodyID)) {
+            bodyInterface->RemoveBody(bodyID);
+        }
+        bodyInterface->DestroyBody(bodyID);
+        releaseCachedShape(shape.GetPtr());
+    }
+
+    applyRigidbodySettings(physicsScene, &snapshot->entities.rigidbodies);
+    if (!restorePhysicsState(physicsScene, &snapshot->physicsState)) {
+        snapshot->valid = false;
+        return false;
+    }
+
+    scene->entities = snapshot->entities;
+    scene->physicsAccum = snapshot->physicsAccum;
+
+    for (Player& player : entities->players) {
+        player.cameraController.camera = getCamera(entities, player.cameraController.cameraEntityID);
+    }
+
+    snapshot->valid = false;
+    return true;
+}
+
+void initPhysicsHistory(PhysicsHistory* history, uint32_t capacity) {
+    destroyPhysicsHistory(history);
+    history->frames.resize(capacity);
+    for (uint32_t i = 0; i < capacity; i++) {
+        history->frames[i] = new PhysicsFrame();
+    }
+}
+
+void destroyPhysicsHistory(PhysicsHistory* history) {
+    for (PhysicsFrame* frame : history->frames) {
+        delete frame;
+    }
+
+    history->frames.clear();
+    clearPhysicsHistory(history);
+}
+
+void clearPhysicsHistory(PhysicsHistory* history) {
+    history->head = 0;
+    history->count = 0;
+}
+
+void recordPhysicsFrame(Scene* scene, PhysicsHistory* history) {
+    const uint32_t capacity = static_cast<uint32_t>(history->frames.size());
+    if (!history->enabled || capacity == 0) {
+        return;
+    }
+
+    PhysicsFrame* frame = history->frames[history->head];
+    savePhysicsState(&scene->physicsScene, &frame->physicsState, &frame->bodyIDs);
+    frame->transforms = scene->entities.transforms;
+    frame->rigidbodies = scene->entities.rigidbodies;
+    frame->physicsAccum = scene->physicsAccum;
+
+    history->head = (history->head + 1) % capacity;
+    history->count = JPH::min(history->count + 1, capacity);
+}
+
+bool rewindPhysicsFrames(Scene* scene, PhysicsHistory* history, uint32_t numFrames) {
+    const uint32_t capacity = static_cast<uint32_t>(history->frames.size());
+    if (numFrames == 0 || numFrames > history->count) {
+        std::cerr << "ERROR::SNAPSHOT::Can't rewind " << numFrames << " frames, " << history->count << " recorded" << std::endl;
+        return false;
+    }
+
+    // the newest frame is head - 1, rewinding one frame restores it
+    uint32_t index = (history->head + capacity - numFrames) % capacity;
+    PhysicsFrame* frame = history->frames[index];
+    EntityGroup* entities = &scene->entities;
+
+    std::vector<JPH::BodyID> currentBodyIDs;
+    getSortedBodyIDs(&scene->physicsScene, &currentBodyIDs);
+    if (currentBodyIDs != frame->bodyIDs || entities->transforms.size() != frame->transforms.size() || entities->rigidbodies.size() != frame->rigidbodies.size()) {
+        std::cerr << "ERROR::SNAPSHOT::Entities or bodies changed since that frame, can't rewind" << std::endl;
+        return false;
+    }
+
+    applyRigidbodySettings(&scene->physicsScene, &frame->rigidbodies);
+    if (!restorePhysicsState(&scene->physicsScene, &frame->physicsState)) {
+        return false;
+    }
+
+    entities->transforms = frame->transforms;
+    entities->rigidbodies = frame->rigidbodies;
+    scene->physicsAccum = frame->physicsAccum;
+
+    history->head = (index + 1) % capacity;
+    history->count -= numFrames - 1;
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <Jolt/Jolt.h>
+#include <Jolt/Physics/StateRecorderImpl.h>
+
+#include "ecs.h"
+#include "physics.h"
+
+struct Scene;
+
+// full copy of the ecs plus the jolt state, used by play/stop in the editor
+struct SceneSnapshot {
+    EntityGroup entities;
+    JPH::StateRecorderImpl physicsState;
+    std::vector<JPH::BodyID> bodyIDs;
+    double physicsAccum = 0.0;
+    bool valid = false;
+};
+
+// per frame physics only history for rewinding, frames can only be restored while the entity and body sets are unchanged
+struct PhysicsFrame {
+    JPH::StateRecorderImpl physicsState;
+    std::vector<JPH::BodyID> bodyIDs;
+    std::vector<Transform> transforms;
+    std::vector<RigidBody> rigidbodies;
+    double physicsAccum = 0.0;
+};
+
+struct PhysicsHistory {
+    std::vector<PhysicsFrame*> frames;
+    uint32_t head = 0;
+    uint32_t count = 0;
+    bool enabled = false;
+};
+
+void saveSceneSnapshot(Scene* scene, SceneSnapshot* snapshot);
+bool restoreSceneSnapshot(Scene* scene, SceneSnapshot* snapshot);
+void initPhysicsHistory(PhysicsHistory* history, uint32_t capacity);
+void destroyPhysicsHistory(PhysicsHistory* history);
+void clearPhysicsHistory(PhysicsHistory* history);
+void recordPhysicsFrame(Scene* scene, PhysicsHistory* history);
+bool rewindPhysicsFrames(Scene* scene, PhysicsHistory* history, uint32_t numFrames);